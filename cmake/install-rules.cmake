@@ -5,7 +5,7 @@ include(GNUInstallDirs)
 set(package rtxi)
 
 install(
-    TARGETS rtxi_exe
+    TARGETS rtxi_exe rtxi_log_decode
     RUNTIME COMPONENT rtxi_Runtime
 )
 
@@ -33,7 +33,7 @@ endif()
 
 install(
     FILES 
-        src/debug.hpp src/event.hpp src/io.hpp src/rt.hpp 
+        src/debug.hpp src/event.hpp src/event_queue.hpp src/io.hpp src/rt.hpp
         src/daq.hpp src/widgets.hpp src/logger.hpp src/fifo.hpp
         src/rtos.hpp src/dlplugin.hpp  
     DESTINATION ${CMAKE_INSTALL_INCLUDEDIR}/rtxi
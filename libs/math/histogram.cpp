@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cmath>
+
+#include "histogram.h"
+
+LogLinearHistogram::LogLinearHistogram(int64_t highest_value,
+                                       int sub_bucket_bits)
+    : m_sub_bucket_bits(std::clamp(sub_bucket_bits, 1, 30))
+    , m_sub_bucket_count(uint64_t {1} << m_sub_bucket_bits)
+    , m_sub_bucket_half(m_sub_bucket_count / 2)
+    , m_highest_value(std::max<int64_t>(highest_value, 1))
+    , m_counts(index_of(m_highest_value) + 1)
+    , m_total(0)
+    , m_max(0)
+{
+  clear();
+}
+
+void LogLinearHistogram::clear()
+{
+  for (auto& bucket : m_counts) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  m_total.store(0, std::memory_order_relaxed);
+  m_max.store(0, std::memory_order_relaxed);
+}
+
+void LogLinearHistogram::record(int64_t value)
+{
+  value = std::clamp<int64_t>(value, 0, m_highest_value);
+  // There is only one writer, so plain loads and stores are enough
+  auto& bucket = m_counts[index_of(value)];
+  bucket.store(bucket.load(std::memory_order_relaxed) + 1,
+               std::memory_order_relaxed);
+  m_total.store(m_total.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+  if (value > m_max.load(std::memory_order_relaxed)) {
+    m_max.store(value, std::memory_order_relaxed);
+  }
+}
+
+uint64_t LogLinearHistogram::count() const
+{
+  return m_total.load(std::memory_order_relaxed);
+}
+
+int64_t LogLinearHistogram::max() const
+{
+  return m_max.load(std::memory_order_relaxed);
+}
+
+int64_t LogLinearHistogram::percentile(double percent) const
+{
+  const uint64_t total = count();
+  if (total == 0) {
+    return 0;
+  }
+  percent = std::clamp(percent, 0.0, 100.0);
+  const auto target = std::max<uint64_t>(
+      1,
+      static_cast<uint64_t>(
+          std::ceil(percent / 100.0 * static_cast<double>(total))));
+  uint64_t cumulative = 0;
+  for (size_t index = 0; index < m_counts.size(); ++index) {
+    cumulative += m_counts[index].load(std::memory_order_relaxed);
+    if (cumulative >= target) {
+      return std::min(highest_equivalent(index), max());
+    }
+  }
+  return max();
+}
+
+void LogLinearHistogram::dump(std::ostream& stream) const
+{
+  const uint64_t total = count();
+  stream << "#[Count = " << total << ", Max = " << max() << "]\n";
+  stream << "Value\tPercentile\tTotalCount\n";
+  if (total == 0) {
+    return;
+  }
+  uint64_t cumulative = 0;
+  for (size_t index = 0; index < m_counts.size(); ++index) {
+    const uint64_t bucket = m_counts[index].load(std::memory_order_relaxed);
+    if (bucket == 0) {
+      continue;
+    }
+    cumulative += bucket;
+    stream << std::min(highest_equivalent(index), max()) << "\t"
+           << static_cast<double>(cumulative) / static_cast<double>(total)
+           << "\t" << cumulative << "\n";
+  }
+}
+
+size_t LogLinearHistogram::index_of(int64_t value) const
+{
+  const auto uvalue = static_cast<uint64_t>(value);
+  if (uvalue < m_sub_bucket_count) {
+    return uvalue;
+  }
+  // Every power of two above the linear range is split in half as many
+  // sub-buckets, as its lower half is already covered by the range below
+  const int msb = 63 - __builtin_clzll(uvalue);
+  const int exponent = msb - m_sub_bucket_bits + 1;
+  const uint64_t sub_bucket = uvalue >> exponent;
+  return m_sub_bucket_count
+      + static_cast<uint64_t>(exponent - 1) * m_sub_bucket_half
+      + (sub_bucket - m_sub_bucket_half);
+}
+
+int64_t LogLinearHistogram::highest_equivalent(size_t index) const
+{
+  if (index < m_sub_bucket_count) {
+    return static_cast<int64_t>(index);
+  }
+  const uint64_t offset = index - m_sub_bucket_count;
+  const uint64_t exponent = offset / m_sub_bucket_half + 1;
+  const uint64_t sub_bucket = offset % m_sub_bucket_half + m_sub_bucket_half;
+  return static_cast<int64_t>(((sub_bucket + 1) << exponent) - 1);
+}
@@ -0,0 +1,55 @@
+/*
+ * LogLinearHistogram records non-negative integer values (typically
+ * nanosecond latencies) in a fixed amount of memory, in the manner of
+ * HdrHistogram. Values are grouped in power of two ranges that are each split
+ * into linear sub-buckets, so the relative error of any reported value is
+ * bounded by 2^-(sub_bucket_bits - 1) regardless of its magnitude.
+ *
+ * Recording never allocates and is safe to use in the real-time thread. A
+ * single thread may record values while other threads query percentiles.
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+class LogLinearHistogram
+{
+public:
+  explicit LogLinearHistogram(int64_t highest_value, int sub_bucket_bits = 7);
+  LogLinearHistogram(const LogLinearHistogram&) = delete;
+  LogLinearHistogram(LogLinearHistogram&&) = delete;
+  LogLinearHistogram& operator=(const LogLinearHistogram&) = delete;
+  LogLinearHistogram& operator=(LogLinearHistogram&&) = delete;
+  ~LogLinearHistogram() = default;
+
+  void clear();
+  // values outside of [0, highest_value] are clamped
+  void record(int64_t value);
+  uint64_t count() const;
+  int64_t max() const;
+  // highest value within the given percent (0-100) of recorded values
+  int64_t percentile(double percent) const;
+  // writes the cumulative distribution as text, one bucket per line
+  void dump(std::ostream& stream) const;
+
+private:
+  friend class LogLinearHistogramTest;
+
+  size_t index_of(int64_t value) const;
+  int64_t highest_equivalent(size_t index) const;
+
+  int m_sub_bucket_bits;
+  uint64_t m_sub_bucket_count;
+  uint64_t m_sub_bucket_half;
+  int64_t m_highest_value;
+  std::vector<std::atomic<uint64_t>> m_counts;
+  std::atomic<uint64_t> m_total;
+  std::atomic<int64_t> m_max;
+};
+
+#endif
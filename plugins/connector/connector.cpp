@@ -242,6 +242,7 @@ void Connector::Plugin::receiveEvent(Event::Object* event)
     case Event::Type::RT_DEVICE_REMOVE_EVENT:
     case Event::Type::IO_LINK_INSERT_EVENT:
     case Event::Type::IO_LINK_REMOVE_EVENT:
+    case Event::Type::RT_COMMAND_BATCH_EVENT:
       this->updatePanelInfo();
       break;
     default:
@@ -249,6 +250,17 @@ void Connector::Plugin::receiveEvent(Event::Object* event)
   }
 }
 
+std::vector<Event::Type> Connector::Plugin::subscriptions() const
+{
+  return {Event::Type::RT_THREAD_INSERT_EVENT,
+          Event::Type::RT_THREAD_REMOVE_EVENT,
+          Event::Type::RT_DEVICE_INSERT_EVENT,
+          Event::Type::RT_DEVICE_REMOVE_EVENT,
+          Event::Type::IO_LINK_INSERT_EVENT,
+          Event::Type::IO_LINK_REMOVE_EVENT,
+          Event::Type::RT_COMMAND_BATCH_EVENT};
+}
+
 void Connector::Plugin::updatePanelInfo()
 {
   dynamic_cast<Connector::Panel*>(this->getPanel())->updateBlockInfo();
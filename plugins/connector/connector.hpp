@@ -80,6 +80,7 @@ class Plugin : public Widgets::Plugin
 public:
   explicit Plugin(Event::Manager* ev_manager);
   void receiveEvent(Event::Object* event) override;
+  std::vector<Event::Type> subscriptions() const override;
 
 private:
   void updatePanelInfo();
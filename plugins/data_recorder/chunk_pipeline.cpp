@@ -0,0 +1,351 @@
+/*
+         The Real-Time eXperiment Interface (RTXI)
+         Copyright (C) 2011 Georgia Institute of Technology, University of Utah,
+   Weill Cornell Medical College
+
+         This program is free software: you can redistribute it and/or modify
+         it under the terms of the GNU General Public License as published by
+         the Free Software Foundation, either version 3 of the License, or
+         (at your option) any later version.
+
+         This program is distributed in the hope that it will be useful,
+         but WITHOUT ANY WARRANTY; without even the implied warranty of
+         MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+         GNU General Public License for more details.
+
+         You should have received a copy of the GNU General Public License
+         along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+#include "chunk_pipeline.hpp"
+
+#include <zlib.h>
+
+DataRecorder::ChunkPipeline::ChunkPipeline(size_t worker_count)
+{
+  worker_count = std::max<size_t>(worker_count, 1);
+  for (size_t i = 0; i < worker_count; i++) {
+    this->workers.emplace_back(&DataRecorder::ChunkPipeline::worker_loop,
+                               this);
+  }
+}
+
+DataRecorder::ChunkPipeline::~ChunkPipeline()
+{
+  {
+    const std::unique_lock<std::mutex> lk(this->job_mut);
+    this->running = false;
+  }
+  this->job_available.notify_all();
+  for (auto& worker : this->workers) {
+    worker.join();
+  }
+}
+
+// Workers finish every queued job before exiting so that no pending chunk
+// is destroyed while it is being compressed
+void DataRecorder::ChunkPipeline::worker_loop()
+{
+  std::packaged_task<int()> job;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lk(this->job_mut);
+      this->job_available.wait(
+          lk, [this]() { return !this->running || !this->jobs.empty(); });
+      if (this->jobs.empty()) {
+        return;
+      }
+      job = std::move(this->jobs.front());
+      this->jobs.pop_front();
+    }
+    job();
+  }
+}
+
+bool DataRecorder::ChunkPipeline::supported()
+{
+  return H5Tequal(H5T_NATIVE_DOUBLE, H5T_IEEE_F64LE) > 0
+      && H5Tequal(H5T_NATIVE_INT64, H5T_STD_I64LE) > 0;
+}
+
+int DataRecorder::ChunkPipeline::open(hid_t data_set,
+                                      hid_t time_set,
+                                      hsize_t channels,
+                                      hsize_t frames_per_chunk,
+                                      const chunk_filter_t& set_filter)
+{
+  if (!DataRecorder::ChunkPipeline::supported() || data_set == H5I_INVALID_HID
+      || channels == 0 || frames_per_chunk == 0)
+  {
+    return -1;
+  }
+  this->data_handle = data_set;
+  this->time_handle = time_set;
+  this->channel_count = channels;
+  this->chunk_frames = frames_per_chunk;
+  this->filter = set_filter;
+  this->chunk_fill = 0;
+  this->queued_rows = 0;
+  this->error = 0;
+  return 0;
+}
+
+std::unique_ptr<DataRecorder::ChunkPipeline::chunk_t>
+DataRecorder::ChunkPipeline::take_chunk()
+{
+  std::unique_ptr<chunk_t> chunk;
+  if (this->spare_chunks.empty()) {
+    chunk = std::make_unique<chunk_t>();
+  } else {
+    chunk = std::move(this->spare_chunks.back());
+    this->spare_chunks.pop_back();
+  }
+  chunk->row = this->queued_rows;
+  chunk->data_raw.resize(this->chunk_frames * this->channel_count
+                         * sizeof(double));
+  chunk->time_raw.resize(this->chunk_frames * sizeof(int64_t));
+  return chunk;
+}
+
+int DataRecorder::ChunkPipeline::append(const void* frames, size_t frame_count)
+{
+  if (!this->isOpen()) {
+    return -1;
+  }
+  const auto* frame = static_cast<const char*>(frames);
+  const size_t value_bytes = this->channel_count * sizeof(double);
+  size_t rows = 0;
+  while (frame_count > 0) {
+    if (this->current == nullptr) {
+      this->current = this->take_chunk();
+    }
+    rows = std::min<size_t>(frame_count, this->chunk_frames - this->chunk_fill);
+    for (size_t row = this->chunk_fill; row < this->chunk_fill + rows; row++) {
+      std::memcpy(this->current->time_raw.data() + (row * sizeof(int64_t)),
+                  frame,
+                  sizeof(int64_t));
+      std::memcpy(this->current->data_raw.data() + (row * value_bytes),
+                  frame + sizeof(int64_t),
+                  value_bytes);
+      frame += sizeof(int64_t) + value_bytes;
+    }
+    this->chunk_fill += rows;
+    frame_count -= rows;
+    if (this->chunk_fill == this->chunk_frames) {
+      this->submit();
+    }
+  }
+  // Let a couple of chunks per worker queue up before waiting on them
+  return this->commit_ready(2 * this->workers.size());
+}
+
+void DataRecorder::ChunkPipeline::submit()
+{
+  chunk_t* chunk = this->current.get();
+  const chunk_filter_t chunk_filter = this->filter;
+  const bool with_time = this->time_handle != H5I_INVALID_HID;
+  std::packaged_task<int()> job(
+      [chunk, chunk_filter, with_time]()
+      {
+        int result = DataRecorder::ChunkPipeline::encode(chunk->data_raw,
+                                                         sizeof(double),
+                                                         chunk_filter,
+                                                         chunk->scratch,
+                                                         chunk->data_packed);
+        if (result == 0 && with_time) {
+          result = DataRecorder::ChunkPipeline::encode(chunk->time_raw,
+                                                       sizeof(int64_t),
+                                                       chunk_filter,
+                                                       chunk->scratch,
+                                                       chunk->time_packed);
+        }
+        return result;
+      });
+  this->pending.push_back({std::move(this->current), job.get_future()});
+  {
+    const std::unique_lock<std::mutex> lk(this->job_mut);
+    this->jobs.push_back(std::move(job));
+  }
+  this->job_available.notify_one();
+  this->queued_rows += this->chunk_frames;
+  this->chunk_fill = 0;
+}
+
+// Chunks are committed in the order they were queued. Once more than
+// max_pending chunks are waiting the oldest one is waited on.
+int DataRecorder::ChunkPipeline::commit_ready(size_t max_pending)
+{
+  while (!this->pending.empty()) {
+    pending_t& front = this->pending.front();
+    if (this->pending.size() <= max_pending
+        && front.encoded.wait_for(std::chrono::seconds(0))
+            != std::future_status::ready)
+    {
+      break;
+    }
+    if (this->commit(front) != 0) {
+      this->error = -1;
+    }
+    this->spare_chunks.push_back(std::move(front.chunk));
+    this->pending.pop_front();
+  }
+  return this->error;
+}
+
+int DataRecorder::ChunkPipeline::commit(pending_t& entry)
+{
+  if (entry.encoded.get() != 0) {
+    return -1;
+  }
+  const chunk_t& chunk = *entry.chunk;
+  const std::array<hsize_t, 2> extent = {chunk.row + this->chunk_frames,
+                                         this->channel_count};
+  const std::array<hsize_t, 2> offset = {chunk.row, 0};
+  if (H5Dset_extent(this->data_handle, extent.data()) < 0
+      || H5Dwrite_chunk(this->data_handle,
+                        H5P_DEFAULT,
+                        0,
+                        offset.data(),
+                        chunk.data_packed.size(),
+                        chunk.data_packed.data())
+          < 0)
+  {
+    return -1;
+  }
+  if (this->time_handle == H5I_INVALID_HID) {
+    return 0;
+  }
+  if (H5Dset_extent(this->time_handle, extent.data()) < 0
+      || H5Dwrite_chunk(this->time_handle,
+                        H5P_DEFAULT,
+                        0,
+                        offset.data(),
+                        chunk.time_packed.size(),
+                        chunk.time_packed.data())
+          < 0)
+  {
+    return -1;
+  }
+  return 0;
+}
+
+// Chunks are stored at full size, so the rows of an unfinished chunk go
+// through H5Dwrite and HDF5 pads and filters the edge chunk itself
+int DataRecorder::ChunkPipeline::write_partial()
+{
+  const std::array<hsize_t, 2> extent = {this->queued_rows + this->chunk_fill,
+                                         this->channel_count};
+  const std::array<hsize_t, 2> offset = {this->queued_rows, 0};
+  const std::array<hsize_t, 2> count = {this->chunk_fill,
+                                        this->channel_count};
+  herr_t err = H5Dset_extent(this->data_handle, extent.data());
+  hid_t memory_space = H5Screate_simple(2, count.data(), nullptr);
+  hid_t file_space = H5Dget_space(this->data_handle);
+  H5Sselect_hyperslab(file_space,
+                      H5S_SELECT_SET,
+                      offset.data(),
+                      nullptr,
+                      count.data(),
+                      nullptr);
+  if (err >= 0) {
+    err = H5Dwrite(this->data_handle,
+                   H5T_NATIVE_DOUBLE,
+                   memory_space,
+                   file_space,
+                   H5P_DEFAULT,
+                   this->current->data_raw.data());
+  }
+  H5Sclose(file_space);
+  H5Sclose(memory_space);
+  if (err < 0 || this->time_handle == H5I_INVALID_HID) {
+    return err < 0 ? -1 : 0;
+  }
+
+  err = H5Dset_extent(this->time_handle, extent.data());
+  memory_space = H5Screate_simple(1, count.data(), nullptr);
+  file_space = H5Dget_space(this->time_handle);
+  H5Sselect_hyperslab(file_space,
+                      H5S_SELECT_SET,
+                      offset.data(),
+                      nullptr,
+                      count.data(),
+                      nullptr);
+  if (err >= 0) {
+    err = H5Dwrite(this->time_handle,
+                   H5T_NATIVE_INT64,
+                   memory_space,
+                   file_space,
+                   H5P_DEFAULT,
+                   this->current->time_raw.data());
+  }
+  H5Sclose(file_space);
+  H5Sclose(memory_space);
+  return err < 0 ? -1 : 0;
+}
+
+int DataRecorder::ChunkPipeline::close()
+{
+  if (!this->isOpen()) {
+    return 0;
+  }
+  this->commit_ready(0);
+  if (this->chunk_fill > 0 && this->write_partial() != 0) {
+    this->error = -1;
+  }
+  if (this->current != nullptr) {
+    this->spare_chunks.push_back(std::move(this->current));
+  }
+  this->data_handle = H5I_INVALID_HID;
+  this->time_handle = H5I_INVALID_HID;
+  this->chunk_fill = 0;
+  this->queued_rows = 0;
+  const int result = this->error;
+  this->error = 0;
+  return result;
+}
+
+int DataRecorder::ChunkPipeline::encode(const std::vector<char>& raw,
+                                        size_t element_size,
+                                        const chunk_filter_t& filter,
+                                        std::vector<char>& scratch,
+                                        std::vector<char>& packed)
+{
+  const std::vector<char>* source = &raw;
+  // Same layout as the H5Z shuffle filter: byte b of element e moves to
+  // b * element_count + e
+  if (filter.shuffle && element_size > 1) {
+    const size_t element_count = raw.size() / element_size;
+    scratch.resize(raw.size());
+    for (size_t byte = 0; byte < element_size; byte++) {
+      for (size_t element = 0; element < element_count; element++) {
+        scratch[(byte * element_count) + element] =
+            raw[(element * element_size) + byte];
+      }
+    }
+    source = &scratch;
+  }
+  if (filter.deflate_level < 0) {
+    packed.assign(source->begin(), source->end());
+    return 0;
+  }
+  uLongf packed_size = compressBound(source->size());
+  packed.resize(packed_size);
+  if (compress2(reinterpret_cast<Bytef*>(packed.data()),
+                &packed_size,
+                reinterpret_cast<const Bytef*>(source->data()),
+                source->size(),
+                filter.deflate_level)
+      != Z_OK)
+  {
+    return -1;
+  }
+  packed.resize(packed_size);
+  return 0;
+}
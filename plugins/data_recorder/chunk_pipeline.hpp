@@ -0,0 +1,195 @@
+/*
+         The Real-Time eXperiment Interface (RTXI)
+         Copyright (C) 2011 Georgia Institute of Technology, University of Utah,
+   Weill Cornell Medical College
+
+         This program is free software: you can redistribute it and/or modify
+         it under the terms of the GNU General Public License as published by
+         the Free Software Foundation, either version 3 of the License, or
+         (at your option) any later version.
+
+         This program is distributed in the hope that it will be useful,
+         but WITHOUT ANY WARRANTY; without even the implied warranty of
+         MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+         GNU General Public License for more details.
+
+         You should have received a copy of the GNU General Public License
+         along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+         Compresses the chunks of a recording on a pool of worker threads
+         and hands them to HDF5 already filtered through H5Dwrite_chunk.
+         Only the thread feeding the pipeline touches HDF5, the workers
+         only shuffle and deflate memory buffers.
+         */
+
+#ifndef CHUNK_PIPELINE_H
+#define CHUNK_PIPELINE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <hdf5.h>
+
+namespace DataRecorder
+{
+
+/*!
+ * Filters the pipeline can apply itself, in HDF5 pipeline order
+ */
+typedef struct chunk_filter_t
+{
+  bool shuffle = false; /*!< Byte shuffle on the element size */
+  int deflate_level = -1; /*!< zlib level, negative for no deflate */
+} chunk_filter_t;
+
+class ChunkPipeline
+{
+public:
+  /*!
+   * Starts the worker threads
+   *
+   * \param worker_count Number of compression threads
+   */
+  explicit ChunkPipeline(size_t worker_count);
+  ChunkPipeline(const ChunkPipeline&) = delete;
+  ChunkPipeline(ChunkPipeline&&) = delete;
+  ChunkPipeline& operator=(const ChunkPipeline&) = delete;
+  ChunkPipeline& operator=(ChunkPipeline&&) = delete;
+
+  /*!
+   * Stops the worker threads. Data not yet committed is discarded, call
+   * close() first to keep it.
+   */
+  ~ChunkPipeline();
+
+  /*!
+   * Starts writing frames to a pair of datasets
+   *
+   * The datasets must be empty, chunked by frames_per_chunk rows and
+   * created with exactly the filters described by set_filter. Values are
+   * written as little endian doubles and times as little endian 64 bit
+   * integers.
+   *
+   * \param data_set 2-D dataset receiving one row of values per frame
+   * \param time_set 1-D dataset receiving the frame times, or
+   *     H5I_INVALID_HID to drop them
+   * \param channels Number of values per frame
+   * \param frames_per_chunk Rows per chunk of both datasets
+   * \param set_filter Filters the datasets were created with
+   *
+   * \return 0 if successful, -1 if direct chunk writes can not be used
+   *     with these datasets on this machine
+   */
+  int open(hid_t data_set,
+           hid_t time_set,
+           hsize_t channels,
+           hsize_t frames_per_chunk,
+           const chunk_filter_t& set_filter);
+
+  /*!
+   * Queues interleaved frames for writing
+   *
+   * Frames are copied into the current chunk. Full chunks are compressed by
+   * the workers and committed in order by later calls.
+   *
+   * \param frames Frames laid out as an int64_t time followed by
+   *     channel_count doubles
+   * \param frame_count Number of frames
+   *
+   * \return 0 if successful, -1 if committing a chunk failed
+   */
+  int append(const void* frames, size_t frame_count);
+
+  /*!
+   * Commits every queued chunk, writes the partially filled last chunk
+   * through the regular filter pipeline and detaches from the datasets
+   *
+   * \return 0 if successful, -1 if any write failed
+   */
+  int close();
+
+  /*!
+   * Whether the pipeline is attached to a pair of datasets
+   */
+  bool isOpen() const { return this->data_handle != H5I_INVALID_HID; }
+
+  /*!
+   * Whether direct chunk writes can be used on this machine. Chunks bypass
+   * type conversion, so native types must match the file types.
+   */
+  static bool supported();
+
+  /*!
+   * Applies the filters to a buffer the way HDF5 would
+   *
+   * \param raw Unfiltered chunk
+   * \param element_size Size of one element, used by the shuffle
+   * \param filter Filters to apply
+   * \param scratch Buffer reused for the shuffle
+   * \param packed Receives the filtered chunk
+   *
+   * \return 0 if successful, -1 if compression failed
+   */
+  static int encode(const std::vector<char>& raw,
+                    size_t element_size,
+                    const chunk_filter_t& filter,
+                    std::vector<char>& scratch,
+                    std::vector<char>& packed);
+
+private:
+  struct chunk_t
+  {
+    hsize_t row = 0;
+    std::vector<char> data_raw;
+    std::vector<char> time_raw;
+    std::vector<char> data_packed;
+    std::vector<char> time_packed;
+    std::vector<char> scratch;
+  };
+
+  struct pending_t
+  {
+    std::unique_ptr<chunk_t> chunk;
+    std::future<int> encoded;
+  };
+
+  void worker_loop();
+  void submit();
+  int commit(pending_t& entry);
+  int commit_ready(size_t max_pending);
+  int write_partial();
+  std::unique_ptr<chunk_t> take_chunk();
+
+  hid_t data_handle = H5I_INVALID_HID;
+  hid_t time_handle = H5I_INVALID_HID;
+  hsize_t channel_count = 0;
+  hsize_t chunk_frames = 0;
+  chunk_filter_t filter;
+  hsize_t chunk_fill = 0;
+  hsize_t queued_rows = 0;
+  int error = 0;
+
+  std::unique_ptr<chunk_t> current;
+  std::vector<std::unique_ptr<chunk_t>> spare_chunks;
+  std::deque<pending_t> pending;
+
+  std::mutex job_mut;
+  std::condition_variable job_available;
+  std::deque<std::packaged_task<int()>> jobs;
+  bool running = true;
+  std::vector<std::thread> workers;
+};
+
+}  // namespace DataRecorder
+
+#endif /* CHUNK_PIPELINE_H */
@@ -25,10 +25,17 @@
 #include <QListWidget>
 #include <QMdiSubWindow>
 #include <QMessageBox>
+#include <QPointer>
 #include <QPushButton>
 #include <QSettings>
 #include <QSpinBox>
 #include <QTimer>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <random>
 #include <mutex>
 #include <string>
 
@@ -44,6 +51,67 @@
 #include "userprefs/userprefs.hpp"
 #include "widgets.hpp"
 
+bool DataRecorder::filter_available(COMPRESSION_FILTER filter)
+{
+  switch (filter) {
+    case NO_FILTER:
+      return true;
+    case DEFLATE:
+      return H5Zfilter_avail(H5Z_FILTER_DEFLATE) > 0;
+    case SHUFFLE_DEFLATE:
+      return H5Zfilter_avail(H5Z_FILTER_DEFLATE) > 0
+          && H5Zfilter_avail(H5Z_FILTER_SHUFFLE) > 0;
+    case LZ4:
+      return H5Zfilter_avail(DataRecorder::LZ4_FILTER_ID) > 0;
+    case ZSTD:
+      return H5Zfilter_avail(DataRecorder::ZSTD_FILTER_ID) > 0;
+    case BLOSC:
+      return H5Zfilter_avail(DataRecorder::BLOSC_FILTER_ID) > 0;
+    default:
+      return false;
+  }
+}
+
+hsize_t DataRecorder::auto_chunk_frames(int64_t period, size_t channel_count)
+{
+  hsize_t frames = DataRecorder::DEFAULT_CHUNK_FRAMES;
+  if (period > 0) {
+    frames = static_cast<hsize_t>(
+        std::chrono::nanoseconds(DataRecorder::CHUNK_DURATION).count()
+        / period);
+  }
+  const hsize_t max_frames = DataRecorder::MAX_CHUNK_BYTES
+      / (std::max<size_t>(channel_count, 1) * sizeof(double));
+  return std::clamp(frames,
+                    DataRecorder::MIN_CHUNK_FRAMES,
+                    std::max(max_frames, DataRecorder::MIN_CHUNK_FRAMES));
+}
+
+size_t DataRecorder::compression_worker_count()
+{
+  return std::clamp<size_t>(std::thread::hardware_concurrency() / 2,
+                            1,
+                            DataRecorder::MAX_COMPRESSION_WORKERS);
+}
+
+int DataRecorder::pipeline_filter(const storage_settings_t& settings,
+                                  chunk_filter_t& filter)
+{
+  filter = {};
+  switch (settings.filter) {
+    case NO_FILTER:
+      return 0;
+    case SHUFFLE_DEFLATE:
+      filter.shuffle = true;
+      [[fallthrough]];
+    case DEFLATE:
+      filter.deflate_level = std::clamp(settings.level, 0, 9);
+      return 0;
+    default:
+      return -1;
+  }
+}
+
 DataRecorder::Panel::Panel(QMainWindow* mwindow, Event::Manager* ev_manager)
     : Widgets::Panel(
           std::string(DataRecorder::MODULE_NAME), mwindow, ev_manager)
@@ -55,6 +123,7 @@ DataRecorder::Panel::Panel(QMainWindow* mwindow, Event::Manager* ev_manager)
     , selectionBox(new QListWidget)
     , recordStatus(new QLabel)
     , downsampleSpin(new QSpinBox(this))
+    , downsampleModeList(new QComboBox)
     , fileNameEdit(new QLineEdit)
     , timeStampEdit(new QLineEdit)
     , fileSizeLbl(new QLabel)
@@ -63,6 +132,11 @@ DataRecorder::Panel::Panel(QMainWindow* mwindow, Event::Manager* ev_manager)
     , trialLength(new QLabel)
     , trialNumLbl(new QLabel)
     , trialNum(new QLabel)
+    , filterList(new QComboBox)
+    , levelSpin(new QSpinBox(this))
+    , chunkSpin(new QSpinBox(this))
+    , benchmarkChannelsSpin(new QSpinBox(this))
+    , benchmarkResult(new QLabel)
     , recording_timer(new QTimer(this))
 {
   setWhatsThis(
@@ -205,16 +279,98 @@ DataRecorder::Panel::Panel(QMainWindow* mwindow, Event::Manager* ev_manager)
   fileLayout->addWidget(new QLabel(tr("Downsample \nRate:")));
 
   downsampleSpin->setMinimum(1);
-  downsampleSpin->setMaximum(500);
+  downsampleSpin->setMaximum(
+      static_cast<int>(DataRecorder::MAX_DOWNSAMPLE_FACTOR));
   fileLayout->addWidget(downsampleSpin);
   QObject::connect(downsampleSpin,
                    QOverload<int>::of(&QSpinBox::valueChanged),
                    this,
                    &DataRecorder::Panel::updateDownsampleRate);
 
+  for (int mode = 0; mode < DataRecorder::DOWNSAMPLE_MODE_COUNT; mode++) {
+    downsampleModeList->addItem(QString::fromStdString(
+        std::string(DataRecorder::downsample_name(
+            static_cast<DataRecorder::DOWNSAMPLE_MODE>(mode)))));
+  }
+  downsampleModeList->setToolTip(
+      tr("How frames are combined when downsampling. Decimation aliases "
+         "anything above the new Nyquist frequency; FIR Decimate filters it "
+         "out first."));
+  fileLayout->addWidget(downsampleModeList);
+  QObject::connect(downsampleModeList,
+                   QOverload<int>::of(&QComboBox::currentIndexChanged),
+                   this,
+                   &DataRecorder::Panel::updateDownsampleMode);
+
   // Attach layout to child
   fileGroup->setLayout(fileLayout);
 
+  // Create child widget and layout for storage settings
+  storageGroup = new QGroupBox(tr("Storage"));
+  auto* storageLayout = new QHBoxLayout;
+  const DataRecorder::storage_settings_t default_settings;
+
+  // Only offer filters HDF5 is able to load
+  storageLayout->addWidget(new QLabel(tr("Compression:")));
+  DataRecorder::COMPRESSION_FILTER filter_type = DataRecorder::NO_FILTER;
+  std::string_view filter_label;
+  for (int filter = 0; filter < DataRecorder::FILTER_COUNT; filter++) {
+    filter_type = static_cast<DataRecorder::COMPRESSION_FILTER>(filter);
+    if (!DataRecorder::filter_available(filter_type)) {
+      continue;
+    }
+    filter_label = DataRecorder::filter_name(filter_type);
+    filterList->addItem(
+        QString::fromUtf8(filter_label.data(),
+                          static_cast<int>(filter_label.size())),
+        QVariant::fromValue(filter));
+  }
+  filterList->setCurrentIndex(
+      filterList->findData(QVariant::fromValue(
+          static_cast<int>(default_settings.filter))));
+  storageLayout->addWidget(filterList);
+  QObject::connect(filterList,
+                   QOverload<int>::of(&QComboBox::activated),
+                   this,
+                   &DataRecorder::Panel::updateStorageSettings);
+
+  storageLayout->addWidget(new QLabel(tr("Level:")));
+  levelSpin->setMinimum(0);
+  levelSpin->setMaximum(22);
+  levelSpin->setValue(default_settings.level);
+  storageLayout->addWidget(levelSpin);
+  QObject::connect(levelSpin,
+                   QOverload<int>::of(&QSpinBox::valueChanged),
+                   this,
+                   &DataRecorder::Panel::updateStorageSettings);
+
+  storageLayout->addWidget(new QLabel(tr("Chunk \n(frames):")));
+  chunkSpin->setMinimum(0);
+  chunkSpin->setMaximum(1000000);
+  chunkSpin->setSpecialValueText("Auto");
+  chunkSpin->setValue(static_cast<int>(default_settings.chunk_frames));
+  storageLayout->addWidget(chunkSpin);
+  QObject::connect(chunkSpin,
+                   QOverload<int>::of(&QSpinBox::valueChanged),
+                   this,
+                   &DataRecorder::Panel::updateStorageSettings);
+
+  storageLayout->addWidget(new QLabel(tr("Benchmark \nChannels:")));
+  benchmarkChannelsSpin->setMinimum(1);
+  benchmarkChannelsSpin->setMaximum(1024);
+  benchmarkChannelsSpin->setValue(64);
+  storageLayout->addWidget(benchmarkChannelsSpin);
+  benchmarkButton = new QPushButton("Benchmark");
+  storageLayout->addWidget(benchmarkButton);
+  QObject::connect(benchmarkButton,
+                   &QPushButton::released,
+                   this,
+                   &DataRecorder::Panel::runStorageBenchmark);
+  storageLayout->addWidget(benchmarkResult);
+
+  // Attach layout to child
+  storageGroup->setLayout(storageLayout);
+
   // Create child widget and layout
   listGroup = new QGroupBox(tr("Currently Recording"));
   auto* listLayout = new QGridLayout;
@@ -263,8 +419,9 @@ DataRecorder::Panel::Panel(QMainWindow* mwindow, Event::Manager* ev_manager)
   layout->addWidget(listGroup, 0, 2, 1, 4);
   layout->addWidget(stampGroup, 2, 0, 2, 6);
   layout->addWidget(fileGroup, 4, 0, 1, 6);
-  layout->addWidget(sampleGroup, 5, 0, 1, 6);
-  layout->addWidget(buttonGroup, 6, 0, 1, 6);
+  layout->addWidget(storageGroup, 5, 0, 1, 6);
+  layout->addWidget(sampleGroup, 6, 0, 1, 6);
+  layout->addWidget(buttonGroup, 7, 0, 1, 6);
 
   setLayout(layout);
   setWindowTitle(tr(std::string(DataRecorder::MODULE_NAME).c_str()));
@@ -279,7 +436,7 @@ DataRecorder::Panel::Panel(QMainWindow* mwindow, Event::Manager* ev_manager)
   QObject::connect(recording_timer,
                    &QTimer::timeout,
                    this,
-                   &DataRecorder::Panel::processData);
+                   &DataRecorder::Panel::updateStatus);
   QObject::connect(this,
                    &DataRecorder::Panel::updateBlockInfo,
                    this,
@@ -296,6 +453,10 @@ DataRecorder::Panel::Panel(QMainWindow* mwindow, Event::Manager* ev_manager)
                    &DataRecorder::Panel::record_signal,
                    timeTagType,
                    &QComboBox::setDisabled);
+  QObject::connect(this,
+                   &DataRecorder::Panel::record_signal,
+                   storageGroup,
+                   &QGroupBox::setDisabled);
   recording_timer->start();
 }
 
@@ -488,6 +649,9 @@ void DataRecorder::Panel::startRecordClicked()
     this->trialNum->setNum(hplugin->getTrialCount());
     this->trialLength->setText("Recording...");
     this->timeTagType->setDisabled(true);
+    this->storageGroup->setDisabled(true);
+    this->downsampleSpin->setDisabled(true);
+    this->downsampleModeList->setDisabled(true);
   }
 }
 
@@ -506,6 +670,9 @@ void DataRecorder::Panel::stopRecordClicked()
         static_cast<double>(QFile(fileNameEdit->text()).size())
         / (1024.0 * 1024.0));
     this->timeTagType->setDisabled(false);
+    this->storageGroup->setDisabled(false);
+    this->downsampleSpin->setDisabled(false);
+    this->downsampleModeList->setDisabled(false);
   }
 }
 
@@ -513,6 +680,19 @@ void DataRecorder::Panel::stopRecordClicked()
 void DataRecorder::Panel::updateDownsampleRate(size_t rate)
 {
   this->downsample_rate = rate;
+  this->updateDownsampleMode(this->downsampleModeList->currentIndex());
+}
+
+void DataRecorder::Panel::updateDownsampleMode(int index)
+{
+  auto* hplugin = dynamic_cast<DataRecorder::Plugin*>(this->getHostPlugin());
+  if (hplugin->setDownsampling(
+          static_cast<DataRecorder::DOWNSAMPLE_MODE>(index),
+          this->downsample_rate)
+      != 0)
+  {
+    recordStatus->setText("Downsampling not applied");
+  }
 }
 
 void DataRecorder::Panel::removeRecorders(IO::Block* block)
@@ -531,10 +711,22 @@ void DataRecorder::Panel::removeRecorders(IO::Block* block)
   }
 }
 
-void DataRecorder::Panel::processData()
+// Data is written by the plugin's writer thread; the panel only reports on it
+void DataRecorder::Panel::updateStatus()
 {
   auto* hplugin = dynamic_cast<DataRecorder::Plugin*>(this->getHostPlugin());
-  hplugin->process_data_worker();
+  if (!hplugin->isRecording()) {
+    return;
+  }
+  const DataRecorder::writer_stats_t stats = hplugin->getWriterStats();
+  this->trialLength->setNum(
+      this->starting_record_time.secsTo(QTime::currentTime()));
+  if (stats.frames_dropped > 0 || stats.write_errors > 0) {
+    this->recordStatus->setText(
+        QString("Recording... (%1 dropped, %2 write errors)")
+            .arg(stats.frames_dropped)
+            .arg(stats.write_errors));
+  }
 }
 
 void DataRecorder::Panel::syncEnableRecordingButtons(const QString& /*unused*/)
@@ -556,6 +748,61 @@ void DataRecorder::Panel::setTimeTagType(int tag_type)
   };
 }
 
+void DataRecorder::Panel::updateStorageSettings()
+{
+  DataRecorder::storage_settings_t settings;
+  settings.filter = static_cast<DataRecorder::COMPRESSION_FILTER>(
+      filterList->currentData().value<int>());
+  settings.level = levelSpin->value();
+  settings.chunk_frames = static_cast<hsize_t>(chunkSpin->value());
+  auto* hplugin = dynamic_cast<DataRecorder::Plugin*>(this->getHostPlugin());
+  if (hplugin->setStorageSettings(settings) != 0) {
+    recordStatus->setText("Storage settings not applied");
+  }
+}
+
+void DataRecorder::Panel::runStorageBenchmark()
+{
+  auto* hplugin = dynamic_cast<DataRecorder::Plugin*>(this->getHostPlugin());
+  // The benchmark finishes on the writer thread, so the result is handed
+  // over to the Qt event loop that owns the panel
+  const QPointer<DataRecorder::Panel> panel = this;
+  const int err = hplugin->requestBenchmark(
+      hplugin->getStorageSettings(),
+      static_cast<size_t>(benchmarkChannelsSpin->value()),
+      [panel](int status, const DataRecorder::benchmark_result_t& result)
+      {
+        if (!panel.isNull()) {
+          QMetaObject::invokeMethod(
+              panel.data(),
+              [panel, status, result]()
+              { panel->showBenchmarkResult(status, result); },
+              Qt::QueuedConnection);
+        }
+      });
+  if (err != 0) {
+    benchmarkResult->setText("Benchmark failed");
+    return;
+  }
+  benchmarkButton->setEnabled(false);
+  benchmarkResult->setText("Running...");
+}
+
+void DataRecorder::Panel::showBenchmarkResult(
+    int status, const DataRecorder::benchmark_result_t& result)
+{
+  benchmarkButton->setEnabled(true);
+  if (status != 0) {
+    benchmarkResult->setText("Benchmark failed");
+    return;
+  }
+  // Anything under real time will drop data, aim well above it
+  benchmarkResult->setText(
+      QString("%1x real time, %2:1 compression")
+          .arg(result.realtime_factor, 0, 'f', 1)
+          .arg(result.compression_ratio, 0, 'f', 2));
+}
+
 DataRecorder::TIME_TAG_TYPE DataRecorder::Panel::getTimeTagType() const
 {
   return this->time_type;
@@ -564,21 +811,30 @@ DataRecorder::TIME_TAG_TYPE DataRecorder::Panel::getTimeTagType() const
 DataRecorder::Plugin::Plugin(Event::Manager* ev_manager)
     : Widgets::Plugin(ev_manager, std::string(DataRecorder::MODULE_NAME))
     , recording(false)
+    , m_pipeline(std::make_unique<DataRecorder::ChunkPipeline>(
+          DataRecorder::compression_worker_count()))
 {
+  this->writer_thread = std::thread(&DataRecorder::Plugin::writer_loop, this);
+  RT::OS::renameOSThread(this->writer_thread, std::string("RTXIRecorder"));
 }
 
 DataRecorder::Plugin::~Plugin()
 {
   this->stopRecording();
+  {
+    const std::unique_lock<std::mutex> lk(this->writer_mut);
+    this->writer_running.store(false);
+  }
+  this->writer_wake.notify_one();
+  this->writer_thread.join();
+  // closeFile writes out whatever the writer thread left in the fifo
   this->closeFile();
-  const Event::Type event_type = Event::Type::RT_THREAD_REMOVE_EVENT;
-  std::vector<Event::Object> unload_events;
-  for (auto& entry : this->m_recording_channels_list) {
-    unload_events.emplace_back(event_type);
-    unload_events.back().setParam(
-        "thread", std::any(static_cast<RT::Thread*>(entry.component.get())));
+  if (this->m_component != nullptr) {
+    Event::Object unload_event(Event::Type::RT_THREAD_REMOVE_EVENT);
+    unload_event.setParam(
+        "thread", std::any(static_cast<RT::Thread*>(this->m_component.get())));
+    this->getEventManager()->postEvent(&unload_event);
   }
-  this->getEventManager()->postEvent(unload_events);
 }
 
 void DataRecorder::Plugin::receiveEvent(Event::Object* event)
@@ -590,9 +846,9 @@ void DataRecorder::Plugin::receiveEvent(Event::Object* event)
     case Event::Type::RT_DEVICE_REMOVE_EVENT:
       dynamic_cast<DataRecorder::Panel*>(this->getPanel())
           ->removeRecorders(block);
-      for (const auto& entry : this->m_recording_channels_list) {
-        if (entry.channel.endpoint.block == block) {
-          endpoints.push_back(entry.channel.endpoint);
+      for (const auto& channel : this->get_recording_channels()) {
+        if (channel.endpoint.block == block) {
+          endpoints.push_back(channel.endpoint);
         }
       }
       for (const auto& endpoint : endpoints) {
@@ -617,28 +873,29 @@ void DataRecorder::Plugin::receiveEvent(Event::Object* event)
   }
 }
 
+std::vector<Event::Type> DataRecorder::Plugin::subscriptions() const
+{
+  return {Event::Type::RT_THREAD_INSERT_EVENT,
+          Event::Type::RT_THREAD_REMOVE_EVENT,
+          Event::Type::RT_DEVICE_INSERT_EVENT,
+          Event::Type::RT_DEVICE_REMOVE_EVENT,
+          Event::Type::START_RECORDING_EVENT,
+          Event::Type::STOP_RECORDING_EVENT};
+}
+
 void DataRecorder::Plugin::startRecording()
 {
-  if (this->recording.load() || this->m_recording_channels_list.empty()) {
+  if (this->recording.load() || this->m_component == nullptr) {
     return;
   }
+  // Used to size the chunks of the new trial
+  const int64_t period = this->queryPeriod();
   const std::unique_lock<std::shared_mutex> lk(this->m_channels_list_mut);
+  this->m_period = period;
+  // Frames left over from before the trial do not belong to it
+  this->discard_pending_data();
   this->append_new_trial();
-  const Event::Type event_type = Event::Type::RT_THREAD_UNPAUSE_EVENT;
-  const Event::Type unpause_event_type =
-      Event::Type::RT_WIDGET_STATE_CHANGE_EVENT;
-  std::vector<Event::Object> start_recording_event;
-  for (auto& rec_channel : this->m_recording_channels_list) {
-    start_recording_event.emplace_back(unpause_event_type);
-    start_recording_event.back().setParam(
-        "component",
-        static_cast<Widgets::Component*>(rec_channel.component.get()));
-    start_recording_event.back().setParam("state", RT::State::UNPAUSE);
-    start_recording_event.emplace_back(event_type);
-    start_recording_event.back().setParam(
-        "thread", static_cast<RT::Thread*>(rec_channel.component.get()));
-  }
-  this->getEventManager()->postEvent(start_recording_event);
+  this->post_component_state(RT::State::UNPAUSE);
   this->recording.store(true);
 }
 
@@ -648,24 +905,37 @@ void DataRecorder::Plugin::stopRecording()
     return;
   }
   const std::unique_lock<std::shared_mutex> lk(this->m_channels_list_mut);
-  const Event::Type event_type = Event::Type::RT_THREAD_PAUSE_EVENT;
-  const Event::Type pause_event_type =
-      Event::Type::RT_WIDGET_STATE_CHANGE_EVENT;
-  std::vector<Event::Object> stop_recording_event;
-  for (auto& rec_chan : this->m_recording_channels_list) {
-    stop_recording_event.emplace_back(pause_event_type);
-    stop_recording_event.back().setParam(
-        "component",
-        static_cast<Widgets::Component*>(rec_chan.component.get()));
-    stop_recording_event.back().setParam("state", RT::State::PAUSE);
-    stop_recording_event.emplace_back(event_type);
-    stop_recording_event.back().setParam(
-        "thread", static_cast<RT::Thread*>(rec_chan.component.get()));
-  }
-  this->getEventManager()->postEvent(stop_recording_event);
+  if (this->m_component != nullptr) {
+    this->post_component_state(RT::State::PAUSE);
+  }
+  // Don't leave a partially filled chunk in memory between trials
+  this->write_pending_data();
+  if (this->m_pipeline->close() != 0) {
+    ERROR_MSG(
+        "DataRecorder::Plugin::stopRecording : Unable to write all data of "
+        "trial {}",
+        this->trial_count);
+    this->write_errors.fetch_add(1);
+  }
   this->recording.store(false);
 }
 
+// Callers hold m_channels_list_mut
+void DataRecorder::Plugin::post_component_state(RT::State::state_t state)
+{
+  std::vector<Event::Object> state_events;
+  state_events.emplace_back(Event::Type::RT_WIDGET_STATE_CHANGE_EVENT);
+  state_events.back().setParam(
+      "component", static_cast<Widgets::Component*>(this->m_component.get()));
+  state_events.back().setParam("state", state);
+  state_events.emplace_back(state == RT::State::UNPAUSE
+                                ? Event::Type::RT_THREAD_UNPAUSE_EVENT
+                                : Event::Type::RT_THREAD_PAUSE_EVENT);
+  state_events.back().setParam(
+      "thread", static_cast<RT::Thread*>(this->m_component.get()));
+  this->getEventManager()->postEvent(state_events);
+}
+
 bool DataRecorder::Plugin::changeIndexingType(int tag_type)
 {
   // We only change the index type while not recording!
@@ -681,37 +951,52 @@ bool DataRecorder::Plugin::changeIndexingType(int tag_type)
         "Unable to change index type");
     return false;
   }
-  std::vector<Event::Object> change_index_type_events;
-  change_index_type_events.reserve(this->m_recording_channels_list.size());
-  for (auto& rec_chan : this->m_recording_channels_list) {
-    change_index_type_events.emplace_back(
+  DataRecorder::Component* component = nullptr;
+  {
+    const std::shared_lock<std::shared_mutex> lk(this->m_channels_list_mut);
+    component = this->m_component.get();
+  }
+  if (component != nullptr) {
+    Event::widget_parameter_payload_t payload;
+    payload.component = component;
+    payload.id = static_cast<size_t>(PARAMETER::INDEXING);
+    payload.type = Widgets::Variable::UINT_PARAMETER;
+    payload.value = static_cast<uint64_t>(tag_type);
+    Event::Object change_index_type_event(
         Event::Type::RT_WIDGET_PARAMETER_CHANGE_EVENT);
-    change_index_type_events.back().setParam(
-        "paramID", std::any(static_cast<size_t>(PARAMETER::INDEXING)));
-    change_index_type_events.back().setParam(
-        "paramType", std::any(Widgets::Variable::UINT_PARAMETER));
-    change_index_type_events.back().setParam(
-        "paramValue", std::any(static_cast<uint64_t>(tag_type)));
-    change_index_type_events.back().setParam(
-        "paramWidget",
-        std::any(static_cast<Widgets::Component*>(rec_chan.component.get())));
-  }
-  this->getEventManager()->postEvent(change_index_type_events);
+    change_index_type_event.setPayload(payload);
+    this->getEventManager()->postEvent(&change_index_type_event);
+  }
+  this->time_tag_type.store(static_cast<TIME_TAG_TYPE>(tag_type));
 
   return true;
 }
 
+void DataRecorder::Plugin::close_frame_datasets()
+{
+  if (this->m_pipeline->close() != 0) {
+    ERROR_MSG(
+        "DataRecorder::Plugin::close_frame_datasets : Unable to write all "
+        "data of trial {}",
+        this->trial_count);
+    this->write_errors.fetch_add(1);
+  }
+  if (this->hdf5_handles.time_handle != H5I_INVALID_HID) {
+    H5Dclose(this->hdf5_handles.time_handle);
+    this->hdf5_handles.time_handle = H5I_INVALID_HID;
+  }
+  if (this->hdf5_handles.data_handle != H5I_INVALID_HID) {
+    H5Dclose(this->hdf5_handles.data_handle);
+    this->hdf5_handles.data_handle = H5I_INVALID_HID;
+  }
+}
+
 void DataRecorder::Plugin::close_trial_group()
 {
   if (!open_file.load()) {
     return;
   }
-  for (auto& channel : this->m_recording_channels_list) {
-    if (channel.hdf5_data_handle != H5I_INVALID_HID) {
-      H5PTclose(channel.hdf5_data_handle);
-      channel.hdf5_data_handle = H5I_INVALID_HID;
-    }
-  }
+  this->close_frame_datasets();
   if (this->hdf5_handles.sync_group_handle != H5I_INVALID_HID) {
     H5Gclose(this->hdf5_handles.sync_group_handle);
     this->hdf5_handles.sync_group_handle = H5I_INVALID_HID;
@@ -730,10 +1015,201 @@ void DataRecorder::Plugin::close_trial_group()
   }
 }
 
+// Creates the Data dataset, one row per frame and one column per channel,
+// and the Time dataset holding the index or timestamp of each row
+void DataRecorder::Plugin::open_frame_datasets()
+{
+  const hsize_t channel_count = this->m_recording_channels_list.size();
+  this->trial_frame_count = 0;
+  if (channel_count == 0) {
+    return;
+  }
+  this->m_downsampler.configure(
+      this->m_downsample_mode, this->m_downsample_factor, channel_count);
+  storage_settings_t settings = this->m_storage_settings;
+  if (settings.chunk_frames == 0) {
+    // Chunks hold a second of stored, not recorded, frames
+    settings.chunk_frames = DataRecorder::auto_chunk_frames(
+        this->m_period > 0
+            ? this->m_period * static_cast<int64_t>(this->m_downsample_factor)
+            : this->m_period,
+        channel_count);
+  }
+  this->hdf5_handles.data_handle =
+      DataRecorder::Plugin::create_frame_dataset(
+          this->hdf5_handles.sync_group_handle,
+          "Data",
+          H5T_IEEE_F64LE,
+          channel_count,
+          settings);
+  if (this->hdf5_handles.data_handle == H5I_INVALID_HID) {
+    ERROR_MSG(
+        "DataRecorder::Plugin::open_frame_datasets : Unable to create data "
+        "set for trial {}",
+        this->trial_count);
+    return;
+  }
+
+  // Name the columns so channels can be identified when reading the file
+  std::vector<const char*> channel_names;
+  channel_names.reserve(channel_count);
+  for (const auto& channel : this->m_recording_channels_list) {
+    channel_names.push_back(channel.name.c_str());
+  }
+  const std::array<hsize_t, 1> name_dims = {channel_count};
+  const hid_t string_type = H5Tcopy(H5T_C_S1);
+  H5Tset_size(string_type, H5T_VARIABLE);
+  const hid_t space = H5Screate_simple(1, name_dims.data(), nullptr);
+  const hid_t attribute = H5Acreate(this->hdf5_handles.data_handle,
+                                    "Channels",
+                                    string_type,
+                                    space,
+                                    H5P_DEFAULT,
+                                    H5P_DEFAULT);
+  H5Awrite(attribute, string_type, channel_names.data());
+  H5Aclose(attribute);
+  H5Sclose(space);
+
+  // Readers need these to recover the time base of the stored frames
+  const std::string mode_name(
+      DataRecorder::downsample_name(this->m_downsample_mode));
+  const char* mode_label = mode_name.c_str();
+  const auto factor = static_cast<uint64_t>(this->m_downsample_factor);
+  const hid_t scalar_space = H5Screate(H5S_SCALAR);
+  const hid_t mode_attribute = H5Acreate(this->hdf5_handles.data_handle,
+                                         "Downsample Mode",
+                                         string_type,
+                                         scalar_space,
+                                         H5P_DEFAULT,
+                                         H5P_DEFAULT);
+  H5Awrite(mode_attribute, string_type, &mode_label);
+  H5Aclose(mode_attribute);
+  const hid_t factor_attribute = H5Acreate(this->hdf5_handles.data_handle,
+                                           "Downsample Factor",
+                                           H5T_STD_U64LE,
+                                           scalar_space,
+                                           H5P_DEFAULT,
+                                           H5P_DEFAULT);
+  H5Awrite(factor_attribute, H5T_NATIVE_UINT64, &factor);
+  H5Aclose(factor_attribute);
+  H5Sclose(scalar_space);
+  H5Tclose(string_type);
+
+  if (this->time_tag_type.load() != NONE) {
+    this->hdf5_handles.time_handle =
+        DataRecorder::Plugin::create_frame_dataset(
+            this->hdf5_handles.sync_group_handle,
+            "Time",
+            H5T_STD_I64LE,
+            /*channel_count=*/0,
+            settings);
+  }
+
+  // Filters that only exist as HDF5 plugins are applied by HDF5 itself
+  DataRecorder::chunk_filter_t filter;
+  if (DataRecorder::pipeline_filter(settings, filter) == 0
+      && DataRecorder::filter_available(settings.filter))
+  {
+    this->m_pipeline->open(this->hdf5_handles.data_handle,
+                           this->hdf5_handles.time_handle,
+                           channel_count,
+                           settings.chunk_frames,
+                           filter);
+  }
+}
+
+// A channel count of zero creates the one dimensional Time dataset
+hid_t DataRecorder::Plugin::create_frame_dataset(
+    hid_t group,
+    const char* name,
+    hid_t type,
+    hsize_t channel_count,
+    const storage_settings_t& settings)
+{
+  const int rank = channel_count == 0 ? 1 : 2;
+  const std::array<hsize_t, 2> dims = {0, channel_count};
+  const std::array<hsize_t, 2> max_dims = {H5S_UNLIMITED, channel_count};
+  const std::array<hsize_t, 2> chunk_dims = {settings.chunk_frames,
+                                             channel_count};
+  const hid_t space = H5Screate_simple(rank, dims.data(), max_dims.data());
+  const hid_t create_properties = H5Pcreate(H5P_DATASET_CREATE);
+  H5Pset_chunk(create_properties, rank, chunk_dims.data());
+  DataRecorder::Plugin::set_filters(create_properties, settings);
+  // Keep a few chunks in the cache so partially filled chunks are only
+  // compressed once they are complete
+  const hid_t access_properties = H5Pcreate(H5P_DATASET_ACCESS);
+  H5Pset_chunk_cache(access_properties,
+                     H5D_CHUNK_CACHE_NSLOTS_DEFAULT,
+                     4 * DataRecorder::MAX_CHUNK_BYTES,
+                     H5D_CHUNK_CACHE_W0_DEFAULT);
+  const hid_t dataset = H5Dcreate(group,
+                                  name,
+                                  type,
+                                  space,
+                                  H5P_DEFAULT,
+                                  create_properties,
+                                  access_properties);
+  H5Pclose(access_properties);
+  H5Pclose(create_properties);
+  H5Sclose(space);
+  return dataset;
+}
+
+int DataRecorder::Plugin::set_filters(hid_t properties,
+                                      const storage_settings_t& settings)
+{
+  if (!DataRecorder::filter_available(settings.filter)) {
+    ERROR_MSG(
+        "DataRecorder::Plugin::set_filters : {} filter is not available. "
+        "Data will be stored uncompressed",
+        DataRecorder::filter_name(settings.filter));
+    return -1;
+  }
+  const auto level = static_cast<unsigned int>(std::max(settings.level, 0));
+  // Blosc fills in the first four values itself
+  std::array<unsigned int, 7> blosc_values {};
+  switch (settings.filter) {
+    case NO_FILTER:
+      break;
+    case SHUFFLE_DEFLATE:
+      H5Pset_shuffle(properties);
+      [[fallthrough]];
+    case DEFLATE:
+      H5Pset_deflate(properties, std::min(level, 9U));
+      break;
+    case LZ4:
+      H5Pset_filter(properties,
+                    DataRecorder::LZ4_FILTER_ID,
+                    H5Z_FLAG_MANDATORY,
+                    0,
+                    nullptr);
+      break;
+    case ZSTD:
+      H5Pset_filter(properties,
+                    DataRecorder::ZSTD_FILTER_ID,
+                    H5Z_FLAG_MANDATORY,
+                    1,
+                    &level);
+      break;
+    case BLOSC:
+      blosc_values[4] = std::min(level, 9U);
+      blosc_values[5] = 1;  // byte shuffle
+      blosc_values[6] = 1;  // lz4 codec
+      H5Pset_filter(properties,
+                    DataRecorder::BLOSC_FILTER_ID,
+                    H5Z_FLAG_MANDATORY,
+                    blosc_values.size(),
+                    blosc_values.data());
+      break;
+    default:
+      return -1;
+  }
+  return 0;
+}
+
 void DataRecorder::Plugin::open_trial_group()
 {
   this->trial_count += 1;
-  hid_t compression_property = H5I_INVALID_HID;
   std::string trial_name = "/Trial";
   trial_name += std::to_string(this->trial_count);
   this->hdf5_handles.trial_group_handle =
@@ -760,49 +1236,27 @@ void DataRecorder::Plugin::open_trial_group()
                 H5P_DEFAULT,
                 H5P_DEFAULT,
                 H5P_DEFAULT);
-  const TIME_TAG_TYPE data_type =
-      dynamic_cast<DataRecorder::Panel*>(this->getPanel())->getTimeTagType();
-  if (data_type == NONE) {
-    for (auto& channel : this->m_recording_channels_list) {
-      compression_property = H5Pcreate(H5P_DATASET_CREATE);
-      H5Pset_deflate(compression_property, 7);
-      channel.hdf5_data_handle =
-          H5PTcreate(this->hdf5_handles.sync_group_handle,
-                     channel.channel.name.c_str(),
-                     H5T_IEEE_F64LE,
-                     this->m_data_chunk_size,
-                     compression_property);
-    }
-  } else {
-    for (auto& channel : this->m_recording_channels_list) {
-      compression_property = H5Pcreate(H5P_DATASET_CREATE);
-      H5Pset_deflate(compression_property, 7);
-      channel.hdf5_data_handle =
-          H5PTcreate(this->hdf5_handles.sync_group_handle,
-                     channel.channel.name.c_str(),
-                     this->hdf5_handles.channel_index_datatype_handle,
-                     this->m_data_chunk_size,
-                     compression_property);
-    }
-  }
+  this->open_frame_datasets();
 }
 
 void DataRecorder::Plugin::append_new_trial()
 {
   this->close_trial_group();
-  // We have to flush all of the data from the buffers that did not make it
-  std::array<data_token_t, 100> tempbuffer {};
-  for (auto& recorder : this->m_recording_channels_list) {
-    while (recorder.channel.data_source->read(
-               tempbuffer.data(),
-               sizeof(DataRecorder::data_token_t) * tempbuffer.size())
-           > 0)
-    {
-    }
-  }
   this->open_trial_group();
 }
 
+// Expects m_channels_list_mut to be held by the caller
+void DataRecorder::Plugin::discard_pending_data()
+{
+  if (this->m_component == nullptr) {
+    return;
+  }
+  RT::OS::Fifo* fifo = this->m_component->get_fifo();
+  while (fifo->read(this->frame_buffer.data(), this->frame_buffer.size()) > 0)
+  {
+  }
+}
+
 void DataRecorder::Plugin::openFile(const std::string& file_name)
 {
   if (this->open_file.load()) {
@@ -820,16 +1274,9 @@ void DataRecorder::Plugin::openFile(const std::string& file_name)
   }
   this->hdf5_filename = file_name;
   this->trial_count = 0;
-  this->hdf5_handles.channel_index_datatype_handle =
-      H5Tcreate(H5T_COMPOUND, sizeof(DataRecorder::data_token_t));
-  H5Tinsert(this->hdf5_handles.channel_index_datatype_handle,
-            "time",
-            HOFFSET(DataRecorder::data_token_t, time),
-            H5T_STD_I64LE);
-  H5Tinsert(this->hdf5_handles.channel_index_datatype_handle,
-            "value",
-            HOFFSET(DataRecorder::data_token_t, value),
-            H5T_IEEE_F64LE);
+  this->frames_written.store(0);
+  this->write_errors.store(0);
+  this->max_fifo_fill.store(0);
   this->open_file.store(true);
 }
 
@@ -839,10 +1286,10 @@ void DataRecorder::Plugin::closeFile()
     return;
   }
   const std::unique_lock<std::shared_mutex> lk(this->m_channels_list_mut);
+  this->write_pending_data();
   // Attempt to close all group and dataset handles in hdf5 before closing
   // file
   close_trial_group();
-  H5Tclose(this->hdf5_handles.channel_index_datatype_handle);
   if (H5Fclose(this->hdf5_handles.file_handle) != 0) {
     ERROR_MSG("DataRecorder::Plugin::closeFile : Unable to close file {}",
               this->hdf5_filename);
@@ -861,11 +1308,13 @@ int DataRecorder::Plugin::create_component(IO::endpoint endpoint)
   if (endpoint.block == nullptr) {
     return -1;
   }
-  auto iter = std::find_if(this->m_recording_channels_list.begin(),
-                           this->m_recording_channels_list.end(),
-                           [endpoint](const recorder_t& rec)
-                           { return rec.channel.endpoint == endpoint; });
-  if (iter != this->m_recording_channels_list.end()) {
+  std::vector<DataRecorder::record_channel> channels =
+      this->get_recording_channels();
+  auto iter = std::find_if(channels.begin(),
+                           channels.end(),
+                           [endpoint](const record_channel& chan)
+                           { return chan.endpoint == endpoint; });
+  if (iter != channels.end()) {
     return 0;
   }
   DataRecorder::record_channel chan;
@@ -876,63 +1325,106 @@ int DataRecorder::Plugin::create_component(IO::endpoint endpoint)
   chan.name += endpoint.direction == IO::INPUT ? "INPUT" : "OUTPUT";
   chan.name += " ";
   chan.name += std::to_string(endpoint.port);
-  chan.name += " ";
-  chan.name += "Recording Component";
   chan.endpoint = endpoint;
-  std::unique_ptr<DataRecorder::Component> component =
-      std::make_unique<DataRecorder::Component>(this, chan.name);
-  chan.data_source = component->get_fifo();
-  Event::Object event(Event::Type::RT_THREAD_INSERT_EVENT);
-  component->setActive(this->recording.load());
-  event.setParam("thread", static_cast<RT::Thread*>(component.get()));
-  this->getEventManager()->postEvent(&event);
-  RT::block_connection_t connection;
-  connection.src = endpoint.block;
-  connection.src_port_type = endpoint.direction;
-  connection.src_port = endpoint.port;
-  connection.dest = component.get();
-  connection.dest_port = 0;  // Recording components only have one input
-  Event::Object connect_event(Event::Type::IO_LINK_INSERT_EVENT);
-  connect_event.setParam("connection", std::any(connection));
-  this->getEventManager()->postEvent(&connect_event);
-  hid_t data_handle = H5I_INVALID_HID;
-  const std::unique_lock<std::shared_mutex> lk(this->m_channels_list_mut);
-  // if (this->hdf5_handles.file_handle != H5I_INVALID_HID
-  //     && this->hdf5_handles.sync_group_handle != H5I_INVALID_HID)
-  // {
-  //   const hid_t compression_property = H5Pcreate(H5P_DATASET_CREATE);
-  //   H5Pset_deflate(compression_property, 7);
-  //   data_handle = H5PTcreate(this->hdf5_handles.sync_group_handle,
-  //                            chan.name.c_str(),
-  //                            this->hdf5_handles.channel_index_datatype_handle,
-  //                            this->m_data_chunk_size,
-  //                            compression_property);
-  // }
-  this->m_recording_channels_list.emplace_back(
-      chan, std::move(component), data_handle);
-  return 0;
+  channels.push_back(chan);
+  return this->rebuild_component(channels);
 }
 
 void DataRecorder::Plugin::destroy_component(IO::endpoint endpoint)
 {
-  DataRecorder::Component* component = this->getRecorderPtr(endpoint);
-  Event::Object pause_event(Event::Type::RT_THREAD_PAUSE_EVENT);
-  pause_event.setParam("thread", static_cast<RT::Thread*>(component));
-  this->getEventManager()->postEvent(&pause_event);
-  Event::Object unplug_event(Event::Type::RT_THREAD_REMOVE_EVENT);
-  unplug_event.setParam("thread", static_cast<RT::Thread*>(component));
-  this->getEventManager()->postEvent(&unplug_event);
-  const std::unique_lock<std::shared_mutex> recorder_lock(
-      this->m_channels_list_mut);
-  auto iter = std::find_if(this->m_recording_channels_list.begin(),
-                           this->m_recording_channels_list.end(),
-                           [component](const recorder_t& rec_chan)
-                           { return rec_chan.component.get() == component; });
-  if (iter == this->m_recording_channels_list.end()) {
+  std::vector<DataRecorder::record_channel> channels =
+      this->get_recording_channels();
+  auto iter = std::find_if(channels.begin(),
+                           channels.end(),
+                           [endpoint](const record_channel& chan)
+                           { return chan.endpoint == endpoint; });
+  if (iter == channels.end()) {
     return;
   }
-  H5PTclose(iter->hdf5_data_handle);
-  this->m_recording_channels_list.erase(iter);
+  channels.erase(iter);
+  this->rebuild_component(channels);
+}
+
+// Blocks have a fixed set of ports, so changing the recorded channels
+// replaces the recording component with one that has an input per channel.
+// A recording in progress continues in a new trial with the new columns.
+int DataRecorder::Plugin::rebuild_component(
+    const std::vector<record_channel>& channels)
+{
+  std::unique_ptr<DataRecorder::Component> component;
+  if (!channels.empty()) {
+    std::vector<IO::channel_t> inputs;
+    inputs.reserve(channels.size());
+    for (const auto& chan : channels) {
+      inputs.push_back({chan.name, "Recorded channel", IO::INPUT});
+    }
+    component = std::make_unique<DataRecorder::Component>(
+        this, "Recording Component", inputs);
+    if (component->get_fifo() == nullptr) {
+      return -1;
+    }
+    component->setValue(PARAMETER::INDEXING,
+                        static_cast<uint64_t>(this->time_tag_type.load()));
+    // Paused until its trial exists. The insertion and its links go in one
+    // batch, so the links reach the real-time loop as a single update.
+    component->setActive(/*act=*/false);
+    std::vector<Event::Object> connect_events;
+    connect_events.emplace_back(Event::Type::RT_THREAD_INSERT_EVENT);
+    connect_events.back().setParam("thread",
+                                   static_cast<RT::Thread*>(component.get()));
+    RT::block_connection_t connection;
+    for (size_t port = 0; port < channels.size(); port++) {
+      connection.src = channels[port].endpoint.block;
+      connection.src_port_type = channels[port].endpoint.direction;
+      connection.src_port = channels[port].endpoint.port;
+      connection.dest = component.get();
+      connection.dest_port = port;
+      connect_events.emplace_back(Event::Type::IO_LINK_INSERT_EVENT);
+      connect_events.back().setParam("connection", std::any(connection));
+    }
+    std::vector<Event::Object*> batch;
+    batch.reserve(connect_events.size());
+    for (auto& event : connect_events) {
+      batch.push_back(&event);
+    }
+    Event::Object batch_event(Event::Type::RT_COMMAND_BATCH_EVENT);
+    batch_event.setParam("events", std::any(batch));
+    this->getEventManager()->postEvent(&batch_event);
+  }
+
+  RT::Thread* old_thread = nullptr;
+  {
+    const std::shared_lock<std::shared_mutex> lk(this->m_channels_list_mut);
+    old_thread = this->m_component.get();
+  }
+  if (old_thread != nullptr) {
+    // Removing the thread also drops its connections. Once the event is
+    // handled the old component no longer writes to its fifo.
+    Event::Object unplug_event(Event::Type::RT_THREAD_REMOVE_EVENT);
+    unplug_event.setParam("thread", old_thread);
+    this->getEventManager()->postEvent(&unplug_event);
+  }
+
+  std::unique_ptr<DataRecorder::Component> old_component;
+  {
+    const std::unique_lock<std::shared_mutex> lk(this->m_channels_list_mut);
+    // Whatever the old component recorded belongs to the old data sets
+    this->write_pending_data();
+    this->close_frame_datasets();
+    old_component = std::move(this->m_component);
+    this->m_component = std::move(component);
+    this->m_recording_channels_list = channels;
+    this->frame_buffer.resize(this->m_data_chunk_size
+                              * DataRecorder::frame_size(channels.size()));
+    if (this->recording.load() && this->m_component != nullptr) {
+      if (this->open_file.load()) {
+        this->append_new_trial();
+      }
+      // The first frame of the new component starts the new trial
+      this->post_component_state(RT::State::UNPAUSE);
+    }
+  }
+  return 0;
 }
 
 std::string DataRecorder::Plugin::getRecorderName(IO::endpoint endpoint)
@@ -940,12 +1432,12 @@ std::string DataRecorder::Plugin::getRecorderName(IO::endpoint endpoint)
   const std::shared_lock<std::shared_mutex> lk(this->m_channels_list_mut);
   auto iter = std::find_if(this->m_recording_channels_list.begin(),
                            this->m_recording_channels_list.end(),
-                           [endpoint](const recorder_t& rec_chan)
-                           { return rec_chan.channel.endpoint == endpoint; });
+                           [endpoint](const record_channel& chan)
+                           { return chan.endpoint == endpoint; });
   if (iter == this->m_recording_channels_list.end()) {
     return "";
   }
-  return iter->channel.name;
+  return iter->name;
 }
 
 DataRecorder::Component* DataRecorder::Plugin::getRecorderPtr(
@@ -954,24 +1446,19 @@ DataRecorder::Component* DataRecorder::Plugin::getRecorderPtr(
   const std::shared_lock<std::shared_mutex> lk(this->m_channels_list_mut);
   auto iter = std::find_if(this->m_recording_channels_list.begin(),
                            this->m_recording_channels_list.end(),
-                           [endpoint](const recorder_t& rec_chan)
-                           { return rec_chan.channel.endpoint == endpoint; });
+                           [endpoint](const record_channel& chan)
+                           { return chan.endpoint == endpoint; });
   if (iter == this->m_recording_channels_list.end()) {
     return nullptr;
   }
-  return iter->component.get();
+  return this->m_component.get();
 }
 
 std::vector<DataRecorder::record_channel>
 DataRecorder::Plugin::get_recording_channels()
 {
   const std::shared_lock<std::shared_mutex> lk(this->m_channels_list_mut);
-  std::vector<DataRecorder::record_channel> result(
-      this->m_recording_channels_list.size());
-  for (size_t i = 0; i < result.size(); i++) {
-    result[i] = this->m_recording_channels_list[i].channel;
-  }
-  return result;
+  return this->m_recording_channels_list;
 }
 
 int DataRecorder::Plugin::apply_tag(const std::string& tag)
@@ -1001,111 +1488,454 @@ void DataRecorder::Plugin::process_data_worker()
   if (!this->open_file) {
     return;
   }
-  std::vector<DataRecorder::data_token_t> data_buffer(this->m_data_chunk_size);
-  std::vector<double> data_buffer_doubles;
-  data_buffer_doubles.reserve(this->m_data_chunk_size);
-  const size_t packet_byte_size = sizeof(DataRecorder::data_token_t);
-  int64_t read_bytes = 0;
-  size_t packet_count = 0;
-  const TIME_TAG_TYPE time_type =
-      dynamic_cast<DataRecorder::Panel*>(this->getPanel())->getTimeTagType();
   const std::shared_lock<std::shared_mutex> lk(this->m_channels_list_mut);
-  switch (time_type) {
-    case INDEX:
-    case TIME:
-      for (auto& channel : this->m_recording_channels_list) {
-        while (read_bytes = channel.channel.data_source->read(
-                   data_buffer.data(), packet_byte_size * data_buffer.size()),
-               read_bytes > 0)
-        {
-          packet_count = static_cast<size_t>(read_bytes) / packet_byte_size;
-          DataRecorder::Plugin::save_data(
-              channel.hdf5_data_handle, data_buffer, packet_count);
-        }
-      }
-      break;
-    case NONE:
-      for (auto& channel : this->m_recording_channels_list) {
-        while (read_bytes = channel.channel.data_source->read(
-                   data_buffer.data(), packet_byte_size * data_buffer.size()),
-               read_bytes > 0)
-        {
-          packet_count = static_cast<size_t>(read_bytes) / packet_byte_size;
-          if (packet_count > data_buffer_doubles.size()) {
-            data_buffer_doubles.resize(packet_count);
-          }
-          for (size_t i = 0; i < packet_count; i++) {
-            data_buffer_doubles.at(i) = data_buffer.at(i).value;
-          }
-          DataRecorder::Plugin::save_data(
-              channel.hdf5_data_handle, data_buffer_doubles, packet_count);
-          data_buffer_doubles.clear();
-        }
-      }
-      break;
-    default:
-      ERROR_MSG(
-          "DataRecorder::Plugin::process_data_worker : Bad time tagging type "
-          "detected. Unable to save data to hdf5 file");
-      break;
+  this->write_pending_data();
+}
+
+DataRecorder::writer_stats_t DataRecorder::Plugin::getWriterStats()
+{
+  DataRecorder::writer_stats_t stats;
+  stats.frames_written = this->frames_written.load();
+  stats.write_errors = this->write_errors.load();
+  stats.max_fifo_fill = this->max_fifo_fill.load();
+  const std::shared_lock<std::shared_mutex> lk(this->m_channels_list_mut);
+  if (this->m_component != nullptr) {
+    stats.frames_dropped = this->m_component->getDroppedCount();
   }
+  return stats;
 }
 
-void DataRecorder::Plugin::save_data(
-    hid_t data_id,
-    const std::vector<DataRecorder::data_token_t>& data,
-    size_t packet_count)
+void DataRecorder::Plugin::writer_loop()
 {
-  const herr_t err =
-      H5PTappend(data_id, static_cast<hsize_t>(packet_count), data.data());
-  if (err < 0) {
-    ERROR_MSG("Unable to write data into hdf5 file!");
+  std::optional<benchmark_request_t> benchmark;
+  DataRecorder::benchmark_result_t result;
+  std::unique_lock<std::mutex> lk(this->writer_mut);
+  while (this->writer_running.load()) {
+    this->writer_wake.wait_for(lk,
+                               DataRecorder::WRITER_INTERVAL,
+                               [this]()
+                               {
+                                 return !this->writer_running
+                                     || this->pending_benchmark.has_value();
+                               });
+    benchmark.swap(this->pending_benchmark);
+    lk.unlock();
+    this->process_data_worker();
+    if (benchmark.has_value()) {
+      result = DataRecorder::benchmark_result_t();
+      const int status = this->benchmarkStorage(
+          benchmark->settings, benchmark->channel_count, result);
+      benchmark->on_done(status, result);
+      benchmark.reset();
+    }
+    lk.lock();
+  }
+}
+
+// Expects m_channels_list_mut to be held by the caller
+void DataRecorder::Plugin::write_pending_data()
+{
+  if (!this->open_file || this->m_component == nullptr
+      || this->hdf5_handles.data_handle == H5I_INVALID_HID)
+  {
+    return;
+  }
+  RT::OS::Fifo* fifo = this->m_component->get_fifo();
+  const size_t frame_byte_size = this->m_component->getFrameSize();
+  int64_t read_bytes = 0;
+  size_t frame_count = 0;
+  size_t fill = 0;
+  RT::OS::fifo_span_t region;
+  // Append straight from fifo storage when possible
+  while (region = fifo->peek(), region.size >= frame_byte_size) {
+    fill = std::max(fill, region.size);
+    frame_count = region.size / frame_byte_size;
+    this->save_frames(region.data, frame_count);
+    fifo->consume(frame_count * frame_byte_size);
+  }
+  while (read_bytes = fifo->read(this->frame_buffer.data(),
+                                 this->frame_buffer.size()),
+         read_bytes > 0)
+  {
+    fill = std::max(fill, static_cast<size_t>(read_bytes));
+    frame_count = static_cast<size_t>(read_bytes) / frame_byte_size;
+    this->save_frames(this->frame_buffer.data(), frame_count);
+  }
+  if (fill > this->max_fifo_fill.load()) {
+    this->max_fifo_fill.store(fill);
+  }
+}
+
+// Frames are written in place: the memory selection skips the leading
+// timestamp of each frame for the Data set and takes only that column for
+// the Time set, so nothing is copied or converted on the way.
+int DataRecorder::Plugin::append_frames(hid_t data_handle,
+                                        hid_t time_handle,
+                                        hsize_t offset,
+                                        hsize_t channel_count,
+                                        const void* frames,
+                                        size_t frame_count)
+{
+  const hsize_t rows = frame_count;
+  const std::array<hsize_t, 2> frame_dims = {rows, channel_count + 1};
+  const std::array<hsize_t, 2> data_extent = {offset + rows, channel_count};
+  const std::array<hsize_t, 2> data_offset = {offset, 0};
+  const std::array<hsize_t, 2> data_count = {rows, channel_count};
+  const std::array<hsize_t, 2> value_offset = {0, 1};
+  const std::array<hsize_t, 2> time_offset = {0, 0};
+  const std::array<hsize_t, 2> time_count = {rows, 1};
+  herr_t err = 0;
+
+  const hid_t memory_space =
+      H5Screate_simple(2, frame_dims.data(), nullptr);
+  err = H5Dset_extent(data_handle, data_extent.data());
+  hid_t file_space = H5Dget_space(data_handle);
+  H5Sselect_hyperslab(file_space,
+                      H5S_SELECT_SET,
+                      data_offset.data(),
+                      nullptr,
+                      data_count.data(),
+                      nullptr);
+  H5Sselect_hyperslab(memory_space,
+                      H5S_SELECT_SET,
+                      value_offset.data(),
+                      nullptr,
+                      data_count.data(),
+                      nullptr);
+  if (err >= 0) {
+    err = H5Dwrite(data_handle,
+                   H5T_NATIVE_DOUBLE,
+                   memory_space,
+                   file_space,
+                   H5P_DEFAULT,
+                   frames);
+  }
+  H5Sclose(file_space);
+
+  if (err >= 0 && time_handle != H5I_INVALID_HID) {
+    err = H5Dset_extent(time_handle, data_extent.data());
+    file_space = H5Dget_space(time_handle);
+    H5Sselect_hyperslab(file_space,
+                        H5S_SELECT_SET,
+                        data_offset.data(),
+                        nullptr,
+                        data_count.data(),
+                        nullptr);
+    H5Sselect_hyperslab(memory_space,
+                        H5S_SELECT_SET,
+                        time_offset.data(),
+                        nullptr,
+                        time_count.data(),
+                        nullptr);
+    if (err >= 0) {
+      err = H5Dwrite(time_handle,
+                     H5T_NATIVE_INT64,
+                     memory_space,
+                     file_space,
+                     H5P_DEFAULT,
+                     frames);
+    }
+    H5Sclose(file_space);
   }
+  H5Sclose(memory_space);
+  return err < 0 ? -1 : 0;
 }
 
-void DataRecorder::Plugin::save_data(hid_t data_id,
-                                     const std::vector<double>& data,
-                                     size_t packet_count)
+int DataRecorder::Plugin::save_frames(const void* frames, size_t frame_count)
 {
-  const herr_t err =
-      H5PTappend(data_id, static_cast<hsize_t>(packet_count), data.data());
-  if (err < 0) {
+  if (this->m_downsampler.active()) {
+    this->downsample_buffer.clear();
+    frame_count = this->m_downsampler.process(
+        frames, frame_count, this->downsample_buffer);
+    frames = this->downsample_buffer.data();
+    if (frame_count == 0) {
+      return 0;
+    }
+  }
+  int result = 0;
+  if (this->m_pipeline->isOpen()) {
+    result = this->m_pipeline->append(frames, frame_count);
+  } else {
+    result = DataRecorder::Plugin::append_frames(
+        this->hdf5_handles.data_handle,
+        this->hdf5_handles.time_handle,
+        this->trial_frame_count,
+        this->m_recording_channels_list.size(),
+        frames,
+        frame_count);
+  }
+  if (result != 0) {
     ERROR_MSG("Unable to write data into hdf5 file!");
+    this->write_errors.fetch_add(1);
+    return -1;
+  }
+  this->trial_frame_count += frame_count;
+  this->frames_written.fetch_add(frame_count);
+  return 0;
+}
+
+int DataRecorder::Plugin::setStorageSettings(
+    const storage_settings_t& settings)
+{
+  if (this->recording.load()) {
+    ERROR_MSG(
+        "DataRecorder::Plugin::setStorageSettings : Unable to change storage "
+        "settings while recording");
+    return -1;
   }
+  if (!DataRecorder::filter_available(settings.filter)) {
+    ERROR_MSG(
+        "DataRecorder::Plugin::setStorageSettings : {} filter is not "
+        "available",
+        DataRecorder::filter_name(settings.filter));
+    return -1;
+  }
+  const std::unique_lock<std::shared_mutex> lk(this->m_channels_list_mut);
+  this->m_storage_settings = settings;
+  return 0;
+}
+
+DataRecorder::storage_settings_t DataRecorder::Plugin::getStorageSettings()
+{
+  const std::shared_lock<std::shared_mutex> lk(this->m_channels_list_mut);
+  return this->m_storage_settings;
+}
+
+int DataRecorder::Plugin::setDownsampling(DOWNSAMPLE_MODE mode, size_t factor)
+{
+  if (this->recording.load()) {
+    ERROR_MSG(
+        "DataRecorder::Plugin::setDownsampling : Unable to change "
+        "downsampling while recording");
+    return -1;
+  }
+  if (factor == 0 || factor > DataRecorder::MAX_DOWNSAMPLE_FACTOR
+      || mode >= DataRecorder::DOWNSAMPLE_MODE_COUNT)
+  {
+    ERROR_MSG(
+        "DataRecorder::Plugin::setDownsampling : Invalid downsampling factor "
+        "{}",
+        factor);
+    return -1;
+  }
+  const std::unique_lock<std::shared_mutex> lk(this->m_channels_list_mut);
+  this->m_downsample_mode = mode;
+  this->m_downsample_factor = factor;
+  return 0;
+}
+
+int64_t DataRecorder::Plugin::queryPeriod()
+{
+  Event::Object get_period_event(Event::Type::RT_GET_PERIOD_EVENT);
+  this->getEventManager()->postEvent(&get_period_event);
+  return std::any_cast<int64_t>(get_period_event.getParam("period"));
+}
+
+int DataRecorder::Plugin::requestBenchmark(const storage_settings_t& settings,
+                                           size_t channel_count,
+                                           benchmark_callback_t on_done)
+{
+  if (this->recording.load() || channel_count == 0) {
+    ERROR_MSG(
+        "DataRecorder::Plugin::requestBenchmark : Benchmarks need at least "
+        "one channel and can not run while recording");
+    return -1;
+  }
+  {
+    const std::unique_lock<std::mutex> lk(this->writer_mut);
+    if (this->pending_benchmark.has_value()) {
+      ERROR_MSG(
+          "DataRecorder::Plugin::requestBenchmark : A benchmark is already "
+          "queued");
+      return -1;
+    }
+    this->pending_benchmark =
+        benchmark_request_t {settings, channel_count, std::move(on_done)};
+  }
+  this->writer_wake.notify_one();
+  return 0;
+}
+
+// Writes BENCHMARK_SECONDS worth of synthetic frames at the current period
+// to a temporary file, in slices the size of one writer thread drain. Runs
+// on the writer thread, see requestBenchmark().
+int DataRecorder::Plugin::benchmarkStorage(const storage_settings_t& settings,
+                                           size_t channel_count,
+                                           benchmark_result_t& result)
+{
+  if (this->recording.load() || channel_count == 0) {
+    ERROR_MSG(
+        "DataRecorder::Plugin::benchmarkStorage : Benchmarks need at least "
+        "one channel and can not run while recording");
+    return -1;
+  }
+  const int64_t period = this->queryPeriod();
+  const auto rate = static_cast<size_t>(
+      RT::OS::SECONDS_TO_NANOSECONDS
+      / (period > 0 ? period : RT::OS::DEFAULT_PERIOD));
+  storage_settings_t bench_settings = settings;
+  if (bench_settings.chunk_frames == 0) {
+    bench_settings.chunk_frames =
+        DataRecorder::auto_chunk_frames(period, channel_count);
+  }
+
+  // One second of data: a sine per channel with some noise so that the
+  // filters see realistic input
+  const size_t frame_bytes = DataRecorder::frame_size(channel_count);
+  std::vector<char> frames(rate * frame_bytes);
+  std::mt19937 generator(0);
+  std::normal_distribution<double> noise(0.0, 0.01);
+  char* frame = frames.data();
+  double value = 0.0;
+  for (size_t index = 0; index < rate; index++) {
+    const auto time = static_cast<int64_t>(index);
+    std::memcpy(frame, &time, sizeof(int64_t));
+    frame += sizeof(int64_t);
+    for (size_t channel = 0; channel < channel_count; channel++) {
+      value = std::sin(2.0 * M_PI * static_cast<double>((channel + 1) * index)
+                       / static_cast<double>(rate))
+          + noise(generator);
+      std::memcpy(frame, &value, sizeof(double));
+      frame += sizeof(double);
+    }
+  }
+  const size_t slice = std::max<size_t>(
+      1, rate * DataRecorder::WRITER_INTERVAL.count() / 1000);
+  const std::filesystem::path file_name =
+      std::filesystem::temp_directory_path() / "rtxi_recorder_benchmark.h5";
+
+  // HDF5 is not thread safe. Like a drain, the shared lock keeps the file
+  // and trial changes made from the Qt thread out until we're done.
+  const std::shared_lock<std::shared_mutex> lk(this->m_channels_list_mut);
+  const auto start = std::chrono::steady_clock::now();
+  const hid_t file_handle =
+      H5Fcreate(file_name.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  if (file_handle == H5I_INVALID_HID) {
+    ERROR_MSG(
+        "DataRecorder::Plugin::benchmarkStorage : Unable to create file {}",
+        file_name.string());
+    return -1;
+  }
+  const hid_t data_handle = DataRecorder::Plugin::create_frame_dataset(
+      file_handle, "Data", H5T_IEEE_F64LE, channel_count, bench_settings);
+  const hid_t time_handle = DataRecorder::Plugin::create_frame_dataset(
+      file_handle, "Time", H5T_STD_I64LE, 0, bench_settings);
+  // Measure the same write path a recording would take
+  DataRecorder::ChunkPipeline pipeline(
+      DataRecorder::compression_worker_count());
+  DataRecorder::chunk_filter_t filter;
+  if (DataRecorder::pipeline_filter(bench_settings, filter) == 0
+      && DataRecorder::filter_available(bench_settings.filter))
+  {
+    pipeline.open(data_handle,
+                  time_handle,
+                  channel_count,
+                  bench_settings.chunk_frames,
+                  filter);
+  }
+  hsize_t written = 0;
+  size_t count = 0;
+  int err = 0;
+  for (size_t pass = 0; pass < DataRecorder::BENCHMARK_SECONDS; pass++) {
+    for (size_t offset = 0; offset < rate && err == 0; offset += slice) {
+      count = std::min(slice, rate - offset);
+      if (pipeline.isOpen()) {
+        err = pipeline.append(frames.data() + (offset * frame_bytes), count);
+      } else {
+        err = DataRecorder::Plugin::append_frames(
+            data_handle,
+            time_handle,
+            written,
+            channel_count,
+            frames.data() + (offset * frame_bytes),
+            count);
+      }
+      written += count;
+    }
+  }
+  if (pipeline.close() != 0) {
+    err = -1;
+  }
+  H5Dclose(time_handle);
+  H5Dclose(data_handle);
+  H5Fclose(file_handle);
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::error_code ec;
+  const auto file_size = std::filesystem::file_size(file_name, ec);
+  std::filesystem::remove(file_name, ec);
+  if (err != 0 || file_size == 0) {
+    ERROR_MSG(
+        "DataRecorder::Plugin::benchmarkStorage : Unable to write benchmark "
+        "data");
+    return -1;
+  }
+  result.frames_per_second = static_cast<double>(written) / elapsed.count();
+  result.realtime_factor =
+      result.frames_per_second / static_cast<double>(rate);
+  result.compression_ratio = static_cast<double>(written * frame_bytes)
+      / static_cast<double>(file_size);
+  return 0;
 }
 
 DataRecorder::Component::Component(Widgets::Plugin* hplugin,
-                                   const std::string& probe_name)
-    : Widgets::Component(hplugin,
-                         probe_name,
-                         DataRecorder::get_default_channels(),
-                         DataRecorder::get_default_vars())
+                                   const std::string& probe_name,
+                                   const std::vector<IO::channel_t>& channels)
+    : Widgets::Component(
+          hplugin, probe_name, channels, DataRecorder::get_default_vars())
+    , m_channel_count(channels.size())
+    , m_frame_size(DataRecorder::frame_size(channels.size()))
+    , m_frame(m_frame_size)
 {
-  if (RT::OS::getFifo(this->m_fifo, DataRecorder::DEFAULT_BUFFER_SIZE) != 0) {
+  if (RT::OS::getFifo(this->m_fifo,
+                      DataRecorder::DEFAULT_BUFFER_FRAMES * this->m_frame_size)
+      != 0)
+  {
     ERROR_MSG("Unable to create xfifo for Data Recorder Component {}",
               probe_name);
   }
 }
 
+void DataRecorder::Component::fill_frame(char* frame, int64_t time)
+{
+  double value = 0.0;
+  std::memcpy(frame, &time, sizeof(int64_t));
+  frame += sizeof(int64_t);
+  for (size_t channel = 0; channel < this->m_channel_count; channel++) {
+    value = readinput(channel);
+    std::memcpy(frame, &value, sizeof(double));
+    frame += sizeof(double);
+  }
+}
+
 void DataRecorder::Component::execute()
 {
-  DataRecorder::data_token_t data_sample;
-  const double value = readinput(0);
+  int64_t time = 0;
+  RT::OS::fifo_span_t region;
   switch (this->getState()) {
     case RT::State::EXEC:
       switch (this->getValue<uint64_t>(PARAMETER::INDEXING)) {
-        case INDEXING:
-          data_sample.time = index++;
+        case INDEX:
+          time = index++;
           break;
         case TIME:
-          data_sample.time = RT::OS::getTime();
+          time = RT::OS::getTime();
           break;
         case NONE:
         default:
           break;
       }
-      data_sample.value = value;
-      this->m_fifo->writeRT(&data_sample, sizeof(DataRecorder::data_token_t));
+      region = this->m_fifo->reserveRT(this->m_frame_size);
+      if (region.data != nullptr) {
+        this->fill_frame(static_cast<char*>(region.data), time);
+        this->m_fifo->commitRT(this->m_frame_size);
+        break;
+      }
+      this->fill_frame(this->m_frame.data(), time);
+      if (this->m_fifo->writeRT(this->m_frame.data(), this->m_frame_size) <= 0)
+      {
+        this->dropped.fetch_add(1, std::memory_order_relaxed);
+      }
       break;
     case RT::State::UNPAUSE:
     case RT::State::INIT:
@@ -21,11 +21,20 @@
 #define DATA_RECORDER_H
 
 #include <QTime>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
 #include <vector>
 
 #include <H5Ipublic.h>
 #include <hdf5_hl.h>
 
+#include "chunk_pipeline.hpp"
+#include "downsampler.hpp"
 #include "fifo.hpp"
 #include "io.hpp"
 #include "widgets.hpp"
@@ -43,12 +52,6 @@ class Manager;
 namespace DataRecorder
 {
 
-typedef struct data_token_t
-{
-  int64_t time;
-  double value;
-} data_token_t;
-
 enum TIME_TAG_TYPE
 {
   INDEX = 0,
@@ -61,9 +64,138 @@ enum PARAMETER
   INDEXING = 0
 };
 
-constexpr size_t DEFAULT_BUFFER_SIZE = 10000 * sizeof(data_token_t);
+/*!
+ * Compression applied to recorded datasets
+ *
+ * LZ4, ZSTD and BLOSC are provided by HDF5 filter plugins and are only
+ * usable when HDF5 can load them, see filter_available().
+ */
+enum COMPRESSION_FILTER
+{
+  NO_FILTER = 0,
+  DEFLATE,
+  SHUFFLE_DEFLATE,
+  LZ4,
+  ZSTD,
+  BLOSC,
+  FILTER_COUNT
+};
+
+inline std::string_view filter_name(COMPRESSION_FILTER filter)
+{
+  switch (filter) {
+    case NO_FILTER:
+      return "None";
+    case DEFLATE:
+      return "Deflate";
+    case SHUFFLE_DEFLATE:
+      return "Shuffle + Deflate";
+    case LZ4:
+      return "LZ4";
+    case ZSTD:
+      return "Zstd";
+    case BLOSC:
+      return "Blosc";
+    default:
+      return "Unknown";
+  }
+}
+
+/*!
+ * Checks whether HDF5 can apply the given filter
+ *
+ * \param filter The compression filter
+ *
+ * \return True if the filter is built in or its plugin could be loaded
+ */
+bool filter_available(COMPRESSION_FILTER filter);
+
+/*!
+ * Chunking and compression used for the datasets of new trials
+ */
+typedef struct storage_settings_t
+{
+  COMPRESSION_FILTER filter = SHUFFLE_DEFLATE;
+  int level = 1; /*!< Compression level, for filters that take one */
+  hsize_t chunk_frames = 0; /*!< Rows per chunk, 0 sizes it from the period */
+} storage_settings_t;
+
+/*!
+ * Outcome of Plugin::benchmarkStorage()
+ */
+typedef struct benchmark_result_t
+{
+  double frames_per_second = 0.0; /*!< Frames written per second */
+  double realtime_factor = 0.0; /*!< Write rate over the realtime rate */
+  double compression_ratio = 0.0; /*!< Raw data size over file size */
+} benchmark_result_t;
+
+// Receives the status and outcome of a benchmark, on the writer thread
+using benchmark_callback_t =
+    std::function<void(int, const benchmark_result_t&)>;
+
+constexpr size_t DEFAULT_BUFFER_FRAMES = 10000;
+// How long the writer thread sleeps between fifo drains. At 20 kHz this is
+// 200 frames, a small fraction of DEFAULT_BUFFER_FRAMES.
+constexpr std::chrono::milliseconds WRITER_INTERVAL(10);
 constexpr std::string_view MODULE_NAME = "Data Recorder";
 
+// Registered ids of the HDF5 filter plugins
+constexpr H5Z_filter_t BLOSC_FILTER_ID = 32001;
+constexpr H5Z_filter_t LZ4_FILTER_ID = 32004;
+constexpr H5Z_filter_t ZSTD_FILTER_ID = 32015;
+
+// Automatic chunking aims for a second of data per chunk, capped so that a
+// chunk always fits in the dataset chunk cache while it is being filled
+constexpr std::chrono::seconds CHUNK_DURATION(1);
+constexpr hsize_t MAX_CHUNK_BYTES = 1024 * 1024;
+constexpr hsize_t MIN_CHUNK_FRAMES = 64;
+constexpr hsize_t DEFAULT_CHUNK_FRAMES = 1000;
+constexpr size_t BENCHMARK_SECONDS = 2;
+constexpr size_t MAX_COMPRESSION_WORKERS = 8;
+
+/*!
+ * Chunk size used when storage_settings_t::chunk_frames is zero
+ *
+ * \param period Realtime period in nanoseconds, or a negative value if
+ *     unknown
+ * \param channel_count Number of recorded channels
+ *
+ * \return Number of frames per chunk
+ */
+hsize_t auto_chunk_frames(int64_t period, size_t channel_count);
+
+/*!
+ * Number of threads compressing recorded chunks: half of the cores, up to
+ * MAX_COMPRESSION_WORKERS
+ */
+size_t compression_worker_count();
+
+/*!
+ * Describes the filters of a storage setting for DataRecorder::ChunkPipeline
+ *
+ * \param settings The storage settings
+ * \param filter Receives the filters
+ *
+ * \return 0 if the pipeline can produce chunks for these settings, -1 for
+ *     filters that are only available through HDF5 plugins
+ */
+int pipeline_filter(const storage_settings_t& settings,
+                    chunk_filter_t& filter);
+
+/*!
+ * Size of one recorded frame in bytes
+ *
+ * Every period the recording component writes a single frame: an int64_t
+ * index or timestamp followed by one double per recorded channel.
+ *
+ * \param channel_count Number of recorded channels
+ */
+constexpr size_t frame_size(size_t channel_count)
+{
+  return sizeof(int64_t) + (channel_count * sizeof(double));
+}
+
 inline std::vector<Widgets::Variable::Info> get_default_vars()
 {
   return {
@@ -80,38 +212,56 @@ inline std::vector<Widgets::Variable::Info> get_default_vars()
        uint64_t {DataRecorder::TIME_TAG_TYPE::INDEX}}};
 }
 
-inline std::vector<IO::channel_t> get_default_channels()
+/*!
+ * Counters published by the Data Recorder writer thread
+ */
+typedef struct writer_stats_t
 {
-  return {{"Recording Channel",
-           "This is the channel used by the Data Recorder to record on other "
-           "inputs and "
-           "output ports",
-           IO::INPUT}};
-}
+  size_t frames_written = 0; /*!< Frames appended to the current file */
+  size_t frames_dropped = 0; /*!< Frames lost because the fifo was full */
+  size_t write_errors = 0; /*!< Failed HDF5 appends */
+  size_t max_fifo_fill = 0; /*!< Largest backlog seen in a fifo, in bytes */
+} writer_stats_t;
 
 typedef struct record_channel
 {
   std::string name;
   IO::endpoint endpoint;
-  RT::OS::Fifo* data_source = nullptr;
   bool operator==(const record_channel& rhs) const
   {
-    return (this->endpoint == rhs.endpoint)
-        && (this->data_source == rhs.data_source);
+    return this->endpoint == rhs.endpoint;
   }
   bool operator!=(const record_channel& rhs) const { return !operator==(rhs); }
 } record_channel;
 
+/*!
+ * Recording block shared by every recorded channel
+ *
+ * Input i is connected to the i-th recorded endpoint. Each period the values
+ * of all inputs are written to the fifo as one frame, so the channels stay
+ * aligned and the realtime side does a single fifo write regardless of how
+ * many channels are recorded.
+ */
 class Component : public Widgets::Component
 {
 public:
-  Component(Widgets::Plugin* hplugin, const std::string& probe_name);
+  Component(Widgets::Plugin* hplugin,
+            const std::string& probe_name,
+            const std::vector<IO::channel_t>& channels);
   void execute() override;
   RT::OS::Fifo* get_fifo();
+  size_t getFrameSize() const { return this->m_frame_size; }
+  size_t getDroppedCount() const { return this->dropped.load(); }
 
 private:
+  void fill_frame(char* frame, int64_t time);
+
   std::unique_ptr<RT::OS::Fifo> m_fifo;
+  size_t m_channel_count;
+  size_t m_frame_size;
+  std::vector<char> m_frame;
   int64_t index=0;
+  std::atomic<size_t> dropped = 0;
 };
 
 class Panel : public Widgets::Panel
@@ -137,6 +287,7 @@ public slots:
   void startRecordClicked();
   void stopRecordClicked();
   void updateDownsampleRate(size_t rate);
+  void updateDownsampleMode(int index);
   void removeRecorders(IO::Block* block);
 
 private slots:
@@ -146,12 +297,15 @@ private slots:
   void insertChannel();
   void removeChannel();
   void addNewTag();
-  void processData();
+  void updateStatus();
   void syncEnableRecordingButtons(const QString& /*unused*/);
   void setTimeTagType(int tag_type);
+  void updateStorageSettings();
+  void runStorageBenchmark();
 
 private:
-  size_t m_buffer_size = DEFAULT_BUFFER_SIZE;
+  void showBenchmarkResult(int status, const benchmark_result_t& result);
+
   size_t downsample_rate {1};
   std::vector<std::string> dataTags;
   TIME_TAG_TYPE time_type = TIME_TAG_TYPE::INDEX;
@@ -162,6 +316,7 @@ private:
   QGroupBox* fileGroup = nullptr;
   QGroupBox* buttonGroup = nullptr;
   QGroupBox* listGroup = nullptr;
+  QGroupBox* storageGroup = nullptr;
 
   QComboBox* blockList = nullptr;
   QComboBox* channelList = nullptr;
@@ -174,6 +329,14 @@ private:
   QPushButton* addTag = nullptr;
 
   QSpinBox* downsampleSpin = nullptr;
+  QComboBox* downsampleModeList = nullptr;
+
+  QComboBox* filterList = nullptr;
+  QSpinBox* levelSpin = nullptr;
+  QSpinBox* chunkSpin = nullptr;
+  QSpinBox* benchmarkChannelsSpin = nullptr;
+  QPushButton* benchmarkButton = nullptr;
+  QLabel* benchmarkResult = nullptr;
 
   QLineEdit* fileNameEdit = nullptr;
   QLineEdit* timeStampEdit = nullptr;
@@ -204,6 +367,7 @@ public:
   ~Plugin() override;
 
   void receiveEvent(Event::Object* event) override;
+  std::vector<Event::Type> subscriptions() const override;
   void startRecording();
   void stopRecording();
   bool changeIndexingType(int tag_type);
@@ -218,6 +382,36 @@ public:
   std::vector<record_channel> get_recording_channels();
   int apply_tag(const std::string& tag);
   void process_data_worker();
+  writer_stats_t getWriterStats();
+  TIME_TAG_TYPE getTimeTagType() const { return this->time_tag_type.load(); }
+  int setStorageSettings(const storage_settings_t& settings);
+  storage_settings_t getStorageSettings();
+
+  /*!
+   * Sets how recorded frames are downsampled in new trials
+   *
+   * \param mode How frames are combined
+   * \param factor Input frames per stored frame, 1 to store every frame
+   *
+   * \return 0 if successful, -1 while recording or if the factor is out of
+   *     range
+   */
+  int setDownsampling(DOWNSAMPLE_MODE mode, size_t factor);
+
+  /*!
+   * Queues a storage benchmark on the writer thread
+   *
+   * \param settings Storage settings to measure
+   * \param channel_count Number of channels in the synthetic frames
+   * \param on_done Called from the writer thread once the benchmark ran
+   *
+   * \return 0 if queued, -1 while recording, without channels or if another
+   *     benchmark is already queued
+   */
+  int requestBenchmark(const storage_settings_t& settings,
+                       size_t channel_count,
+                       benchmark_callback_t on_done);
+  int64_t queryPeriod();
   std::string getOpenFilename() const { return this->hdf5_filename; }
   bool isFileOpen() { return this->open_file.load(); }
   bool isRecording() { return this->recording.load(); }
@@ -228,14 +422,39 @@ private:
   void append_new_trial();
   void close_trial_group();
   void open_trial_group();
-  static void save_data(hid_t data_id,
-                        const std::vector<data_token_t>& data,
-                        size_t packet_count);
-  static void save_data(hid_t data_id,
-                        const std::vector<double>& data,
-                        size_t packet_count);
-  hsize_t m_data_chunk_size = static_cast<hsize_t>(1000);
-  int m_compression_factor = 5;
+  void write_pending_data();
+  void discard_pending_data();
+  void writer_loop();
+  void open_frame_datasets();
+  void close_frame_datasets();
+  int rebuild_component(const std::vector<record_channel>& channels);
+  int benchmarkStorage(const storage_settings_t& settings,
+                       size_t channel_count,
+                       benchmark_result_t& result);
+  void post_component_state(RT::State::state_t state);
+  int save_frames(const void* frames, size_t frame_count);
+  static int set_filters(hid_t properties, const storage_settings_t& settings);
+  static hid_t create_frame_dataset(hid_t group,
+                                    const char* name,
+                                    hid_t type,
+                                    hsize_t channel_count,
+                                    const storage_settings_t& settings);
+  static int append_frames(hid_t data_handle,
+                           hid_t time_handle,
+                           hsize_t offset,
+                           hsize_t channel_count,
+                           const void* frames,
+                           size_t frame_count);
+  hsize_t m_data_chunk_size = DEFAULT_CHUNK_FRAMES;
+  storage_settings_t m_storage_settings;
+  int64_t m_period = -1;
+  // Compresses the chunks of the open trial, when its filters allow it
+  std::unique_ptr<ChunkPipeline> m_pipeline;
+  DOWNSAMPLE_MODE m_downsample_mode = DECIMATE;
+  size_t m_downsample_factor = 1;
+  // Configured for the open trial and fed by the writer thread
+  Downsampler m_downsampler;
+  std::vector<char> downsample_buffer;
   int tag_count = 0;
   struct hdf5_handles
   {
@@ -245,29 +464,40 @@ private:
     hid_t sync_group_handle = H5I_INVALID_HID;
     hid_t async_group_handle = H5I_INVALID_HID;
     hid_t sys_data_group_handle = H5I_INVALID_HID;
-    hid_t channel_index_datatype_handle = H5I_INVALID_HID;
+    hid_t data_handle = H5I_INVALID_HID;
+    hid_t time_handle = H5I_INVALID_HID;
   } hdf5_handles;
 
-  struct recorder_t
-  {
-    recorder_t(record_channel chan,
-               std::unique_ptr<DataRecorder::Component> comp,
-               hid_t handle)
-        : channel(std::move(chan))
-        , component(std::move(comp))
-        , hdf5_data_handle(handle)
-    {
-    }
-    record_channel channel;
-    std::unique_ptr<DataRecorder::Component> component;
-    hid_t hdf5_data_handle;
-  };
-
   int trial_count = 0;
+  hsize_t trial_frame_count = 0;
   std::string hdf5_filename;
-  std::vector<recorder_t> m_recording_channels_list;
+  // Recorded channels in the order of the component inputs and the columns
+  // of the Data dataset
+  std::vector<record_channel> m_recording_channels_list;
+  std::unique_ptr<DataRecorder::Component> m_component;
   std::shared_mutex m_channels_list_mut;
   std::atomic<bool> open_file = false;
+  std::atomic<TIME_TAG_TYPE> time_tag_type = TIME_TAG_TYPE::INDEX;
+
+  // Buffer reused by the writer thread when the fifo cannot be peeked
+  std::vector<char> frame_buffer;
+
+  std::atomic<size_t> frames_written = 0;
+  std::atomic<size_t> write_errors = 0;
+  std::atomic<size_t> max_fifo_fill = 0;
+
+  std::mutex writer_mut;
+  std::condition_variable writer_wake;
+  std::atomic<bool> writer_running = true;
+  struct benchmark_request_t
+  {
+    storage_settings_t settings;
+    size_t channel_count = 0;
+    benchmark_callback_t on_done;
+  };
+  // Picked up by the writer thread, guarded by writer_mut
+  std::optional<benchmark_request_t> pending_benchmark;
+  std::thread writer_thread;
 };  // class Plugin
 
 std::unique_ptr<Widgets::Plugin> createRTXIPlugin(Event::Manager* ev_manager);
@@ -0,0 +1,155 @@
+/*
+         The Real-Time eXperiment Interface (RTXI)
+         Copyright (C) 2011 Georgia Institute of Technology, University of Utah,
+   Weill Cornell Medical College
+
+         This program is free software: you can redistribute it and/or modify
+         it under the terms of the GNU General Public License as published by
+         the Free Software Foundation, either version 3 of the License, or
+         (at your option) any later version.
+
+         This program is distributed in the hope that it will be useful,
+         but WITHOUT ANY WARRANTY; without even the implied warranty of
+         MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+         GNU General Public License for more details.
+
+         You should have received a copy of the GNU General Public License
+         along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+
+#include "downsampler.hpp"
+
+#include <firideal.h>
+#include <hamming.h>
+
+int DataRecorder::Downsampler::configure(DOWNSAMPLE_MODE new_mode,
+                                         size_t new_factor,
+                                         size_t channels)
+{
+  if (new_factor == 0 || new_factor > DataRecorder::MAX_DOWNSAMPLE_FACTOR
+      || new_mode >= DOWNSAMPLE_MODE_COUNT)
+  {
+    return -1;
+  }
+  this->mode = new_mode;
+  this->factor = new_factor;
+  this->channel_count = channels;
+  this->phase = 0;
+  this->values.assign(channels, 0.0);
+  this->input.assign(channels, 0.0);
+  this->taps.clear();
+  this->history.clear();
+  this->history_pos = 0;
+  if (new_mode == FIR_DECIMATE && new_factor > 1) {
+    this->taps = DataRecorder::Downsampler::design_filter(new_factor);
+    this->history.assign(2 * this->taps.size() * channels, 0.0);
+  }
+  return 0;
+}
+
+std::vector<double> DataRecorder::Downsampler::design_filter(size_t factor)
+{
+  // Odd length keeps the filter linear phase with a whole sample delay
+  const auto tap_count =
+      static_cast<int>((DataRecorder::FIR_TAPS_PER_FACTOR * factor) + 1);
+  FirIdealFilter filter(
+      tap_count, 1.0 / static_cast<double>(factor), 0.0, /*lowpass=*/0);
+  HammingWindow window(tap_count);
+  filter.ApplyWindow(&window);
+  std::vector<double> taps(static_cast<size_t>(tap_count));
+  filter.CopyCoefficients(taps.data());
+  const double gain = std::accumulate(taps.begin(), taps.end(), 0.0);
+  for (auto& tap : taps) {
+    tap /= gain;
+  }
+  return taps;
+}
+
+void DataRecorder::Downsampler::emit(const char* frame,
+                                     std::vector<char>& output)
+{
+  const size_t value_bytes = this->channel_count * sizeof(double);
+  const size_t offset = output.size();
+  output.resize(offset + sizeof(int64_t) + value_bytes);
+  if (this->mode == DECIMATE) {
+    std::memcpy(output.data() + offset, frame, sizeof(int64_t) + value_bytes);
+    return;
+  }
+  std::memcpy(output.data() + offset, frame, sizeof(int64_t));
+  std::memcpy(output.data() + offset + sizeof(int64_t),
+              this->values.data(),
+              value_bytes);
+}
+
+size_t DataRecorder::Downsampler::process(const void* frames,
+                                          size_t frame_count,
+                                          std::vector<char>& output)
+{
+  const auto* frame = static_cast<const char*>(frames);
+  const size_t value_bytes = this->channel_count * sizeof(double);
+  const size_t frame_bytes = sizeof(int64_t) + value_bytes;
+  if (!this->active()) {
+    output.insert(output.end(), frame, frame + (frame_count * frame_bytes));
+    return frame_count;
+  }
+  const size_t tap_count = this->taps.size();
+  const size_t row_size = this->channel_count;
+  const double* window = nullptr;
+  const double* row = nullptr;
+  const double scale = 1.0 / static_cast<double>(this->factor);
+  size_t produced = 0;
+  for (size_t index = 0; index < frame_count; index++, frame += frame_bytes) {
+    switch (this->mode) {
+      case BLOCK_AVERAGE:
+        std::memcpy(this->input.data(), frame + sizeof(int64_t), value_bytes);
+        for (size_t channel = 0; channel < row_size; channel++) {
+          this->values[channel] += this->input[channel];
+        }
+        break;
+      case FIR_DECIMATE:
+        std::memcpy(this->history.data() + (this->history_pos * row_size),
+                    frame + sizeof(int64_t),
+                    value_bytes);
+        std::memcpy(
+            this->history.data() + ((this->history_pos + tap_count) * row_size),
+            frame + sizeof(int64_t),
+            value_bytes);
+        this->history_pos = (this->history_pos + 1) % tap_count;
+        break;
+      default:
+        break;
+    }
+    if (++this->phase < this->factor) {
+      continue;
+    }
+    this->phase = 0;
+    if (this->mode == BLOCK_AVERAGE) {
+      for (auto& value : this->values) {
+        value *= scale;
+      }
+    } else if (this->mode == FIR_DECIMATE) {
+      // Oldest frame first, so it meets the last tap
+      window = this->history.data() + (this->history_pos * row_size);
+      std::fill(this->values.begin(), this->values.end(), 0.0);
+      for (size_t tap = 0; tap < tap_count; tap++) {
+        row = window + (tap * row_size);
+        for (size_t channel = 0; channel < row_size; channel++) {
+          this->values[channel] +=
+              this->taps[tap_count - 1 - tap] * row[channel];
+        }
+      }
+    }
+    this->emit(frame, output);
+    if (this->mode == BLOCK_AVERAGE) {
+      std::fill(this->values.begin(), this->values.end(), 0.0);
+    }
+    produced++;
+  }
+  return produced;
+}
@@ -0,0 +1,144 @@
+/*
+         The Real-Time eXperiment Interface (RTXI)
+         Copyright (C) 2011 Georgia Institute of Technology, University of Utah,
+   Weill Cornell Medical College
+
+         This program is free software: you can redistribute it and/or modify
+         it under the terms of the GNU General Public License as published by
+         the Free Software Foundation, either version 3 of the License, or
+         (at your option) any later version.
+
+         This program is distributed in the hope that it will be useful,
+         but WITHOUT ANY WARRANTY; without even the implied warranty of
+         MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+         GNU General Public License for more details.
+
+         You should have received a copy of the GNU General Public License
+         along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+         Reduces the rate of recorded frames before they are stored. Runs on
+         the recorder's writer thread, the realtime component always hands
+         over every frame.
+         */
+
+#ifndef DOWNSAMPLER_H
+#define DOWNSAMPLER_H
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace DataRecorder
+{
+
+/*!
+ * How frames are combined when downsampling
+ */
+enum DOWNSAMPLE_MODE
+{
+  DECIMATE = 0, /*!< Keep the last frame of every block */
+  BLOCK_AVERAGE, /*!< Mean of every block */
+  FIR_DECIMATE, /*!< Low pass filter, then decimate */
+  DOWNSAMPLE_MODE_COUNT
+};
+
+inline std::string_view downsample_name(DOWNSAMPLE_MODE mode)
+{
+  switch (mode) {
+    case DECIMATE:
+      return "Decimate";
+    case BLOCK_AVERAGE:
+      return "Block Average";
+    case FIR_DECIMATE:
+      return "FIR Decimate";
+    default:
+      return "Unknown";
+  }
+}
+
+constexpr size_t MAX_DOWNSAMPLE_FACTOR = 500;
+// Anti-aliasing filters get this many taps per unit of downsampling factor
+constexpr size_t FIR_TAPS_PER_FACTOR = 20;
+
+class Downsampler
+{
+public:
+  /*!
+   * Prepares the downsampler for a new trial
+   *
+   * Filter state is cleared, so the first output frames of the FIR mode
+   * see zeros before the trial started.
+   *
+   * \param new_mode How frames are combined
+   * \param new_factor Input frames per output frame, 1 to store every frame
+   * \param channels Number of values per frame
+   *
+   * \return 0 if successful, -1 if the factor is out of range
+   */
+  int configure(DOWNSAMPLE_MODE new_mode, size_t new_factor, size_t channels);
+
+  /*!
+   * Downsamples interleaved frames
+   *
+   * Every output frame carries the time of the last input frame of its
+   * block. The FIR mode delays the values by (taps - 1) / 2 input frames.
+   *
+   * \param frames Frames laid out as an int64_t time followed by
+   *     channel_count doubles
+   * \param frame_count Number of frames
+   * \param output Receives the output frames, in the same layout
+   *
+   * \return Number of frames written to output
+   */
+  size_t process(const void* frames,
+                 size_t frame_count,
+                 std::vector<char>& output);
+
+  /*!
+   * Whether frames are dropped or combined at all
+   */
+  bool active() const { return this->factor > 1; }
+
+  size_t getFactor() const { return this->factor; }
+  DOWNSAMPLE_MODE getMode() const { return this->mode; }
+
+  /*!
+   * Number of taps of the anti-aliasing filter, 0 outside of the FIR mode
+   */
+  size_t getTapCount() const { return this->taps.size(); }
+
+  /*!
+   * Designs a Hamming windowed low pass filter with a cutoff at the
+   * Nyquist frequency of the downsampled signal and unit gain at DC
+   *
+   * \param factor Downsampling factor
+   *
+   * \return The filter taps
+   */
+  static std::vector<double> design_filter(size_t factor);
+
+private:
+  void emit(const char* frame, std::vector<char>& output);
+
+  DOWNSAMPLE_MODE mode = DECIMATE;
+  size_t factor = 1;
+  size_t channel_count = 0;
+  size_t phase = 0;
+
+  // Running sums for BLOCK_AVERAGE, filter output for FIR_DECIMATE
+  std::vector<double> values;
+  std::vector<double> input;
+
+  // FIR_DECIMATE keeps the last taps.size() frames twice, so the newest
+  // window is always contiguous in memory
+  std::vector<double> taps;
+  std::vector<double> history;
+  size_t history_pos = 0;
+};
+
+}  // namespace DataRecorder
+
+#endif /* DOWNSAMPLER_H */
@@ -95,6 +95,11 @@ public:
       : Widgets::Plugin(ev_manager, std::string(RTXIWizard::MODULE_NAME))
   {
   }
+
+  std::vector<Event::Type> subscriptions() const override
+  {
+    return {Event::Type::RT_PERIOD_EVENT};
+  }
 };  // class Plugin
 
 std::unique_ptr<Widgets::Plugin> createRTXIPlugin(Event::Manager* ev_manager);
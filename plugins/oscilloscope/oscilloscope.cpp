@@ -66,6 +66,14 @@ void Oscilloscope::Plugin::receiveEvent(Event::Object* event)
   }
 }
 
+std::vector<Event::Type> Oscilloscope::Plugin::subscriptions() const
+{
+  return {Event::Type::RT_THREAD_INSERT_EVENT,
+          Event::Type::RT_THREAD_REMOVE_EVENT,
+          Event::Type::RT_DEVICE_INSERT_EVENT,
+          Event::Type::RT_DEVICE_REMOVE_EVENT};
+}
+
 void Oscilloscope::Panel::updateChannelScale(IO::endpoint probe_info)
 {
   const auto scale = this->scalesList->currentData().value<double>();
@@ -823,11 +831,19 @@ Oscilloscope::Component::Component(Widgets::Plugin* hplugin,
 void Oscilloscope::Component::execute()
 {
   Oscilloscope::sample sample {};
+  RT::OS::fifo_span_t region;
   switch (this->getState()) {
     case RT::State::EXEC: {
       sample.time = RT::OS::getTime();
       sample.value = this->readinput(0);
-      this->fifo->writeRT(&sample, sizeof(Oscilloscope::sample));
+      // write straight into fifo storage when the fifo allows it
+      region = this->fifo->reserveRT(sizeof(Oscilloscope::sample));
+      if (region.data != nullptr) {
+        *static_cast<Oscilloscope::sample*>(region.data) = sample;
+        this->fifo->commitRT(sizeof(Oscilloscope::sample));
+      } else {
+        this->fifo->writeRT(&sample, sizeof(Oscilloscope::sample));
+      }
       break;
     }
     case RT::State::INIT:
@@ -192,6 +192,7 @@ public:
   ~Plugin() override;
 
   void receiveEvent(Event::Object* event) override;
+  std::vector<Event::Type> subscriptions() const override;
   RT::OS::Fifo* createProbe(IO::endpoint probe_info);
   void deleteProbe(IO::endpoint probe_info);
   void deleteAllProbes(IO::Block* block);
@@ -513,22 +513,41 @@ void Oscilloscope::Scope::process_data()
   size_t array_indx = 0;
   const size_t sample_capacity_bytes =
       sample_buffer.size() * sizeof(Oscilloscope::sample);
+  RT::OS::fifo_span_t region;
+  const Oscilloscope::sample* samples = nullptr;
   for (auto& channel : this->channels) {
     // Read as many samples as possible in chunks of buffer size or less.
-    // overwrite old samples from previous write if available
-    while (
-        bytes = channel.fifo->read(sample_buffer.data(), sample_capacity_bytes),
-        bytes > 0)
-    {
-      sample_count = static_cast<size_t>(bytes) / sizeof(Oscilloscope::sample);
+    // overwrite old samples from previous write if available. Fifos that
+    // expose their storage are read in place instead of copied out.
+    while (true) {
+      region = channel.fifo->peek();
+      if (region.size >= sizeof(Oscilloscope::sample)) {
+        samples = static_cast<const Oscilloscope::sample*>(region.data);
+        sample_count = region.size / sizeof(Oscilloscope::sample);
+      } else {
+        region = {};
+        bytes = channel.fifo->read(sample_buffer.data(), sample_capacity_bytes);
+        if (bytes <= 0) {
+          break;
+        }
+        samples = sample_buffer.data();
+        sample_count =
+            static_cast<size_t>(bytes) / sizeof(Oscilloscope::sample);
+      }
+      if (sample_count == 0) {
+        break;
+      }
       for (size_t i = 0; i < sample_count; i++) {
         array_indx = (i + channel.data_indx) % this->buffer_size;
-        channel.timebuffer[array_indx] = sample_buffer[i].time;
-        channel.ybuffer[array_indx] = sample_buffer[i].value + channel.offset;
+        channel.timebuffer[array_indx] = samples[i].time;
+        channel.ybuffer[array_indx] = samples[i].value + channel.offset;
       }
       channel.data_indx =
           (channel.data_indx + sample_count) % this->buffer_size;
-    };
+      if (region.data != nullptr) {
+        channel.fifo->consume(sample_count * sizeof(Oscilloscope::sample));
+      }
+    }
 
     // zero out so the buffer so it doesn't spill over to the next channel
     sample_buffer.assign(this->buffer_size, {0, 0.0});
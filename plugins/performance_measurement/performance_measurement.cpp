@@ -17,10 +17,18 @@
 
  */
 
+#include <array>
+#include <fstream>
+
+#include <QComboBox>
+#include <QFileDialog>
 #include <QGridLayout>
+#include <QHeaderView>
 #include <QLabel>
 #include <QMdiSubWindow>
+#include <QMessageBox>
 #include <QPushButton>
+#include <QTableWidget>
 #include <QTimer>
 
 #include "performance_measurement.hpp"
@@ -42,6 +50,14 @@ PerformanceMeasurement::Panel::Panel(const std::string& mod_name,
     , maxTimestepEdit(new QLineEdit(this))
     , timestepJitterEdit(new QLineEdit(this))
     , AppCpuPercentEdit(new QLineEdit(this))
+    , overrunsEdit(new QLineEdit(this))
+    , skippedPeriodsEdit(new QLineEdit(this))
+    , lastOverrunEdit(new QLineEdit(this))
+    , overrunPolicyBox(new QComboBox(this))
+    , percentileTable(new QTableWidget(3, 4, this))
+    , profileButton(new QPushButton("Profile Blocks", this))
+    , profileDroppedLabel(new QLabel(this))
+    , profileTable(new QTableWidget(0, 5, this))
 {
   // Create main layout
   // auto* box_layout = new QVBoxLayout;
@@ -79,13 +95,73 @@ PerformanceMeasurement::Panel::Panel(const std::string& mod_name,
   gridLayout->addWidget(new QLabel("RTXI App Cpu Usage(%)"), 6, 0);
   gridLayout->addWidget(AppCpuPercentEdit, 6, 1);
 
+  // Missed deadlines mean that recorded data is no longer evenly sampled
+  overrunsEdit->setReadOnly(true);
+  gridLayout->addWidget(new QLabel(tr("Missed Deadlines")), 7, 0);
+  gridLayout->addWidget(overrunsEdit, 7, 1);
+
+  skippedPeriodsEdit->setReadOnly(true);
+  gridLayout->addWidget(new QLabel(tr("Skipped Periods")), 8, 0);
+  gridLayout->addWidget(skippedPeriodsEdit, 8, 1);
+
+  lastOverrunEdit->setReadOnly(true);
+  gridLayout->addWidget(new QLabel(tr("Last Missed Deadline (s ago)")), 9, 0);
+  gridLayout->addWidget(lastOverrunEdit, 9, 1);
+
+  // Items follow the order of RT::OS::overrun_policy_t
+  overrunPolicyBox->addItem(tr("Skip missed periods"));
+  overrunPolicyBox->addItem(tr("Catch up on missed periods"));
+  gridLayout->addWidget(new QLabel(tr("Overrun Policy")), 10, 0);
+  gridLayout->addWidget(overrunPolicyBox, 10, 1);
+  QObject::connect(overrunPolicyBox,
+                   QOverload<int>::of(&QComboBox::activated),
+                   this,
+                   &PerformanceMeasurement::Panel::changeOverrunPolicy);
+
+  // Tail percentiles reveal the rare slow periods that max and jitter hide
+  percentileTable->setHorizontalHeaderLabels({tr("p50 (").append(suffix),
+                                              tr("p99 (").append(suffix),
+                                              tr("p99.9 (").append(suffix),
+                                              tr("p99.99 (").append(suffix)});
+  percentileTable->setVerticalHeaderLabels(
+      {"Computation Time", "Real-time Period", "Latency"});
+  percentileTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  gridLayout->addWidget(percentileTable, 11, 0, 1, 2);
+
   auto* resetButton = new QPushButton("Reset", this);
-  gridLayout->addWidget(resetButton, 7, 1);
+  gridLayout->addWidget(resetButton, 12, 1);
   QObject::connect(resetButton,
                    &QPushButton::released,
                    this,
                    &PerformanceMeasurement::Panel::reset);
 
+  auto* dumpButton = new QPushButton("Dump Histograms", this);
+  gridLayout->addWidget(dumpButton, 13, 1);
+  QObject::connect(dumpButton,
+                   &QPushButton::released,
+                   this,
+                   &PerformanceMeasurement::Panel::dumpHistograms);
+
+  // Per block costs are only gathered while the profiler is running
+  profileButton->setCheckable(true);
+  gridLayout->addWidget(profileButton, 14, 1);
+  QObject::connect(profileButton,
+                   &QPushButton::toggled,
+                   this,
+                   &PerformanceMeasurement::Panel::toggleProfiler);
+  profileDroppedLabel->setVisible(false);
+  gridLayout->addWidget(profileDroppedLabel, 14, 0);
+  profileTable->setHorizontalHeaderLabels({"Block",
+                                           "Stage",
+                                           tr("Mean (").append(suffix),
+                                           tr("p99 (").append(suffix),
+                                           tr("Max (").append(suffix)});
+  profileTable->verticalHeader()->setVisible(false);
+  profileTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  profileTable->setSortingEnabled(true);
+  profileTable->setVisible(false);
+  gridLayout->addWidget(profileTable, 15, 0, 1, 2);
+
   // Attach child widget to parent widget
   // box_layout->addLayout(gridLayout);
 
@@ -107,6 +183,9 @@ PerformanceMeasurement::Component::Component(Widgets::Plugin* hplugin)
                          std::string(MODULE_NAME),
                          PerformanceMeasurement::get_default_channels(),
                          PerformanceMeasurement::get_default_vars())
+    , durationHistogram(HISTOGRAM_HIGHEST_VALUE, HISTOGRAM_SUB_BUCKET_BITS)
+    , timestepHistogram(HISTOGRAM_HIGHEST_VALUE, HISTOGRAM_SUB_BUCKET_BITS)
+    , latencyHistogram(HISTOGRAM_HIGHEST_VALUE, HISTOGRAM_SUB_BUCKET_BITS)
 {
   if (RT::OS::getFifo(this->fifo,
                       10 * sizeof(PerformanceMeasurement::performance_stats_t))
@@ -137,6 +216,10 @@ void PerformanceMeasurement::Component::execute()
 
   switch (this->getState()) {
     case RT::State::EXEC:
+      // Early wake-ups are recorded as zero latency
+      durationHistogram.record(*(end_ticks) - *(start_ticks));
+      timestepHistogram.record(*(start_ticks)-last_start_ticks);
+      latencyHistogram.record(static_cast<int64_t>(stats.latency));
       writeoutput(0, stats.duration);
       writeoutput(1, stats.timestep);
       writeoutput(2, stats.latency);
@@ -151,6 +234,9 @@ void PerformanceMeasurement::Component::execute()
       latencyStat.clear();
       latencyStat.push(0.0);
       this->stats = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+      durationHistogram.clear();
+      timestepHistogram.clear();
+      latencyHistogram.clear();
       this->setState(RT::State::EXEC);
       break;
     case RT::State::PERIOD:
@@ -186,10 +272,163 @@ void PerformanceMeasurement::Panel::refresh()
   maxTimestepEdit->setText(QString::number(stats.max_timestep * nano2micro));
   timestepJitterEdit->setText(QString::number(stats.jitter * nano2micro));
   AppCpuPercentEdit->setText(QString::number(RT::OS::getCpuUsage()));
+  this->refreshOverruns();
+  this->refreshPercentiles();
+  if (profileButton->isChecked()) {
+    this->refreshProfile();
+  }
+}
+
+RT::overrun_stats_t PerformanceMeasurement::Panel::queryOverruns()
+{
+  Event::Object event(Event::Type::RT_OVERRUN_QUERY_EVENT);
+  this->getRTXIEventManager()->postEvent(&event);
+  return std::any_cast<RT::overrun_stats_t>(event.getParam("overruns"));
+}
+
+void PerformanceMeasurement::Panel::refreshOverruns()
+{
+  const RT::overrun_stats_t stats = this->queryOverruns();
+  const uint64_t overruns = stats.overruns - overruns_at_reset;
+  overrunsEdit->setText(QString::number(overruns));
+  skippedPeriodsEdit->setText(
+      QString::number(stats.skipped_periods - skipped_periods_at_reset));
+  // Draw attention to the counter as soon as a deadline is missed
+  overrunsEdit->setStyleSheet(overruns > 0 ? "color: red;" : "");
+  if (overruns == 0 || stats.recent.empty()) {
+    lastOverrunEdit->clear();
+    return;
+  }
+  const double nano2sec = 1e-9;
+  lastOverrunEdit->setText(QString::number(
+      static_cast<double>(RT::OS::getTime() - stats.recent.back().time)
+          * nano2sec,
+      'f',
+      1));
+}
+
+void PerformanceMeasurement::Panel::changeOverrunPolicy(int index)
+{
+  Event::Object event(Event::Type::RT_OVERRUN_POLICY_EVENT);
+  event.setParam("policy", static_cast<RT::OS::overrun_policy_t>(index));
+  this->getRTXIEventManager()->postEvent(&event);
+}
+
+void PerformanceMeasurement::Panel::refreshPercentiles()
+{
+  auto* hostplugin =
+      dynamic_cast<PerformanceMeasurement::Plugin*>(this->getHostPlugin());
+  const double nano2micro = 1e-3;
+  const std::array<double, 4> percents = {50.0, 99.0, 99.9, 99.99};
+  for (int column = 0; column < static_cast<int>(percents.size()); column++) {
+    const PerformanceMeasurement::performance_stats_t stats =
+        hostplugin->getPercentileStat(percents.at(static_cast<size_t>(column)));
+    const std::array<double, 3> values = {
+        stats.duration, stats.timestep, stats.latency};
+    for (int row = 0; row < static_cast<int>(values.size()); row++) {
+      auto* item = new QTableWidgetItem;
+      item->setData(Qt::DisplayRole,
+                    values.at(static_cast<size_t>(row)) * nano2micro);
+      percentileTable->setItem(row, column, item);
+    }
+  }
+}
+
+void PerformanceMeasurement::Panel::dumpHistograms()
+{
+  const QString filename = QFileDialog::getSaveFileName(
+      this, tr("Save histograms"), "", tr("Text files (*.txt);;All (*.*)"));
+  if (filename.isEmpty()) {
+    return;
+  }
+  std::ofstream file(filename.toStdString());
+  if (!file) {
+    ERROR_MSG("PerformanceMeasurement::Panel::dumpHistograms : Unable to open "
+              "{} for writing",
+              filename.toStdString());
+    QMessageBox::warning(this,
+                         tr("RT Benchmarks"),
+                         tr("Unable to write histograms to ").append(filename));
+    return;
+  }
+  auto* hostplugin =
+      dynamic_cast<PerformanceMeasurement::Plugin*>(this->getHostPlugin());
+  hostplugin->dumpHistograms(file);
+  const RT::overrun_stats_t stats = this->queryOverruns();
+  file << "\n# Missed deadlines: " << stats.overruns
+       << ", skipped periods: " << stats.skipped_periods
+       << ", times lost: " << stats.dropped << "\n";
+  file << "Time\tSkippedPeriods\n";
+  for (const auto& overrun : stats.recent) {
+    file << overrun.time << "\t" << overrun.skipped_periods << "\n";
+  }
+}
+
+void PerformanceMeasurement::Panel::toggleProfiler(bool enable)
+{
+  Event::Object event(enable ? Event::Type::RT_PROFILER_START_EVENT
+                             : Event::Type::RT_PROFILER_STOP_EVENT);
+  this->getRTXIEventManager()->postEvent(&event);
+  profileDroppedLabel->setVisible(enable);
+  profileTable->setVisible(enable);
+  this->getMdiWindow()->setFixedSize(this->minimumSizeHint());
+}
+
+void PerformanceMeasurement::Panel::refreshProfile()
+{
+  Event::Object event(Event::Type::RT_PROFILER_QUERY_EVENT);
+  this->getRTXIEventManager()->postEvent(&event);
+  const auto profile = std::any_cast<std::vector<RT::block_profile_t>>(
+      event.getParam("profile"));
+  const auto dropped =
+      std::any_cast<uint64_t>(event.getParam("profile_dropped"));
+  profileDroppedLabel->setText(
+      tr("Dropped Samples: %1").arg(static_cast<qulonglong>(dropped)));
+  profileDroppedLabel->setStyleSheet(dropped > 0 ? "color: red;" : "");
+  const double nano2micro = 1e-3;
+  profileTable->setSortingEnabled(false);
+  profileTable->setRowCount(static_cast<int>(profile.size()));
+  int row = 0;
+  for (const auto& entry : profile) {
+    QString stage;
+    switch (entry.stage) {
+      case RT::PROFILE_READ:
+        stage = "read";
+        break;
+      case RT::PROFILE_EXECUTE:
+        stage = "execute";
+        break;
+      case RT::PROFILE_PROPAGATE:
+        stage = "propagate";
+        break;
+      case RT::PROFILE_WRITE:
+        stage = "write";
+        break;
+    }
+    auto* mean_item = new QTableWidgetItem;
+    mean_item->setData(Qt::DisplayRole, entry.mean * nano2micro);
+    auto* p99_item = new QTableWidgetItem;
+    p99_item->setData(Qt::DisplayRole,
+                      static_cast<double>(entry.p99) * nano2micro);
+    auto* max_item = new QTableWidgetItem;
+    max_item->setData(Qt::DisplayRole,
+                      static_cast<double>(entry.max) * nano2micro);
+    profileTable->setItem(
+        row, 0, new QTableWidgetItem(QString::fromStdString(entry.block_name)));
+    profileTable->setItem(row, 1, new QTableWidgetItem(stage));
+    profileTable->setItem(row, 2, mean_item);
+    profileTable->setItem(row, 3, p99_item);
+    profileTable->setItem(row, 4, max_item);
+    row++;
+  }
+  profileTable->setSortingEnabled(true);
 }
 
 void PerformanceMeasurement::Panel::reset()
 {
+  const RT::overrun_stats_t stats = this->queryOverruns();
+  overruns_at_reset = stats.overruns;
+  skipped_periods_at_reset = stats.skipped_periods;
   this->update_state(RT::State::INIT);
 }
 
@@ -209,9 +448,15 @@ PerformanceMeasurement::Plugin::Plugin(Event::Manager* ev_manager)
       std::any_cast<int64_t*>(events[1].getParam("post-period")));
 
   this->component_fifo = component->getFIfoPtr();
+  this->component_ptr = performance_measurement_component;
   this->attachComponent(std::move(component));
 }
 
+std::vector<Event::Type> PerformanceMeasurement::Plugin::subscriptions() const
+{
+  return {Event::Type::RT_PERIOD_EVENT};
+}
+
 PerformanceMeasurement::performance_stats_t
 PerformanceMeasurement::Plugin::getSampleStat()
 {
@@ -224,6 +469,29 @@ PerformanceMeasurement::Plugin::getSampleStat()
   return stat;
 }
 
+PerformanceMeasurement::performance_stats_t
+PerformanceMeasurement::Plugin::getPercentileStat(double percent)
+{
+  PerformanceMeasurement::performance_stats_t stat;
+  stat.duration = static_cast<double>(
+      this->component_ptr->getDurationHistogram().percentile(percent));
+  stat.timestep = static_cast<double>(
+      this->component_ptr->getTimestepHistogram().percentile(percent));
+  stat.latency = static_cast<double>(
+      this->component_ptr->getLatencyHistogram().percentile(percent));
+  return stat;
+}
+
+void PerformanceMeasurement::Plugin::dumpHistograms(std::ostream& stream)
+{
+  stream << "# Computation time (ns)\n";
+  this->component_ptr->getDurationHistogram().dump(stream);
+  stream << "\n# Real-time period (ns)\n";
+  this->component_ptr->getTimestepHistogram().dump(stream);
+  stream << "\n# Latency (ns)\n";
+  this->component_ptr->getLatencyHistogram().dump(stream);
+}
+
 std::unique_ptr<Widgets::Plugin> PerformanceMeasurement::createRTXIPlugin(
     Event::Manager* ev_manager)
 {
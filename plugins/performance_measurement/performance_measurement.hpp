@@ -21,6 +21,7 @@
 #ifndef PERFORMANCE_MEASUREMENT_H
 #define PERFORMANCE_MEASUREMENT_H
 
+#include "math/histogram.h"
 #include "math/runningstat.h"
 #include "widgets.hpp"
 
@@ -29,7 +30,11 @@ namespace RT::OS
 class Fifo;
 }  // namespace RT::OS
 
+class QComboBox;
+class QLabel;
 class QLineEdit;
+class QPushButton;
+class QTableWidget;
 
 namespace PerformanceMeasurement
 {
@@ -61,6 +66,11 @@ inline std::vector<IO::channel_t> get_default_channels()
        IO::OUTPUT}};
 }
 
+// Histograms track values up to one second with under 1% relative error,
+// 2^-(HISTOGRAM_SUB_BUCKET_BITS - 1) = 1/128
+constexpr int64_t HISTOGRAM_HIGHEST_VALUE = 1000000000;
+constexpr int HISTOGRAM_SUB_BUCKET_BITS = 8;
+
 struct performance_stats_t
 {
   double duration = 0.0;
@@ -72,14 +82,36 @@ struct performance_stats_t
   double jitter = 0.0;
 };
 
+class Component;
+
 class Plugin : public Widgets::Plugin
 {
 public:
   explicit Plugin(Event::Manager* ev_manager);
+  std::vector<Event::Type> subscriptions() const override;
   performance_stats_t getSampleStat();
 
+  /*!
+   * Reads the value at the given percentile of the duration, timestep and
+   * latency histograms
+   *
+   * \param percent The percentile to read, between 0 and 100
+   *
+   * \return A stats object with the duration, timestep and latency fields
+   *         filled. The remaining fields are left at zero.
+   */
+  performance_stats_t getPercentileStat(double percent);
+
+  /*!
+   * Writes the duration, timestep and latency histograms as text
+   *
+   * \param stream The output stream to write the histograms to
+   */
+  void dumpHistograms(std::ostream& stream);
+
 private:
   RT::OS::Fifo* component_fifo;
+  Component* component_ptr;
 };  // class Plugin
 
 class Component : public Widgets::Component
@@ -90,10 +122,27 @@ public:
   void setTickPointers(int64_t* s_ticks, int64_t* e_ticks);
   void execute() override;
   RT::OS::Fifo* getFIfoPtr() { return this->fifo.get(); }
+  const LogLinearHistogram& getDurationHistogram() const
+  {
+    return durationHistogram;
+  }
+  const LogLinearHistogram& getTimestepHistogram() const
+  {
+    return timestepHistogram;
+  }
+  const LogLinearHistogram& getLatencyHistogram() const
+  {
+    return latencyHistogram;
+  }
 
 private:
   performance_stats_t stats;
 
+  // Written only by the real-time thread, read by the panel
+  LogLinearHistogram durationHistogram;
+  LogLinearHistogram timestepHistogram;
+  LogLinearHistogram latencyHistogram;
+
   // RunningStat timestepStat;
   RunningStat latencyStat;
 
@@ -117,6 +166,27 @@ public slots:
    * Starts the statistics over
    */
   void reset();
+
+  /*!
+   * Starts or stops timing every block in the real-time loop
+   *
+   * \param enable True to start the block profiler, false to stop it
+   */
+  void toggleProfiler(bool enable);
+
+  /*!
+   * Asks for a file and saves the duration, timestep and latency histograms
+   * in it
+   */
+  void dumpHistograms();
+
+  /*!
+   * Chooses whether the real-time loop skips or catches up on the periods
+   * it misses
+   *
+   * \param index Index of the selected policy in the policy box
+   */
+  void changeOverrunPolicy(int index);
   // void resetMaxTimeStep();
   /*!
    * Updates the GUI with the latest values
@@ -130,6 +200,23 @@ private:
   QLineEdit* maxTimestepEdit;
   QLineEdit* timestepJitterEdit;
   QLineEdit* AppCpuPercentEdit;
+  QLineEdit* overrunsEdit;
+  QLineEdit* skippedPeriodsEdit;
+  QLineEdit* lastOverrunEdit;
+  QComboBox* overrunPolicyBox;
+  QTableWidget* percentileTable;
+  QPushButton* profileButton;
+  QLabel* profileDroppedLabel;
+  QTableWidget* profileTable;
+
+  // overrun counts are shown relative to the last reset
+  uint64_t overruns_at_reset = 0;
+  uint64_t skipped_periods_at_reset = 0;
+
+  RT::overrun_stats_t queryOverruns();
+  void refreshOverruns();
+  void refreshPercentiles();
+  void refreshProfile();
 };  // class Panel
 
 std::unique_ptr<Widgets::Plugin> createRTXIPlugin(Event::Manager* ev_manager);
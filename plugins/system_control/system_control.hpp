@@ -105,6 +105,11 @@ public:
       : Widgets::Plugin(ev_manager, std::string(MODULE_NAME))
   {
   }
+
+  std::vector<Event::Type> subscriptions() const override
+  {
+    return {Event::Type::RT_PERIOD_EVENT};
+  }
 };
 
 std::unique_ptr<Widgets::Plugin> createRTXIPlugin(Event::Manager* ev_manager);
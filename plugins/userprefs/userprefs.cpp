@@ -38,6 +38,11 @@ UserPrefs::Plugin::Plugin(Event::Manager* ev_manager)
 {
 }
 
+std::vector<Event::Type> UserPrefs::Plugin::subscriptions() const
+{
+  return {Event::Type::RT_PERIOD_EVENT};
+}
+
 UserPrefs::Panel::Panel(QMainWindow* mwindow, Event::Manager* ev_manager)
     : Widgets::Panel(std::string(UserPrefs::MODULE_NAME), mwindow, ev_manager)
     , status(new QLabel)
@@ -36,6 +36,7 @@ class Plugin : public Widgets::Plugin
 {
 public:
   explicit Plugin(Event::Manager* ev_manager);
+  std::vector<Event::Type> subscriptions() const override;
 
 };  // class Prefs
 
@@ -19,10 +19,16 @@
 */
 
 #include <algorithm>
+#include <chrono>
+#include <future>
 #include <mutex>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
 
 #include "event.hpp"
 
+#include "debug.hpp"
 #include "logger.hpp"
 #include "rtos.hpp"
 
@@ -54,6 +60,24 @@ std::string Event::type_to_string(Event::Type event_type)
     case Event::Type::RT_SHUTDOWN_EVENT:
       return_string = "SYSTEM : shutdown";
       break;
+    case Event::Type::RT_PROFILER_START_EVENT:
+      return_string = "SYSTEM : block profiler started";
+      break;
+    case Event::Type::RT_PROFILER_STOP_EVENT:
+      return_string = "SYSTEM : block profiler stopped";
+      break;
+    case Event::Type::RT_PROFILER_QUERY_EVENT:
+      return_string = "SYSTEM : block profile requested";
+      break;
+    case Event::Type::RT_OVERRUN_POLICY_EVENT:
+      return_string = "SYSTEM : overrun policy change";
+      break;
+    case Event::Type::RT_OVERRUN_QUERY_EVENT:
+      return_string = "SYSTEM : overrun statistics requested";
+      break;
+    case Event::Type::RT_COMMAND_BATCH_EVENT:
+      return_string = "SYSTEM : command batch";
+      break;
     case Event::Type::RT_DEVICE_REMOVE_EVENT:
       return_string = "SYSTEM : device remove";
       break;
@@ -147,6 +171,171 @@ std::string Event::type_to_string(Event::Type event_type)
   return return_string;
 }
 
+Event::period_payload_t Event::period_payload_t::fromParams(
+    const Event::Object& event)
+{
+  return {std::any_cast<int64_t>(event.getParam("period"))};
+}
+
+std::any Event::period_payload_t::param(const std::string& param_name) const
+{
+  if (param_name == "period") {
+    return this->period;
+  }
+  return {};
+}
+
+Event::thread_payload_t Event::thread_payload_t::fromParams(
+    const Event::Object& event)
+{
+  return {std::any_cast<RT::Thread*>(event.getParam("thread"))};
+}
+
+std::any Event::thread_payload_t::param(const std::string& param_name) const
+{
+  if (param_name == "thread") {
+    return this->thread;
+  }
+  return {};
+}
+
+Event::device_payload_t Event::device_payload_t::fromParams(
+    const Event::Object& event)
+{
+  return {std::any_cast<RT::Device*>(event.getParam("device"))};
+}
+
+std::any Event::device_payload_t::param(const std::string& param_name) const
+{
+  if (param_name == "device") {
+    return this->device;
+  }
+  return {};
+}
+
+Event::widget_parameter_payload_t
+Event::widget_parameter_payload_t::fromParams(const Event::Object& event)
+{
+  Event::widget_parameter_payload_t payload;
+  payload.component =
+      std::any_cast<Widgets::Component*>(event.getParam("paramWidget"));
+  payload.id = std::any_cast<size_t>(event.getParam("paramID"));
+  payload.type = std::any_cast<Widgets::Variable::variable_t>(
+      event.getParam("paramType"));
+  const std::any value = event.getParam("paramValue");
+  if (value.type() == typeid(int64_t)) {
+    payload.value = std::any_cast<int64_t>(value);
+  } else if (value.type() == typeid(double)) {
+    payload.value = std::any_cast<double>(value);
+  } else if (value.type() == typeid(uint64_t)) {
+    payload.value = std::any_cast<uint64_t>(value);
+  } else if (value.type() == typeid(std::string)) {
+    payload.value = std::any_cast<std::string>(value);
+  }
+  return payload;
+}
+
+std::any Event::widget_parameter_payload_t::param(
+    const std::string& param_name) const
+{
+  if (param_name == "paramWidget") {
+    return this->component;
+  }
+  if (param_name == "paramID") {
+    return this->id;
+  }
+  if (param_name == "paramType") {
+    return this->type;
+  }
+  if (param_name == "paramValue") {
+    return std::visit(
+        [](const auto& stored) -> std::any
+        {
+          using value_t = std::decay_t<decltype(stored)>;
+          if constexpr (std::is_same_v<value_t, std::monostate>) {
+            return {};
+          } else {
+            return stored;
+          }
+        },
+        this->value);
+  }
+  return {};
+}
+
+Event::widget_state_payload_t Event::widget_state_payload_t::fromParams(
+    const Event::Object& event)
+{
+  return {std::any_cast<Widgets::Component*>(event.getParam("component")),
+          std::any_cast<RT::State::state_t>(event.getParam("state"))};
+}
+
+std::any Event::widget_state_payload_t::param(
+    const std::string& param_name) const
+{
+  if (param_name == "component") {
+    return this->component;
+  }
+  if (param_name == "state") {
+    return this->state;
+  }
+  return {};
+}
+
+Event::async_data_payload_t Event::async_data_payload_t::fromParams(
+    const Event::Object& event)
+{
+  return {std::any_cast<IO::Block*>(event.getParam("block")),
+          std::any_cast<size_t>(event.getParam("channel")),
+          std::any_cast<double>(event.getParam("value")),
+          std::any_cast<int64_t>(event.getParam("time"))};
+}
+
+std::any Event::async_data_payload_t::param(
+    const std::string& param_name) const
+{
+  if (param_name == "block") {
+    return this->block;
+  }
+  if (param_name == "channel") {
+    return this->channel;
+  }
+  if (param_name == "value") {
+    return this->value;
+  }
+  if (param_name == "time") {
+    return this->time;
+  }
+  return {};
+}
+
+Event::threshold_crossing_payload_t
+Event::threshold_crossing_payload_t::fromParams(const Event::Object& event)
+{
+  return {std::any_cast<IO::Block*>(event.getParam("block")),
+          std::any_cast<size_t>(event.getParam("channel")),
+          std::any_cast<double>(event.getParam("threshold")),
+          std::any_cast<int64_t>(event.getParam("time"))};
+}
+
+std::any Event::threshold_crossing_payload_t::param(
+    const std::string& param_name) const
+{
+  if (param_name == "block") {
+    return this->block;
+  }
+  if (param_name == "channel") {
+    return this->channel;
+  }
+  if (param_name == "threshold") {
+    return this->threshold;
+  }
+  if (param_name == "time") {
+    return this->time;
+  }
+  return {};
+}
+
 Event::Object::Object(Event::Type et)
     : event_type(et)
 {
@@ -154,6 +343,7 @@ Event::Object::Object(Event::Type et)
 
 Event::Object::Object(const Event::Object& obj)
     : params(obj.params)
+    , payload(obj.payload)
     , event_type(obj.event_type)
 {
 }
@@ -170,7 +360,18 @@ std::any Event::Object::getParam(const std::string& param_name) const
       return parameter.value;
     }
   }
-  return std::any {};
+  // Handlers written against named parameters still see payload fields
+  return std::visit(
+      [&param_name](const auto& value) -> std::any
+      {
+        using payload_type = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same_v<payload_type, std::monostate>) {
+          return {};
+        } else {
+          return value.param(param_name);
+        }
+      },
+      this->payload);
 }
 
 bool Event::Object::paramExists(const std::string& param_name)
@@ -181,7 +382,12 @@ bool Event::Object::paramExists(const std::string& param_name)
       result = true;
     }
   }
-  return result;
+  return result || this->getParam(param_name).has_value();
+}
+
+bool Event::Object::hasPayload() const
+{
+  return !std::holds_alternative<std::monostate>(this->payload);
 }
 
 void Event::Object::setParam(const std::string& param_name,
@@ -226,53 +432,62 @@ Event::Type Event::Object::getType() const
   return this->event_type;
 }
 
-Event::Manager::Manager()
+Event::Manager::Manager(size_t worker_count,
+                        const std::filesystem::path& logfile)
 {
   // initialize logger before creating event processing workers
-  this->logger = std::make_unique<eventLogger>();
+  this->logger = std::make_unique<eventLogger>(logfile);
+
+  this->event_pool = std::vector<std::optional<Event::Object>>(
+      Event::Manager::EVENT_POOL_SIZE);
+  this->free_events.reserve(Event::Manager::EVENT_POOL_SIZE);
+  for (size_t slot = Event::Manager::EVENT_POOL_SIZE; slot > 0; slot--) {
+    this->free_events.push_back(slot - 1);
+  }
 
   auto task = [this]
   {
-    Event::Object* event = nullptr;
     while (this->running) {
-      {
-        // check if there are available events
-        std::unique_lock<std::mutex> event_lock(this->event_mut);
-        this->available_event_cond.wait(
-            event_lock,
-            [this] { return !(this->event_q.empty()) || !this->running; });
-        // Avoid undefined behavior by checking whether queue is empty first
-        if (this->event_q.empty()) {
-          continue;
-        }
-        event = this->event_q.front();
-        this->event_q.pop();
-      }
-
-      // we should log this before letting others know we are done
-      this->logger->log(event);
-      // route the event to all handlers
-      {
-        std::shared_lock<std::shared_mutex> handlerlist_lock(
-            this->handlerlist_mut);
-        for (auto* handler : this->handlerList) {
-          handler->receiveEvent(event);
-        }
-        handlerlist_lock.unlock();
-
-        // mark event as processed
-        event->done();
+      // parks the worker until an event is available
+      Event::Object* event = this->event_q.pop(this->running);
+      if (event == nullptr) {
+        continue;
       }
+      this->route(event);
     }
   };
 
   // create event processing workers in the thread pool
-  for (size_t count = 0; count < 2; count++) {
+  worker_count = std::max<size_t>(worker_count, 1);
+  for (size_t count = 0; count < worker_count; count++) {
     this->thread_pool.emplace_back(task);
   }
   for (auto& thread : this->thread_pool) {
     RT::OS::renameOSThread(thread, std::string("RTXIEventWorker"));
   }
+
+  // asynchronous events are routed one at a time to keep their order
+  auto async_task = [this]
+  {
+    while (this->running) {
+      std::unique_lock<std::mutex> async_lock(this->async_mut);
+      this->async_cond.wait(
+          async_lock,
+          [this] { return !(this->async_q.empty()) || !this->running; });
+      if (this->async_q.empty()) {
+        continue;
+      }
+      async_event_t async_event = std::move(this->async_q.front());
+      this->async_q.pop();
+      async_lock.unlock();
+      this->route(async_event.event.get());
+      if (async_event.callback) {
+        async_event.callback(async_event.event.get());
+      }
+    }
+  };
+  this->async_thread = std::thread(async_task);
+  RT::OS::renameOSThread(this->async_thread, std::string("RTXIEventAsync"));
 }
 
 Event::Manager::~Manager()
@@ -280,16 +495,49 @@ Event::Manager::~Manager()
   Event::Object event(Event::Type::MANAGER_SHUTDOWN_EVENT);
   this->postEvent(&event);
   this->running.store(false);
-  this->available_event_cond.notify_all();
+  this->event_q.wakeAll();
+  this->async_cond.notify_all();
   for (auto& thread : this->thread_pool) {
     if (thread.joinable()) {
       thread.join();
     }
   }
-  while (!this->event_q.empty()) {
-    event_q.front()->done();
-    event_q.pop();
+  if (this->async_thread.joinable()) {
+    this->async_thread.join();
+  }
+  for (auto* pending = this->event_q.tryPop(); pending != nullptr;
+       pending = this->event_q.tryPop())
+  {
+    pending->done();
+  }
+  while (!this->async_q.empty()) {
+    async_q.pop();
+  }
+}
+
+void Event::Manager::route(Event::Object* event)
+{
+  // we should log this before letting others know we are done
+  this->logger->log(event);
+  // Events inside a batch are never routed on their own
+  if (event->getType() == Event::Type::RT_COMMAND_BATCH_EVENT
+      && event->paramExists("events"))
+  {
+    for (auto* batched : std::any_cast<std::vector<Event::Object*>>(
+             event->getParam("events")))
+    {
+      this->logger->log(batched);
+    }
+  }
+  // route the event to the handlers subscribed to its type
+  std::shared_lock<std::shared_mutex> handlerlist_lock(this->handlerlist_mut);
+  for (auto* handler : this->dispatch_table.at(event->getType())) {
+    handler->receiveEvent(event);
   }
+  handlerlist_lock.unlock();
+
+  // mark event as processed
+  event->done();
 }
 
 void Event::Manager::postEvent(Event::Object* event)
@@ -299,15 +547,86 @@ void Event::Manager::postEvent(Event::Object* event)
     return;
   }
 
-  std::unique_lock<std::mutex> lk(this->event_mut);
-  this->event_q.push(event);
-  this->available_event_cond.notify_one();
-  lk.unlock();
+  if (!this->event_q.push(event, this->running)) {
+    return;
+  }
   if (!event->isdone()) {
     event->wait();
   }
 }
 
+Event::Manager::pooled_object_t Event::Manager::acquireEvent(Event::Type type)
+{
+  std::unique_lock<std::mutex> lk(this->event_pool_mut);
+  if (this->free_events.empty()) {
+    lk.unlock();
+    return {new Event::Object(type),
+            object_releaser_t {this, Event::Manager::EVENT_POOL_SIZE}};
+  }
+  const size_t slot = this->free_events.back();
+  this->free_events.pop_back();
+  auto& event = this->event_pool[slot].emplace(type);
+  return {&event, object_releaser_t {this, slot}};
+}
+
+void Event::Manager::object_releaser_t::operator()(Event::Object* event) const
+{
+  if (this->slot == Event::Manager::EVENT_POOL_SIZE) {
+    delete event;
+    return;
+  }
+  // the slot is not shared until it is back in the free list
+  this->manager->event_pool[this->slot].reset();
+  const std::unique_lock<std::mutex> lk(this->manager->event_pool_mut);
+  this->manager->free_events.push_back(this->slot);
+}
+
+void Event::Manager::postEventAsync(Event::Manager::pooled_object_t event,
+                                    Event::Manager::completion_t callback)
+{
+  if (!this->running || event == nullptr) {
+    return;
+  }
+  std::unique_lock<std::mutex> lk(this->async_mut);
+  this->async_q.push({std::move(event), std::move(callback)});
+  lk.unlock();
+  this->async_cond.notify_one();
+}
+
+int Event::Manager::flushAsync()
+{
+  if (!this->running) {
+    return -1;
+  }
+  if (std::this_thread::get_id() == this->async_thread.get_id()) {
+    ERROR_MSG("Event::Manager::flushAsync : called from the async thread");
+    return -1;
+  }
+  // asynchronous events are handled in order, so once this one is done
+  // every event posted before it is done as well. The promise is shared
+  // with the callback, which may still run after we gave up waiting, and
+  // breaks if the manager shuts down and drops the callback unrun.
+  auto flushed = std::make_shared<std::promise<void>>();
+  auto flushed_future = flushed->get_future();
+  this->postEventAsync(this->acquireEvent(Event::Type::NOOP),
+                       [flushed](Event::Object* /*event*/)
+                       { flushed->set_value(); });
+  flushed.reset();
+  constexpr std::chrono::milliseconds poll_interval(10);
+  while (flushed_future.wait_for(poll_interval) != std::future_status::ready)
+  {
+    if (!this->running) {
+      return -1;
+    }
+  }
+  try {
+    flushed_future.get();
+  } catch (const std::future_error&) {
+    return -1;
+  }
+  return 0;
+}
+
 void Event::Manager::postEvent(std::vector<Event::Object>& events)
 {
   // Make sure the event processor is running
@@ -316,37 +635,56 @@ void Event::Manager::postEvent(std::vector<Event::Object>& events)
   }
 
   // For performance provide postEvent that accepts multiple events
-  std::unique_lock<std::mutex> lk(this->event_mut);
+  size_t posted = 0;
   for (auto& event : events) {
-    this->event_q.push(&event);
+    if (!this->event_q.push(&event, this->running)) {
+      break;
+    }
+    posted++;
   }
-  lk.unlock();
-  this->available_event_cond.notify_all();
-  for (auto& event : events) {
-    if (!event.isdone()) {
-      event.wait();
+  for (size_t index = 0; index < posted; index++) {
+    if (!events[index].isdone()) {
+      events[index].wait();
     }
   }
 }
 
 void Event::Manager::registerHandler(Event::Handler* handler)
 {
-  std::unique_lock<std::shared_mutex> write_lock(this->handlerlist_mut);
+  const std::unique_lock<std::shared_mutex> write_lock(this->handlerlist_mut);
   auto location = std::find(handlerList.begin(), handlerList.end(), handler);
-  if (location == handlerList.end()) {
-    handlerList.push_back(handler);
+  if (location != handlerList.end()) {
+    return;
+  }
+  handlerList.push_back(handler);
+  const std::vector<Event::Type> types = handler->subscriptions();
+  if (types.empty()) {
+    for (auto& handlers : this->dispatch_table) {
+      handlers.push_back(handler);
+    }
+    return;
+  }
+  for (auto type : types) {
+    auto& handlers = this->dispatch_table.at(type);
+    if (std::find(handlers.begin(), handlers.end(), handler) == handlers.end())
+    {
+      handlers.push_back(handler);
+    }
   }
-  write_lock.unlock();
 }
 
 void Event::Manager::unregisterHandler(Event::Handler* handler)
 {
-  std::unique_lock<std::shared_mutex> write_lock(this->handlerlist_mut);
+  const std::unique_lock<std::shared_mutex> write_lock(this->handlerlist_mut);
   auto location = std::find(handlerList.begin(), handlerList.end(), handler);
-  if (location != handlerList.end()) {
-    handlerList.erase(location);
+  if (location == handlerList.end()) {
+    return;
+  }
+  handlerList.erase(location);
+  for (auto& handlers : this->dispatch_table) {
+    handlers.erase(std::remove(handlers.begin(), handlers.end(), handler),
+                   handlers.end());
   }
-  write_lock.unlock();
 }
 
 bool Event::Manager::isRegistered(Event::Handler* handler)
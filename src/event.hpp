@@ -22,18 +22,50 @@
 #define EVENT_H
 
 #include <any>
+#include <array>
 #include <atomic>
 #include <condition_variable>
+#include <filesystem>
+#include <functional>
 #include <list>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <queue>
 #include <shared_mutex>
 #include <string>
 #include <thread>
+#include <variant>
 #include <vector>
 
+#include "event_queue.hpp"
+
 class eventLogger;
 
+namespace IO
+{
+class Block;
+}  // namespace IO
+
+namespace RT
+{
+class Thread;
+class Device;
+namespace State
+{
+enum state_t : int8_t;
+}  // namespace State
+}  // namespace RT
+
+namespace Widgets
+{
+class Component;
+namespace Variable
+{
+enum variable_t : size_t;
+}  // namespace Variable
+}  // namespace Widgets
+
 /*!
  * Event Oriented Classes
  *
@@ -89,6 +121,15 @@ enum Type
   GENICAM_SNAPSHOT_EVENT,
   GENERIC_WIDGET_EVENT,
   MANAGER_SHUTDOWN_EVENT,
+  RT_PROFILER_START_EVENT,
+  RT_PROFILER_STOP_EVENT,
+  RT_PROFILER_QUERY_EVENT,
+  RT_OVERRUN_POLICY_EVENT,
+  RT_OVERRUN_QUERY_EVENT,
+  // Only the batch is routed to handlers, the events inside it are just
+  // logged. Handlers interested in those types must subscribe to the batch
+  // as well, see RT::System for its parameters.
+  RT_COMMAND_BATCH_EVENT,
   NOOP
 };
 
@@ -101,6 +142,97 @@ enum Type
  */
 std::string type_to_string(Type event_type);
 
+class Object;
+
+/*!
+ * Typed payloads for the most frequently posted events
+ *
+ * A payload is stored inside the event object, so setting and reading it
+ * does not allocate or search parameter names. The struct fields are the
+ * parameter keys. Older code can still use named parameters:
+ * Object::getPayload() builds the payload from them, and Object::getParam()
+ * returns payload fields under their parameter names. The comment next to
+ * each field gives that name.
+ *
+ * \sa Event::Object::setPayload()
+ * \sa Event::Object::getPayload()
+ */
+struct period_payload_t
+{
+  int64_t period = 0;  // "period"
+
+  static period_payload_t fromParams(const Object& event);
+  std::any param(const std::string& param_name) const;
+};
+
+struct thread_payload_t
+{
+  RT::Thread* thread = nullptr;  // "thread"
+
+  static thread_payload_t fromParams(const Object& event);
+  std::any param(const std::string& param_name) const;
+};
+
+struct device_payload_t
+{
+  RT::Device* device = nullptr;  // "device"
+
+  static device_payload_t fromParams(const Object& event);
+  std::any param(const std::string& param_name) const;
+};
+
+struct widget_parameter_payload_t
+{
+  Widgets::Component* component = nullptr;  // "paramWidget"
+  size_t id = 0;  // "paramID"
+  Widgets::Variable::variable_t type {};  // "paramType"
+  // "paramValue"
+  std::variant<std::monostate, int64_t, double, uint64_t, std::string> value;
+
+  static widget_parameter_payload_t fromParams(const Object& event);
+  std::any param(const std::string& param_name) const;
+};
+
+struct widget_state_payload_t
+{
+  Widgets::Component* component = nullptr;  // "component"
+  RT::State::state_t state {};  // "state"
+
+  static widget_state_payload_t fromParams(const Object& event);
+  std::any param(const std::string& param_name) const;
+};
+
+struct async_data_payload_t
+{
+  IO::Block* block = nullptr;  // "block"
+  size_t channel = 0;  // "channel"
+  double value = 0.0;  // "value"
+  int64_t time = 0;  // "time"
+
+  static async_data_payload_t fromParams(const Object& event);
+  std::any param(const std::string& param_name) const;
+};
+
+struct threshold_crossing_payload_t
+{
+  IO::Block* block = nullptr;  // "block"
+  size_t channel = 0;  // "channel"
+  double threshold = 0.0;  // "threshold"
+  int64_t time = 0;  // "time"
+
+  static threshold_crossing_payload_t fromParams(const Object& event);
+  std::any param(const std::string& param_name) const;
+};
+
+using payload_t = std::variant<std::monostate,
+                               period_payload_t,
+                               thread_payload_t,
+                               device_payload_t,
+                               widget_parameter_payload_t,
+                               widget_state_payload_t,
+                               async_data_payload_t,
+                               threshold_crossing_payload_t>;
+
 // TODO: create a standardize way of generating events and their params
 
 /*!
@@ -144,6 +276,8 @@ public:
   /*!
    * Retrieves the parameters values attached to the event
    *
+   * Fields of a typed payload are also found under their parameter names.
+   *
    * \param Name The parameter name for which to retrieve the value of event
    * \return The value connected with the input key
    */
@@ -157,6 +291,47 @@ public:
    */
   void setParam(const std::string& param_name, const std::any& param_value);
 
+  /*!
+   * Stores a typed payload inside the event object, replacing any previous
+   * payload. This is the preferred way to attach data to events that have
+   * a payload type.
+   *
+   * \param value The payload to store
+   *
+   * \sa Event::payload_t
+   */
+  template<typename T>
+  void setPayload(const T& value)
+  {
+    this->payload = value;
+  }
+
+  /*!
+   * Retrieves the typed payload attached to the event
+   *
+   * If the event was built with named parameters instead, the payload is
+   * filled from them and an exception is thrown if any of them is missing.
+   *
+   * \return A copy of the payload
+   *
+   * \sa Event::payload_t
+   */
+  template<typename T>
+  T getPayload() const
+  {
+    if (const T* value = std::get_if<T>(&this->payload)) {
+      return *value;
+    }
+    return T::fromParams(*this);
+  }
+
+  /*!
+   * Checks whether a typed payload was attached to the event
+   *
+   * \return True if a payload was stored, false otherwise
+   */
+  bool hasPayload() const;
+
   /*!
    * Forces caller to wait for the event to be processed.
    *
@@ -207,6 +382,7 @@ private:
   };
 
   std::vector<param> params;
+  payload_t payload;
   std::mutex processing_done_mut;
   std::condition_variable processing_done_cond;
   Type event_type;
@@ -242,6 +418,19 @@ public:
    * \sa Event::Manager::postEvent()
    */
   virtual void receiveEvent(Object* event) = 0;
+
+  /*!
+   * Event types this handler wants to receive
+   *
+   * The event manager reads this list once when the handler is registered
+   * and only routes events of these types to it. An empty list, which is
+   * the default, subscribes the handler to every event type.
+   *
+   * \return A list of event types
+   *
+   * \sa Event::Manager::registerHandler()
+   */
+  virtual std::vector<Event::Type> subscriptions() const { return {}; }
 };  // class Handler
 
 /*
@@ -253,8 +442,40 @@ public:
  */
 class Manager
 {
+  struct object_releaser_t
+  {
+    Manager* manager = nullptr;
+    size_t slot = 0;
+    void operator()(Object* event) const;
+  };
+
 public:
-  Manager();
+  /*!
+   * Event object owned by the event manager. Drawn from a preallocated pool
+   * and returned to it once released.
+   *
+   * \sa Event::Manager::acquireEvent()
+   */
+  using pooled_object_t = std::unique_ptr<Object, object_releaser_t>;
+
+  /*!
+   * Function called once an asynchronous event has been handled
+   */
+  using completion_t = std::function<void(Object*)>;
+
+  /*!
+   * Creates the event manager and its pool of event processing workers
+   *
+   * Each worker routes one event at a time, so events posted from different
+   * threads are dispatched concurrently to the handlers subscribed to them.
+   *
+   * \param worker_count Number of event processing threads. At least one
+   *                     worker is always created.
+   * \param logfile Binary log receiving every routed event. An empty path
+   *                selects eventLogger::default_logfile().
+   */
+  explicit Manager(size_t worker_count = DEFAULT_WORKER_COUNT,
+                   const std::filesystem::path& logfile = {});
   Manager(const Manager& manager) = delete;  // copy constructor
   Manager& operator=(const Manager& manager) =
       delete;  // copy assignment operator
@@ -293,9 +514,53 @@ public:
    */
   void postEvent(std::vector<Object>& events);
 
+  /*!
+   * Creates an event to be posted with Event::Manager::postEventAsync()
+   *
+   * Events come from a pool kept by the manager. They are allocated on the
+   * heap only when every pooled event is in use.
+   *
+   * \param type The type of the event
+   *
+   * \return An owning pointer to a fresh event object
+   */
+  pooled_object_t acquireEvent(Event::Type type);
+
+  /*!
+   * Posts an event without waiting for it to be handled.
+   *
+   * The manager takes ownership of the event and returns immediately.
+   * Asynchronous events are routed by a dedicated thread in the order they
+   * were posted. After every handler returns, the completion callback is
+   * called from that thread, and the event is then released. Callers that
+   * need the callback on their own event loop must forward it there
+   * themselves. Events still queued when the manager shuts down are
+   * dropped without calling their callback.
+   *
+   * \param event The event to post, usually from acquireEvent()
+   * \param callback Optional function called once the event is handled
+   *
+   * \sa Event::Manager::acquireEvent()
+   */
+  void postEventAsync(pooled_object_t event, completion_t callback = nullptr);
+
+  /*!
+   * Blocks until every event posted asynchronously so far has been handled
+   *
+   * Returns early if the manager shuts down while waiting. Calling it from
+   * a completion callback, or from a handler routed an asynchronous event,
+   * fails instead of waiting on itself.
+   *
+   * \return 0 once the events are handled, -1 otherwise
+   */
+  int flushAsync();
+
   /*!
    * Registers handler in the registry
    *
+   * The handler is only called for the event types returned by
+   * Event::Handler::subscriptions() at the time of registration.
+   *
    * \param handler pointer of handler to add to registry
    */
   void registerHandler(Handler* handler);
@@ -331,15 +596,35 @@ public:
    */
   eventLogger* getLogger() { return this->logger.get(); }
 
+  static constexpr size_t DEFAULT_WORKER_COUNT = 2;
+  static constexpr size_t EVENT_POOL_SIZE = 256;
+  static constexpr size_t EVENT_QUEUE_SIZE = 1024;
+
 private:
+  // logs the event, calls its subscribers and marks it as done
+  void route(Object* event);
+
   std::list<Handler*> handlerList;
-  std::queue<Event::Object*> event_q;
-  std::mutex event_mut;  // Mutex for posting events
-  std::condition_variable available_event_cond;
+  // Handlers subscribed to each event type, in registration order
+  std::array<std::vector<Handler*>, Event::Type::NOOP + 1> dispatch_table;
+  Event::Queue event_q {EVENT_QUEUE_SIZE};
   std::atomic<bool> running = true;
-  std::thread event_thread;
   std::vector<std::thread> thread_pool;
 
+  std::mutex event_pool_mut;
+  std::vector<std::optional<Object>> event_pool;
+  std::vector<size_t> free_events;
+
+  struct async_event_t
+  {
+    pooled_object_t event;
+    completion_t callback;
+  };
+  std::queue<async_event_t> async_q;
+  std::mutex async_mut;
+  std::condition_variable async_cond;
+  std::thread async_thread;
+
   // Shared mutex allows for multiple reader single writer scenarios.
   std::shared_mutex handlerlist_mut;  // Mutex for modifying event handler queue
 
@@ -0,0 +1,150 @@
+/*
+         The Real-Time eXperiment Interface (RTXI)
+         Copyright (C) 2011 Georgia Institute of Technology, University of Utah,
+   Will Cornell Medical College
+
+         This program is free software: you can redistribute it and/or modify
+         it under the terms of the GNU General Public License as published by
+         the Free Software Foundation, either version 3 of the License, or
+         (at your option) any later version.
+
+         This program is distributed in the hope that it will be useful,
+         but WITHOUT ANY WARRANTY; without even the implied warranty of
+         MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+         GNU General Public License for more details.
+
+         You should have received a copy of the GNU General Public License
+         along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <climits>
+#include <thread>
+
+#include "event_queue.hpp"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+void futex_wait(std::atomic<uint32_t>* address, uint32_t expected)
+{
+  // Returns right away if the value changed since the waiter looked at it
+  ::syscall(SYS_futex,
+            reinterpret_cast<uint32_t*>(address),  // NOLINT
+            FUTEX_WAIT_PRIVATE,
+            expected,
+            nullptr,
+            nullptr,
+            0);
+}
+
+void futex_wake(std::atomic<uint32_t>* address, int count)
+{
+  ::syscall(SYS_futex,
+            reinterpret_cast<uint32_t*>(address),  // NOLINT
+            FUTEX_WAKE_PRIVATE,
+            count,
+            nullptr,
+            nullptr,
+            0);
+}
+}  // namespace
+
+uint32_t Event::futexParker::prepare()
+{
+  const uint32_t epoch_value = this->epoch.load(std::memory_order_acquire);
+  this->waiters.fetch_add(1, std::memory_order_relaxed);
+  // Pairs with the fence in notify(). Either the notifier sees us waiting,
+  // or we see what it published when checking our condition again.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  return epoch_value;
+}
+
+void Event::futexParker::cancel()
+{
+  this->waiters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void Event::futexParker::wait(uint32_t epoch_value)
+{
+  futex_wait(&this->epoch, epoch_value);
+  this->waiters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void Event::futexParker::notify(int count)
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (this->waiters.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  this->epoch.fetch_add(1, std::memory_order_release);
+  futex_wake(&this->epoch, count);
+}
+
+void Event::futexParker::notifyAll()
+{
+  this->epoch.fetch_add(1, std::memory_order_seq_cst);
+  futex_wake(&this->epoch, INT_MAX);
+}
+
+bool Event::Queue::push(Event::Object* event,
+                        const std::atomic<bool>& running)
+{
+  // the other side usually catches up within a few hundred nanoseconds, so
+  // retry for a little while before paying for a trip into the kernel
+  for (size_t spin = 0; spin < SPIN_LIMIT; spin++) {
+    if (this->tryPush(event)) {
+      this->not_empty.notify(1);
+      return true;
+    }
+    std::this_thread::yield();
+  }
+  while (!this->tryPush(event)) {
+    const uint32_t epoch_value = this->not_full.prepare();
+    if (this->tryPush(event)) {
+      this->not_full.cancel();
+      break;
+    }
+    if (!running) {
+      this->not_full.cancel();
+      return false;
+    }
+    this->not_full.wait(epoch_value);
+  }
+  this->not_empty.notify(1);
+  return true;
+}
+
+Event::Object* Event::Queue::pop(const std::atomic<bool>& running)
+{
+  Event::Object* event = this->tryPop();
+  for (size_t spin = 0; spin < SPIN_LIMIT && event == nullptr; spin++) {
+    std::this_thread::yield();
+    event = this->tryPop();
+  }
+  while (event == nullptr) {
+    const uint32_t epoch_value = this->not_empty.prepare();
+    event = this->tryPop();
+    if (event != nullptr) {
+      this->not_empty.cancel();
+      break;
+    }
+    if (!running) {
+      this->not_empty.cancel();
+      return nullptr;
+    }
+    this->not_empty.wait(epoch_value);
+    event = this->tryPop();
+  }
+  this->not_full.notify(1);
+  return event;
+}
+
+void Event::Queue::wakeAll()
+{
+  this->not_empty.notifyAll();
+  this->not_full.notifyAll();
+}
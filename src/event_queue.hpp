@@ -0,0 +1,242 @@
+/*
+         The Real-Time eXperiment Interface (RTXI)
+         Copyright (C) 2011 Georgia Institute of Technology, University of Utah,
+   Will Cornell Medical College
+
+         This program is free software: you can redistribute it and/or modify
+         it under the terms of the GNU General Public License as published by
+         the Free Software Foundation, either version 3 of the License, or
+         (at your option) any later version.
+
+         This program is distributed in the hope that it will be useful,
+         but WITHOUT ANY WARRANTY; without even the implied warranty of
+         MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+         GNU General Public License for more details.
+
+         You should have received a copy of the GNU General Public License
+         along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Event
+{
+
+class Object;
+
+/*!
+ * Parking spot for threads waiting on a lock-free structure
+ *
+ * Waiters register before sleeping on a futex, so notifiers only pay for a
+ * system call when somebody is actually parked. A waiter calls prepare(),
+ * checks its wakeup condition once more, and then either cancel() or
+ * wait() with the value returned by prepare().
+ */
+class futexParker
+{
+public:
+  uint32_t prepare();
+  void cancel();
+  void wait(uint32_t epoch_value);
+  void notify(int count);
+  void notifyAll();
+
+private:
+  std::atomic<uint32_t> epoch = 0;
+  std::atomic<uint32_t> waiters = 0;
+};
+
+/*!
+ * Bounded lock-free multi-producer multi-consumer ring buffer
+ *
+ * Every slot carries a sequence number telling whether it is ready to be
+ * written or read for the current lap around the ring, so producers and
+ * consumers only contend on their own index. Values are copied in and out
+ * of the slots, and neither side ever blocks.
+ */
+template<class T>
+class boundedRing
+{
+public:
+  /*!
+   * \param capacity Number of values the ring can hold. Rounded up to a
+   *                 power of two.
+   */
+  explicit boundedRing(size_t capacity)
+  {
+    size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    this->cells = std::make_unique<cell_t[]>(size);  // NOLINT
+    for (size_t index = 0; index < size; index++) {
+      this->cells[index].sequence.store(index, std::memory_order_relaxed);
+    }
+    this->mask = size - 1;
+  }
+
+  /*!
+   * Adds a value without blocking
+   *
+   * \param value The value to add
+   * \return true if added, false if the ring is full
+   */
+  bool tryPush(const T& value)
+  {
+    size_t pos = this->enqueue_pos.load(std::memory_order_relaxed);
+    while (true) {
+      cell_t& cell = this->cells[pos & this->mask];
+      const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      const auto diff =
+          static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+      if (diff == 0) {
+        // the slot is free for this lap, claim it
+        if (this->enqueue_pos.compare_exchange_weak(
+                pos, pos + 1, std::memory_order_relaxed))
+        {
+          cell.value = value;
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        // the consumer of the previous lap has not released it yet
+        return false;
+      } else {
+        pos = this->enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /*!
+   * Removes the oldest value without blocking
+   *
+   * \param value Receives the removed value
+   * \return true if a value was removed, false if the ring is empty
+   */
+  bool tryPop(T& value)
+  {
+    size_t pos = this->dequeue_pos.load(std::memory_order_relaxed);
+    while (true) {
+      cell_t& cell = this->cells[pos & this->mask];
+      const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      const auto diff =
+          static_cast<int64_t>(sequence) - static_cast<int64_t>(pos + 1);
+      if (diff == 0) {
+        if (this->dequeue_pos.compare_exchange_weak(
+                pos, pos + 1, std::memory_order_relaxed))
+        {
+          value = cell.value;
+          // hand the slot over to the producer of the next lap
+          cell.sequence.store(pos + this->mask + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = this->dequeue_pos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  size_t getCapacity() const { return this->mask + 1; }
+
+private:
+  static constexpr size_t CACHE_LINE_SIZE = 64;
+
+  struct cell_t
+  {
+    std::atomic<size_t> sequence;
+    T value {};
+  };
+
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqueue_pos = 0;
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> dequeue_pos = 0;
+  alignas(CACHE_LINE_SIZE) std::unique_ptr<cell_t[]> cells;  // NOLINT
+  size_t mask = 0;
+};
+
+/*!
+ * Bounded lock-free multi-producer multi-consumer queue of events
+ *
+ * Built on Event::boundedRing. Threads that find the queue full or empty
+ * retry briefly and then park on a futex until the other side makes
+ * progress.
+ */
+class Queue
+{
+public:
+  /*!
+   * \param capacity Number of events the queue can hold. Rounded up to a
+   *                 power of two.
+   */
+  explicit Queue(size_t capacity) : ring(capacity) {}
+  Queue(const Queue&) = delete;
+  Queue& operator=(const Queue&) = delete;
+  Queue(Queue&&) = delete;
+  Queue& operator=(Queue&&) = delete;
+  ~Queue() = default;
+
+  /*!
+   * Adds an event without blocking
+   *
+   * \param event The event to add
+   * \return true if added, false if the queue is full
+   */
+  bool tryPush(Object* event) { return this->ring.tryPush(event); }
+
+  /*!
+   * Removes the oldest event without blocking
+   *
+   * \return The event, or nullptr if the queue is empty
+   */
+  Object* tryPop()
+  {
+    Object* event = nullptr;
+    this->ring.tryPop(event);
+    return event;
+  }
+
+  /*!
+   * Adds an event, parking the calling thread while the queue is full
+   *
+   * \param event The event to add
+   * \param running Flag checked while parked
+   * \return true if added, false if running was cleared before that
+   */
+  bool push(Object* event, const std::atomic<bool>& running);
+
+  /*!
+   * Removes the oldest event, parking the calling thread while the queue is
+   * empty
+   *
+   * \param running Flag checked while parked
+   * \return The event, or nullptr once running is cleared
+   */
+  Object* pop(const std::atomic<bool>& running);
+
+  /*!
+   * Wakes every parked thread so that they notice a cleared running flag
+   */
+  void wakeAll();
+
+  size_t getCapacity() const { return this->ring.getCapacity(); }
+
+private:
+  static constexpr size_t CACHE_LINE_SIZE = 64;
+  static constexpr size_t SPIN_LIMIT = 64;
+
+  boundedRing<Object*> ring;
+  alignas(CACHE_LINE_SIZE) futexParker not_empty;
+  alignas(CACHE_LINE_SIZE) futexParker not_full;
+};
+
+}  // namespace Event
+
+#endif  // EVENT_QUEUE_H
@@ -18,25 +18,82 @@
 
 */
 
+#include <algorithm>
 #include <array>
-#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 #include "fifo.hpp"
 
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <sys/poll.h>
+#include <unistd.h>
+
 #include "debug.hpp"
 
-// Generic posix fifo based on pipes
+// Generic fifo for real-time cores without native IPC
 namespace RT::OS
 {
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// How long a ui writer sleeps before retrying a full ring
+constexpr auto XBUFF_WRITE_RETRY = std::chrono::microseconds(100);
+
+// Wait-free single producer single consumer byte ring. Indices grow
+// monotonically and are published with release stores, so neither side
+// ever blocks the other. Each side keeps a cached copy of the other's
+// index and only touches the shared cache line when that copy says the
+// ring is full/empty.
+//
+// The storage is followed by an overflow area of the same size. A write
+// that runs past the end of the ring is kept in both places: the overflow
+// area and the start of the ring. Reservations and peeks are then
+// contiguous up to the end of that write, without the mirrored mapping of
+// the posix backend.
+class xbuffRing
+{
+public:
+  explicit xbuffRing(size_t size);
+
+  int64_t push(const void* buf, size_t data_size);
+  int64_t pop(void* buf, size_t data_size);
+  char* reserve(size_t data_size);
+  void commit(size_t data_size);
+  RT::OS::fifo_span_t peek();
+  void consume(size_t data_size);
+  bool empty() const;
+
+private:
+  size_t offset(uint64_t index) const { return index % this->capacity; }
+
+  // written by producer only
+  alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head = 0;
+  uint64_t cached_tail = 0;
+  // index right after the last write that ran past the end of the ring
+  std::atomic<uint64_t> wrap_end = 0;
+
+  // written by consumer only
+  alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> tail = 0;
+  uint64_t cached_head = 0;
+
+  // read only after construction
+  alignas(CACHE_LINE_SIZE) std::vector<char> storage;
+  size_t capacity = 0;
+};
+
 class xbuffFifo : public RT::OS::Fifo
 {
 public:
   explicit xbuffFifo(size_t size);
   xbuffFifo(const xbuffFifo& fifo) = delete;
   xbuffFifo& operator=(const xbuffFifo& fifo) = delete;
-  xbuffFifo(xbuffFifo&&) = default;
-  xbuffFifo& operator=(xbuffFifo&&) = default;
+  xbuffFifo(xbuffFifo&&) = delete;
+  xbuffFifo& operator=(xbuffFifo&&) = delete;
   ~xbuffFifo() override;
 
   size_t getCapacity() override;
@@ -44,146 +101,281 @@ public:
   int64_t write(void* buf, size_t data_size) override;
   int64_t readRT(void* buf, size_t data_size) override;
   int64_t writeRT(void* buf, size_t data_size) override;
+  RT::OS::fifo_span_t reserveRT(size_t data_size) override;
+  void commitRT(size_t data_size) override;
+  RT::OS::fifo_span_t peek() override;
+  void consume(size_t data_size) override;
   void poll() override;
   void close() override;
+  int getErrorCode() const { return this->errcode; }
 
 private:
-  char* rt_to_ui;  // 0 is read from rt; 1 is write to ui
-  char* ui_to_rt;  // 0 is read from ui; 1 is write to rt
+  void wakeup_reader();
+
+  xbuffRing rt_to_ui;
+  xbuffRing ui_to_rt;
+  std::mutex write_mut;
   const uint64_t fifo_capacity;
-  std::mutex mutex_rt2ui;
-  std::mutex mutex_ui2rt;
-  uint64_t ui_rptr = 0;
-  uint64_t ui_wptr = 0;
-  uint64_t rt_rptr = 0;
-  uint64_t rt_wptr = 0;
-  uint64_t ui_available_read_bytes;
-  uint64_t ui_available_write_bytes;
-  uint64_t rt_available_read_bytes;
-  uint64_t rt_available_write_bytes;
-
-  // synchronization primitives specific to poll function
-  std::mutex ui_read_mut;
-  std::condition_variable available_read_cond;
-  bool rt_closed = false;
-  void flush_buff();
+
+  // The real-time side only signals the eventfd when the reader is parked
+  // in poll(), which can only happen while the ring is empty. Wakeups are
+  // limited to empty to non-empty transitions and never take a lock.
+  int data_event_fd = -1;
+  int close_event_fd = -1;
+  std::array<struct pollfd, 2> xbuf_poll_fd {};
+  std::atomic<bool> reader_waiting = false;
+  std::atomic<bool> closed = false;
+  int errcode = 0;
 };
 }  // namespace RT::OS
 
-RT::OS::xbuffFifo::xbuffFifo(size_t size)
-    : fifo_capacity(size)
+RT::OS::xbuffRing::xbuffRing(size_t size)
+    : storage(2 * size)
+    , capacity(size)
 {
-  rt_to_ui = new char[this->fifo_capacity];
-  ui_to_rt = new char[this->fifo_capacity];
 }
 
-RT::OS::xbuffFifo::~xbuffFifo()
+char* RT::OS::xbuffRing::reserve(size_t data_size)
 {
-  delete[] rt_to_ui;
-  delete[] ui_to_rt;
+  const uint64_t wptr = this->head.load(std::memory_order_relaxed);
+  if (this->capacity - (wptr - this->cached_tail) < data_size) {
+    this->cached_tail = this->tail.load(std::memory_order_acquire);
+    if (this->capacity - (wptr - this->cached_tail) < data_size) {
+      return nullptr;
+    }
+  }
+  // Anything past the end of the ring lands in the overflow area
+  return this->storage.data() + this->offset(wptr);
 }
 
-int64_t RT::OS::xbuffFifo::read(void* buf, size_t data_size)
+void RT::OS::xbuffRing::commit(size_t data_size)
 {
-  if (rt_wptr == ui_rptr) {
-    return -1;
+  const uint64_t wptr = this->head.load(std::memory_order_relaxed);
+  const size_t end = this->offset(wptr) + data_size;
+  if (end > this->capacity) {
+    memcpy(this->storage.data(),
+           this->storage.data() + this->capacity,
+           end - this->capacity);
+    this->wrap_end.store(wptr + data_size, std::memory_order_relaxed);
   }
-  std::unique_lock<std::mutex> lock(mutex_rt2ui);
-  // return if the caller requests more data than available
-  if (ui_available_read_bytes < data_size) {
-    return -1;
+  this->head.store(wptr + data_size, std::memory_order_release);
+}
+
+RT::OS::fifo_span_t RT::OS::xbuffRing::peek()
+{
+  const uint64_t rptr = this->tail.load(std::memory_order_relaxed);
+  this->cached_head = this->head.load(std::memory_order_acquire);
+  const uint64_t available = this->cached_head - rptr;
+  if (available == 0) {
+    return {};
+  }
+  const size_t start = this->offset(rptr);
+  // Past the end of the ring only the write that crossed it is mirrored in
+  // the overflow area. Ordered before head, so it is current whenever the
+  // available data crosses the end.
+  uint64_t contiguous = this->capacity - start;
+  const uint64_t mirrored = this->wrap_end.load(std::memory_order_relaxed);
+  if (mirrored > rptr + contiguous) {
+    contiguous = mirrored - rptr;
+  }
+  const size_t count = std::min<uint64_t>(available, contiguous);
+  return {this->storage.data() + start, count};
+}
+
+void RT::OS::xbuffRing::consume(size_t data_size)
+{
+  const uint64_t rptr = this->tail.load(std::memory_order_relaxed);
+  this->tail.store(rptr + data_size, std::memory_order_release);
+}
+
+int64_t RT::OS::xbuffRing::push(const void* buf, size_t data_size)
+{
+  const uint64_t wptr = this->head.load(std::memory_order_relaxed);
+  if (this->capacity - (wptr - this->cached_tail) < data_size) {
+    this->cached_tail = this->tail.load(std::memory_order_acquire);
+    if (this->capacity - (wptr - this->cached_tail) < data_size) {
+      return -1;
+    }
   }
-  if (fifo_capacity - ui_rptr < data_size) {
-    uint64_t m = fifo_capacity - ui_rptr;
-    memcpy(buf, rt_to_ui + ui_rptr, m);
-    memcpy(reinterpret_cast<char*>(buf) + m, rt_to_ui, data_size - m);
-  } else {
-    memcpy(buf, rt_to_ui + ui_rptr, data_size);
+  const size_t start = this->offset(wptr);
+  const size_t first = std::min(data_size, this->capacity - start);
+  memcpy(this->storage.data() + start, buf, first);
+  if (first < data_size) {
+    memcpy(this->storage.data() + this->capacity,
+           static_cast<const char*>(buf) + first,
+           data_size - first);
+    memcpy(this->storage.data(),
+           static_cast<const char*>(buf) + first,
+           data_size - first);
+    this->wrap_end.store(wptr + data_size, std::memory_order_relaxed);
   }
-  ui_rptr = (ui_rptr + data_size) % this->fifo_capacity;
-  ui_available_read_bytes = (fifo_capacity + ui_rptr - rt_wptr) % fifo_capacity;
+  this->head.store(wptr + data_size, std::memory_order_release);
   return static_cast<int64_t>(data_size);
 }
 
-int64_t RT::OS::xbuffFifo::write(void* buf, size_t data_size)
+int64_t RT::OS::xbuffRing::pop(void* buf, size_t data_size)
 {
-  if (data_size > fifo_capacity - rt_available_read_bytes) {
-    ERROR_MSG("FIFO::write : Fifo full, data lost\n");
+  const uint64_t rptr = this->tail.load(std::memory_order_relaxed);
+  if (this->cached_head - rptr < data_size) {
+    this->cached_head = this->head.load(std::memory_order_acquire);
+  }
+  const uint64_t available = this->cached_head - rptr;
+  if (available == 0) {
     return -1;
   }
+  const size_t count = std::min<uint64_t>(available, data_size);
+  const size_t start = this->offset(rptr);
+  const size_t first = std::min(count, this->capacity - start);
+  memcpy(buf, this->storage.data() + start, first);
+  memcpy(static_cast<char*>(buf) + first,
+         this->storage.data(),
+         count - first);
+  this->tail.store(rptr + count, std::memory_order_release);
+  return static_cast<int64_t>(count);
+}
 
-  if (data_size > fifo_capacity - ui_wptr) {
-    uint64_t m = fifo_capacity - ui_wptr;
-    memcpy(ui_to_rt + ui_wptr, buf, m);
-    memcpy(ui_to_rt, reinterpret_cast<const char*>(buf) + m, data_size - m);
-  } else {
-    memcpy(ui_to_rt + ui_wptr, buf, data_size);
+bool RT::OS::xbuffRing::empty() const
+{
+  return this->head.load(std::memory_order_acquire)
+      == this->tail.load(std::memory_order_relaxed);
+}
+
+RT::OS::xbuffFifo::xbuffFifo(size_t size)
+    : rt_to_ui(size)
+    , ui_to_rt(size)
+    , fifo_capacity(size)
+{
+  // setup polling mechanism (polling only supported from ui read side)
+  this->data_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  this->close_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (this->data_event_fd < 0 || this->close_event_fd < 0) {
+    this->errcode = errno;
+    ERROR_MSG("RT::OS::xbuffFifo : Unable to create event descriptors");
+    return;
   }
-  ui_wptr = (ui_wptr + data_size) % fifo_capacity;
-  rt_available_read_bytes = (fifo_capacity + rt_rptr - ui_wptr) % fifo_capacity;
-  return static_cast<int64_t>(data_size);
+  this->xbuf_poll_fd[0].fd = this->data_event_fd;
+  this->xbuf_poll_fd[0].events = POLLIN;
+  this->xbuf_poll_fd[1].fd = this->close_event_fd;
+  this->xbuf_poll_fd[1].events = POLLIN;
 }
 
-int64_t RT::OS::xbuffFifo::readRT(void* buf, size_t data_size)
+RT::OS::xbuffFifo::~xbuffFifo()
 {
-  if (ui_wptr == rt_rptr) {
-    return -1;
+  if (this->data_event_fd >= 0) {
+    ::close(this->data_event_fd);
+  }
+  if (this->close_event_fd >= 0) {
+    ::close(this->close_event_fd);
   }
-  std::unique_lock<std::mutex> lock(mutex_rt2ui);
-  // return if the caller requests more data than available
-  if (rt_available_read_bytes < data_size) {
+}
+
+int64_t RT::OS::xbuffFifo::read(void* buf, size_t data_size)
+{
+  return this->rt_to_ui.pop(buf, data_size);
+}
+
+int64_t RT::OS::xbuffFifo::write(void* buf, size_t data_size)
+{
+  if (data_size > this->fifo_capacity) {
+    ERROR_MSG("FIFO::write : {} bytes do not fit in the fifo\n", data_size);
     return -1;
   }
-  if (fifo_capacity - rt_rptr < data_size) {
-    uint64_t m = fifo_capacity - rt_rptr;
-    memcpy(buf, ui_to_rt + rt_rptr, m);
-    memcpy(reinterpret_cast<char*>(buf) + m, ui_to_rt, data_size - m);
-  } else {
-    memcpy(buf, ui_to_rt + rt_rptr, data_size);
+  // ui threads take turns as the single producer of ui_to_rt and wait for
+  // the real-time thread to make room
+  const std::unique_lock<std::mutex> lk(this->write_mut);
+  int64_t written = this->ui_to_rt.push(buf, data_size);
+  while (written < 0 && !this->closed) {
+    std::this_thread::sleep_for(XBUFF_WRITE_RETRY);
+    written = this->ui_to_rt.push(buf, data_size);
   }
-  rt_rptr = (rt_rptr + data_size) % this->fifo_capacity;
-  rt_available_read_bytes = (fifo_capacity + rt_rptr - ui_wptr) % fifo_capacity;
-  return static_cast<int64_t>(data_size);
+  if (written < 0) {
+    ERROR_MSG("FIFO::write : Fifo closed, data lost\n");
+  }
+  return written;
+}
+
+int64_t RT::OS::xbuffFifo::readRT(void* buf, size_t data_size)
+{
+  return this->ui_to_rt.pop(buf, data_size);
 }
 
 int64_t RT::OS::xbuffFifo::writeRT(void* buf, size_t data_size)
 {
-  if (data_size > fifo_capacity - ui_available_read_bytes) {
-    ERROR_MSG("FIFO::write : Fifo full, data lost\n");
-    return -1;
+  const int64_t written = this->rt_to_ui.push(buf, data_size);
+  if (written > 0) {
+    this->wakeup_reader();
   }
+  return written;
+}
 
-  if (data_size > fifo_capacity - rt_wptr) {
-    uint64_t m = fifo_capacity - rt_wptr;
-    memcpy(rt_to_ui + rt_wptr, buf, m);
-    memcpy(rt_to_ui, reinterpret_cast<const char*>(buf) + m, data_size - m);
-  } else {
-    memcpy(rt_to_ui + rt_wptr, buf, data_size);
+RT::OS::fifo_span_t RT::OS::xbuffFifo::reserveRT(size_t data_size)
+{
+  char* region = this->rt_to_ui.reserve(data_size);
+  if (region == nullptr) {
+    return {};
   }
-  rt_wptr = (rt_wptr + data_size) % fifo_capacity;
-  ui_available_read_bytes = (fifo_capacity + ui_rptr - rt_wptr) % fifo_capacity;
-  this->available_read_cond.notify_one();
-  return static_cast<int64_t>(data_size);
+  return {region, data_size};
 }
 
-void RT::OS::xbuffFifo::poll()
+void RT::OS::xbuffFifo::commitRT(size_t data_size)
+{
+  this->rt_to_ui.commit(data_size);
+  this->wakeup_reader();
+}
+
+RT::OS::fifo_span_t RT::OS::xbuffFifo::peek()
+{
+  return this->rt_to_ui.peek();
+}
+
+void RT::OS::xbuffFifo::consume(size_t data_size)
 {
-  std::unique_lock<std::mutex> lk(this->ui_read_mut);
-  if (ui_available_read_bytes == 0) {
-    this->available_read_cond.wait(
-        lk, [this]() { return ui_available_read_bytes != 0 || rt_closed; });
+  this->rt_to_ui.consume(data_size);
+}
+
+void RT::OS::xbuffFifo::wakeup_reader()
+{
+  // Pairs with the fence in poll(). Either we observe the parked reader, or
+  // the reader observes our data before parking.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (this->reader_waiting.load(std::memory_order_relaxed)
+      && this->reader_waiting.exchange(false, std::memory_order_relaxed))
+  {
+    const uint64_t count = 1;
+    ::write(this->data_event_fd, &count, sizeof(uint64_t));
   }
 }
 
-void RT::OS::xbuffFifo::flush_buff()
+void RT::OS::xbuffFifo::poll()
 {
-  this->rt_closed = true;
-  this->available_read_cond.notify_all();
+  this->reader_waiting.store(true, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!this->rt_to_ui.empty() || this->closed) {
+    this->reader_waiting.store(false, std::memory_order_relaxed);
+    return;
+  }
+  if (::poll(this->xbuf_poll_fd.data(), 2, -1) < 0) {
+    std::string errbuff(255, '\0');
+    ERROR_MSG("RT::OS::FIFO(generic)::poll : {}",
+              strerror_r(errno, errbuff.data(), errbuff.size()));
+    this->reader_waiting.store(false, std::memory_order_relaxed);
+    return;
+  }
+  if ((this->xbuf_poll_fd[0].revents & POLLIN) != 0) {
+    uint64_t count = 0;
+    ::read(this->data_event_fd, &count, sizeof(uint64_t));
+  }
+  if ((this->xbuf_poll_fd[1].revents & POLLIN) != 0) {
+    this->closed = true;
+  }
+  this->reader_waiting.store(false, std::memory_order_relaxed);
 }
 
 void RT::OS::xbuffFifo::close()
 {
-  this->flush_buff();
+  const uint64_t count = 1;
+  this->closed = true;
+  ::write(this->close_event_fd, &count, sizeof(uint64_t));
 }
 
 size_t RT::OS::xbuffFifo::getCapacity()
@@ -191,9 +383,18 @@ size_t RT::OS::xbuffFifo::getCapacity()
   return this->fifo_capacity;
 }
 
-int RT::OS::getFifo(std::unique_ptr<Fifo>& fifo, size_t fifo_size)
+int RT::OS::getFifo(std::unique_ptr<Fifo>& fifo,
+                    size_t fifo_size,
+                    fifo_backend_t /*backend*/)
 {
   auto tmp_fifo = std::make_unique<RT::OS::xbuffFifo>(fifo_size);
+  const int errcode = tmp_fifo->getErrorCode();
+  if (errcode != 0) {
+    std::string errbuff(255, '\0');
+    ERROR_MSG("RT::OS::getFifo(generic) : {}",
+              strerror_r(errcode, errbuff.data(), errbuff.size()));
+    return errcode;
+  }
   fifo = std::move(tmp_fifo);
   return 0;
 }
@@ -21,12 +21,29 @@
 #ifndef FIFO_H
 #define FIFO_H
 
+#include <cstdint>
 #include <memory>
 
 #include <sys/types.h>
 
 namespace RT::OS
 {
+/*!
+ * Contiguous region of memory inside the fifo storage.
+ *
+ * An empty span (data equal to nullptr) means the fifo could not provide
+ * the region, either because there is not enough space/data or because the
+ * underlying implementation does not expose its storage.
+ *
+ * \param data Pointer to the first byte of the region
+ * \param size Number of bytes available in the region
+ */
+typedef struct fifo_span_t
+{
+  void* data = nullptr;
+  size_t size = 0;
+} fifo_span_t;
+
 /*!
 Simple FIFO(First In First Out) for data transfer between RTXI threads
 
@@ -65,7 +82,8 @@ public:
 
   /*!
    * Write to the FIFO storage for the realtime thread. Must be run from non-rt
-   * thread.
+   * thread. Several non-rt threads may write at the same time. Blocks while
+   * the FIFO is full.
    *
    * \param buf The buffer holding the data to write to the FIFO.
    * \param data_size The size of the data to read from the buffer in bytes
@@ -94,6 +112,56 @@ public:
    */
   virtual int64_t writeRT(void* buf, size_t data_size) = 0;
 
+  /*!
+   * Reserve space in the FIFO storage for the non-RT thread. Must be run from
+   * realtime thread.
+   *
+   * The caller writes directly into the returned region and then publishes
+   * it with commitRT(). No copy is performed. If the fifo only ever
+   * transports a single record type the region is aligned to that record.
+   * Implementations that do not expose their storage return an empty span,
+   * in which case writeRT() should be used instead.
+   *
+   * \param data_size The number of contiguous bytes to reserve
+   * \return Region of exactly data_size bytes, or an empty span
+   *
+   * \sa RT::OS::Fifo::commitRT()
+   */
+  virtual fifo_span_t reserveRT(size_t /*data_size*/) { return {}; }
+
+  /*!
+   * Publish data previously written into a region from reserveRT(). Must be
+   * run from realtime thread.
+   *
+   * \param data_size Number of bytes to publish. Must not exceed the size of
+   *     the last reserved region.
+   */
+  virtual void commitRT(size_t /*data_size*/) {}
+
+  /*!
+   * Obtain the data written by the realtime thread without copying. Must be
+   * run from non-rt thread.
+   *
+   * The region remains valid and unchanged until consume() is called.
+   * Implementations that do not expose their storage return an empty span,
+   * in which case read() should be used instead.
+   *
+   * \return Contiguous region holding all data currently available, or an
+   *     empty span if there is none
+   *
+   * \sa RT::OS::Fifo::consume()
+   */
+  virtual fifo_span_t peek() { return {}; }
+
+  /*!
+   * Release data obtained through peek() back to the realtime thread. Must be
+   * run from non-rt thread.
+   *
+   * \param data_size Number of bytes to release. Must not exceed the size of
+   *     the last peeked region.
+   */
+  virtual void consume(size_t /*data_size*/) {}
+
   /*!
    * Get the memory capacity of the fifo
    *
@@ -116,6 +184,19 @@ public:
   virtual void close() = 0;
 };
 
+/*!
+ * Backing storage requested from RT::OS::getFifo
+ *
+ * Real-time cores with native IPC (evl, xenomai) always use their own
+ * buffers and ignore this value. The posix core honors it.
+ */
+enum fifo_backend_t : int8_t
+{
+  DEFAULT_FIFO = 0, /*!< Fastest backend available for the core    */
+  PIPE_FIFO, /*!< Kernel pipes. Every read/write is a syscall   */
+  RING_FIFO /*!< Lock-free shared memory ring buffer         */
+};
+
 /*!
  * Obtain the Fifo object for this architecture.
  *
@@ -124,9 +205,12 @@ public:
  *
  * \param fifo The fifo object to store the newly created fifo.
  * \param fifo_size The size of the fifo to create in bytes
+ * \param backend The type of storage to use for the fifo
  * \returns 0 if successful, and errno otherwise.
  */
-int getFifo(std::unique_ptr<Fifo>& fifo, size_t fifo_size);
+int getFifo(std::unique_ptr<Fifo>& fifo,
+            size_t fifo_size,
+            fifo_backend_t backend = DEFAULT_FIFO);
 }  // namespace RT::OS
 
 #endif /* FIFO_H */
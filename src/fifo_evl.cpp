@@ -121,8 +121,11 @@ size_t RT::OS::evlFifo::getCapacity()
   return this->fifo_capacity;
 }
 
-int RT::OS::getFifo(std::unique_ptr<Fifo>& fifo, size_t fifo_size)
+int RT::OS::getFifo(std::unique_ptr<Fifo>& fifo,
+                    size_t fifo_size,
+                    fifo_backend_t /*backend*/)
 {
+  // evl cross-buffers are always used regardless of requested backend
   int init_state = 0;
   auto tmp_fifo = std::make_unique<RT::OS::evlFifo>(fifo_size);
   if (tmp_fifo->buffer_fd() < 0) {
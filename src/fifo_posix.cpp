@@ -18,12 +18,20 @@
 
 */
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
 
 #include "fifo.hpp"
 
+#include <errno.h>
 #include <fcntl.h>
 #include <sys/eventfd.h>
+#include <sys/mman.h>
 #include <sys/poll.h>
 #include <unistd.h>
 
@@ -61,6 +69,96 @@ private:
   bool closed = false;
   int errcode = 0;
 };
+
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// How long a ui writer sleeps before retrying a full ring
+constexpr auto RING_WRITE_RETRY = std::chrono::microseconds(100);
+
+// Single producer single consumer byte ring. The storage is a memfd mapped
+// twice back to back, so any region of up to storage_size bytes is
+// contiguous in virtual memory and copies never have to be split at the
+// wrap point. Indices grow monotonically and are only masked when turned
+// into addresses. Producer and consumer state live on separate cache lines
+// and each side keeps a cached copy of the other's index so that the shared
+// line is only touched when the cached value says the ring is full/empty.
+class spscRing
+{
+public:
+  explicit spscRing(size_t size);
+  spscRing(const spscRing& ring) = delete;
+  spscRing& operator=(const spscRing& ring) = delete;
+  spscRing(spscRing&&) = delete;
+  spscRing& operator=(spscRing&&) = delete;
+  ~spscRing();
+
+  int64_t push(const void* buf, size_t data_size);
+  int64_t pop(void* buf, size_t data_size);
+  char* reserve(size_t data_size);
+  void commit(size_t data_size);
+  RT::OS::fifo_span_t peek();
+  void consume(size_t data_size);
+  bool empty() const;
+  int getErrorCode() const { return this->errcode; }
+
+private:
+  // written by producer only
+  alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head = 0;
+  uint64_t cached_tail = 0;
+
+  // written by consumer only
+  alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> tail = 0;
+  uint64_t cached_head = 0;
+
+  // read only after construction
+  alignas(CACHE_LINE_SIZE) char* storage = nullptr;
+  size_t storage_size = 0;
+  size_t capacity = 0;
+  int errcode = 0;
+};
+
+// Posix fifo based on lock-free rings. The real-time side never performs
+// a syscall unless the ui side is sleeping inside poll(), in which case a
+// single eventfd write wakes it up. Any number of ui threads may call
+// write(), they take turns as the single producer of ui_to_rt.
+class posixRingFifo : public RT::OS::Fifo
+{
+public:
+  explicit posixRingFifo(size_t size);
+  posixRingFifo(const posixRingFifo& fifo) = delete;
+  posixRingFifo& operator=(const posixRingFifo& fifo) = delete;
+  posixRingFifo(posixRingFifo&&) = delete;
+  posixRingFifo& operator=(posixRingFifo&&) = delete;
+  ~posixRingFifo() override;
+
+  size_t getCapacity() override;
+  int64_t read(void* buf, size_t data_size) override;
+  int64_t write(void* buf, size_t data_size) override;
+  int64_t readRT(void* buf, size_t data_size) override;
+  int64_t writeRT(void* buf, size_t data_size) override;
+  RT::OS::fifo_span_t reserveRT(size_t data_size) override;
+  void commitRT(size_t data_size) override;
+  RT::OS::fifo_span_t peek() override;
+  void consume(size_t data_size) override;
+  void poll() override;
+  void close() override;
+  int getErrorCode() const;
+
+private:
+  void wakeup_reader();
+
+  spscRing rt_to_ui;
+  spscRing ui_to_rt;
+  std::mutex write_mut;
+
+  size_t fifo_capacity = 0;
+  int data_event_fd = -1;
+  int close_event_fd = -1;
+  std::array<struct pollfd, 2> xbuf_poll_fd {};
+  std::atomic<bool> reader_waiting = false;
+  std::atomic<bool> closed = false;
+  int errcode = 0;
+};
 }  // namespace RT::OS
 
 RT::OS::posixFifo::posixFifo(size_t size)
@@ -152,16 +250,307 @@ int RT::OS::posixFifo::getErrorCode() const
   return this->errcode;
 }
 
-int RT::OS::getFifo(std::unique_ptr<Fifo>& fifo, size_t fifo_size)
+RT::OS::spscRing::spscRing(size_t size)
+    : capacity(size)
+{
+  // The mirrored mapping requires page sized storage, and a power of two
+  // lets us turn indices into offsets with a mask.
+  const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  this->storage_size = page_size;
+  while (this->storage_size < size) {
+    this->storage_size <<= 1;
+  }
+  const int memfd = memfd_create("rtxi_fifo", MFD_CLOEXEC);
+  if (memfd < 0) {
+    this->errcode = errno;
+    return;
+  }
+  if (ftruncate(memfd, static_cast<off_t>(this->storage_size)) != 0) {
+    this->errcode = errno;
+    ::close(memfd);
+    return;
+  }
+  void* base = mmap(nullptr,
+                    2 * this->storage_size,
+                    PROT_NONE,
+                    MAP_PRIVATE | MAP_ANONYMOUS,
+                    -1,
+                    0);
+  if (base == MAP_FAILED) {
+    this->errcode = errno;
+    ::close(memfd);
+    return;
+  }
+  auto* first = static_cast<char*>(base);
+  auto* second = first + this->storage_size;
+  // MAP_POPULATE prefaults the pages so the first real-time write does not
+  // take a page fault
+  const int flags = MAP_SHARED | MAP_FIXED | MAP_POPULATE;
+  const int prot = PROT_READ | PROT_WRITE;
+  if (mmap(first, this->storage_size, prot, flags, memfd, 0) == MAP_FAILED
+      || mmap(second, this->storage_size, prot, flags, memfd, 0) == MAP_FAILED)
+  {
+    this->errcode = errno;
+    munmap(base, 2 * this->storage_size);
+    ::close(memfd);
+    return;
+  }
+  ::close(memfd);
+  this->storage = first;
+}
+
+RT::OS::spscRing::~spscRing()
+{
+  if (this->storage != nullptr) {
+    munmap(this->storage, 2 * this->storage_size);
+  }
+}
+
+char* RT::OS::spscRing::reserve(size_t data_size)
+{
+  const uint64_t wptr = this->head.load(std::memory_order_relaxed);
+  if (this->capacity - (wptr - this->cached_tail) < data_size) {
+    this->cached_tail = this->tail.load(std::memory_order_acquire);
+    if (this->capacity - (wptr - this->cached_tail) < data_size) {
+      return nullptr;
+    }
+  }
+  return this->storage + (wptr & (this->storage_size - 1));
+}
+
+void RT::OS::spscRing::commit(size_t data_size)
+{
+  const uint64_t wptr = this->head.load(std::memory_order_relaxed);
+  this->head.store(wptr + data_size, std::memory_order_release);
+}
+
+RT::OS::fifo_span_t RT::OS::spscRing::peek()
+{
+  const uint64_t rptr = this->tail.load(std::memory_order_relaxed);
+  this->cached_head = this->head.load(std::memory_order_acquire);
+  const uint64_t available = this->cached_head - rptr;
+  if (available == 0) {
+    return {};
+  }
+  return {this->storage + (rptr & (this->storage_size - 1)), available};
+}
+
+void RT::OS::spscRing::consume(size_t data_size)
+{
+  const uint64_t rptr = this->tail.load(std::memory_order_relaxed);
+  this->tail.store(rptr + data_size, std::memory_order_release);
+}
+
+int64_t RT::OS::spscRing::push(const void* buf, size_t data_size)
+{
+  char* region = this->reserve(data_size);
+  if (region == nullptr) {
+    return -1;
+  }
+  memcpy(region, buf, data_size);
+  this->commit(data_size);
+  return static_cast<int64_t>(data_size);
+}
+
+int64_t RT::OS::spscRing::pop(void* buf, size_t data_size)
+{
+  const uint64_t rptr = this->tail.load(std::memory_order_relaxed);
+  if (this->cached_head - rptr < data_size) {
+    this->cached_head = this->head.load(std::memory_order_acquire);
+  }
+  const uint64_t available = this->cached_head - rptr;
+  if (available == 0) {
+    return -1;
+  }
+  const size_t count = std::min<uint64_t>(available, data_size);
+  memcpy(buf, this->storage + (rptr & (this->storage_size - 1)), count);
+  this->consume(count);
+  return static_cast<int64_t>(count);
+}
+
+bool RT::OS::spscRing::empty() const
 {
-  auto tmp_fifo = std::make_unique<RT::OS::posixFifo>(fifo_size);
-  const int errcode = tmp_fifo->getErrorCode();
+  return this->head.load(std::memory_order_acquire)
+      == this->tail.load(std::memory_order_relaxed);
+}
+
+RT::OS::posixRingFifo::posixRingFifo(size_t size)
+    : rt_to_ui(size)
+    , ui_to_rt(size)
+    , fifo_capacity(size)
+{
+  this->errcode = this->rt_to_ui.getErrorCode();
+  if (this->errcode != 0) {
+    ERROR_MSG("RT::OS::posixRingFifo : Unable to create RT to UI buffer");
+    return;
+  }
+  this->errcode = this->ui_to_rt.getErrorCode();
+  if (this->errcode != 0) {
+    ERROR_MSG("RT::OS::posixRingFifo : Unable to create UI to RT buffer");
+    return;
+  }
+
+  // setup polling mechanism (polling only supported from ui read side)
+  this->data_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  this->close_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (this->data_event_fd < 0 || this->close_event_fd < 0) {
+    this->errcode = errno;
+    ERROR_MSG("RT::OS::posixRingFifo : Unable to create event descriptors");
+    return;
+  }
+  this->xbuf_poll_fd[0].fd = this->data_event_fd;
+  this->xbuf_poll_fd[0].events = POLLIN;
+  this->xbuf_poll_fd[1].fd = this->close_event_fd;
+  this->xbuf_poll_fd[1].events = POLLIN;
+}
+
+RT::OS::posixRingFifo::~posixRingFifo()
+{
+  if (this->data_event_fd >= 0) {
+    ::close(this->data_event_fd);
+  }
+  if (this->close_event_fd >= 0) {
+    ::close(this->close_event_fd);
+  }
+}
+
+int64_t RT::OS::posixRingFifo::read(void* buf, size_t data_size)
+{
+  return this->rt_to_ui.pop(buf, data_size);
+}
+
+int64_t RT::OS::posixRingFifo::write(void* buf, size_t data_size)
+{
+  if (data_size > this->fifo_capacity) {
+    return -1;
+  }
+  // Block while the ring is full, like the blocking pipe write did
+  const std::unique_lock<std::mutex> lk(this->write_mut);
+  int64_t written = this->ui_to_rt.push(buf, data_size);
+  while (written < 0 && !this->closed) {
+    std::this_thread::sleep_for(RING_WRITE_RETRY);
+    written = this->ui_to_rt.push(buf, data_size);
+  }
+  return written;
+}
+
+int64_t RT::OS::posixRingFifo::readRT(void* buf, size_t data_size)
+{
+  return this->ui_to_rt.pop(buf, data_size);
+}
+
+int64_t RT::OS::posixRingFifo::writeRT(void* buf, size_t data_size)
+{
+  const int64_t written = this->rt_to_ui.push(buf, data_size);
+  if (written > 0) {
+    this->wakeup_reader();
+  }
+  return written;
+}
+
+RT::OS::fifo_span_t RT::OS::posixRingFifo::reserveRT(size_t data_size)
+{
+  char* region = this->rt_to_ui.reserve(data_size);
+  if (region == nullptr) {
+    return {};
+  }
+  return {region, data_size};
+}
+
+void RT::OS::posixRingFifo::commitRT(size_t data_size)
+{
+  this->rt_to_ui.commit(data_size);
+  this->wakeup_reader();
+}
+
+RT::OS::fifo_span_t RT::OS::posixRingFifo::peek()
+{
+  return this->rt_to_ui.peek();
+}
+
+void RT::OS::posixRingFifo::consume(size_t data_size)
+{
+  this->rt_to_ui.consume(data_size);
+}
+
+void RT::OS::posixRingFifo::wakeup_reader()
+{
+  // Pairs with the fence in poll(). Either we observe the reader waiting, or
+  // the reader observes the data we just published before going to sleep.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (this->reader_waiting.load(std::memory_order_relaxed)
+      && this->reader_waiting.exchange(false, std::memory_order_relaxed))
+  {
+    const uint64_t count = 1;
+    ::write(this->data_event_fd, &count, sizeof(uint64_t));
+  }
+}
+
+void RT::OS::posixRingFifo::poll()
+{
+  this->reader_waiting.store(true, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!this->rt_to_ui.empty()) {
+    this->reader_waiting.store(false, std::memory_order_relaxed);
+    return;
+  }
+  this->errcode = ::poll(this->xbuf_poll_fd.data(), 2, -1);
+  if (errcode < 0) {
+    std::string errbuff(255, '\0');
+    ERROR_MSG("RT::OS::FIFO(posix)::poll : returned with failure code {} : ",
+              errcode);
+    ERROR_MSG("{}", strerror_r(errno, errbuff.data(), errbuff.size()));
+    return;
+  }
+  if ((this->xbuf_poll_fd[0].revents & POLLIN) != 0) {
+    uint64_t count = 0;
+    ::read(this->data_event_fd, &count, sizeof(uint64_t));
+  }
+  if ((this->xbuf_poll_fd[1].revents & POLLIN) != 0) {
+    this->closed = true;
+  }
+  this->reader_waiting.store(false, std::memory_order_relaxed);
+}
+
+void RT::OS::posixRingFifo::close()
+{
+  std::array<int64_t, 1> buf = {1};
+  this->closed = true;
+  ::write(this->close_event_fd, buf.data(), sizeof(int64_t));
+}
+
+size_t RT::OS::posixRingFifo::getCapacity()
+{
+  return this->fifo_capacity;
+}
+
+int RT::OS::posixRingFifo::getErrorCode() const
+{
+  return this->errcode;
+}
+
+int RT::OS::getFifo(std::unique_ptr<Fifo>& fifo,
+                    size_t fifo_size,
+                    fifo_backend_t backend)
+{
+  int errcode = 0;
+  if (backend == RT::OS::PIPE_FIFO) {
+    auto tmp_fifo = std::make_unique<RT::OS::posixFifo>(fifo_size);
+    errcode = tmp_fifo->getErrorCode();
+    if (errcode == 0) {
+      fifo = std::move(tmp_fifo);
+    }
+  } else {
+    auto tmp_fifo = std::make_unique<RT::OS::posixRingFifo>(fifo_size);
+    errcode = tmp_fifo->getErrorCode();
+    if (errcode == 0) {
+      fifo = std::move(tmp_fifo);
+    }
+  }
   if (errcode != 0) {
     std::string errbuff(255, '\0');
-    ERROR_MSG("RT::OS::posixFifo : {}",
+    ERROR_MSG("RT::OS::getFifo(posix) : {}",
               strerror_r(errcode, errbuff.data(), errbuff.size()));
-  } else {
-    fifo = std::move(tmp_fifo);
   }
   return errcode;
 }
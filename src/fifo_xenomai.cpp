@@ -151,7 +151,9 @@ size_t RT::OS::xenomaiFifo::getCapacity()
   return this->fifo_capacity;
 }
 
-int RT::OS::getFifo(std::unique_ptr<Fifo>& fifo, size_t fifo_size)
+int RT::OS::getFifo(std::unique_ptr<Fifo>& fifo,
+                    size_t fifo_size,
+                    fifo_backend_t /*backend*/)
 {
   // We can only create rt pipes from a xenomai thread.
   auto create_pipe_task = [&]()
@@ -29,58 +29,43 @@ IO::Block::Block(std::string blockname,
     : name(std::move(blockname))
     , isInputDependent(isdependent)
 {
-  port_t port = {};
   for (const auto& channel : channels) {
-    port.channel_info = channel;
-    port.value = 0.0;
-    port.buff_value = 0.0;
     // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
-    ports.at(channel.flags).push_back(port);
-    port = {};
+    port_info.at(channel.flags).push_back(channel);
+    port_values.at(channel.flags).push_back(0.0);
+    if (channel.flags == IO::INPUT) {
+      input_buffers.push_back(0.0);
+    }
   }
 }
 
 size_t IO::Block::getCount(IO::flags_t type) const
 {
   // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
-  return this->ports.at(type).size();
+  return this->port_info.at(type).size();
 }
 
 std::string IO::Block::getChannelName(IO::flags_t type, size_t index) const
 {
   // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
-  return this->ports.at(type).at(index).channel_info.name;
+  return this->port_info.at(type).at(index).name;
 }
 
 std::string IO::Block::getChannelDescription(IO::flags_t type,
                                              size_t index) const
 {
   // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
-  return this->ports.at(type).at(index).channel_info.description;
+  return this->port_info.at(type).at(index).description;
 }
 
-void IO::Block::writeinput(size_t index, const double& data)
+const double* IO::Block::getPortAddress(IO::flags_t direction,
+                                        size_t index) const
 {
-  this->ports.at(IO::INPUT).at(index).buff_value += data;
+  return &(this->port_values.at(direction).at(index));
 }
 
-double& IO::Block::readinput(size_t index)
+double* IO::Block::getInputBufferAddress(size_t index)
 {
-  // We must reset input values to zero so that the next cycle doesn't use these
-  // values
-  this->ports.at(IO::INPUT).at(index).value =
-      this->ports.at(IO::INPUT).at(index).buff_value;
-  this->ports.at(IO::INPUT).at(index).buff_value = 0.0;
-  return this->ports.at(IO::INPUT).at(index).value;
-}
-
-void IO::Block::writeoutput(size_t index, const double& data)
-{
-  this->ports.at(IO::OUTPUT).at(index).value = data;
-}
-
-const double& IO::Block::readPort(IO::flags_t direction, size_t index)
-{
-  return this->ports.at(direction).at(index).value;
+  return &(this->input_buffers.at(index));
 }
 // NOLINTEND(cppcoreguidelines-pro-bounds-constant-array-index)
@@ -21,6 +21,7 @@
 #ifndef IO_H
 #define IO_H
 
+#include <algorithm>
 #include <array>
 #include <limits>
 #include <string>
@@ -147,7 +148,10 @@ public:
    *
    * \sa IO::Block::readinput()
    */
-  void writeinput(size_t index, const double& data);
+  void writeinput(size_t index, const double& data)
+  {
+    this->input_buffer_ref(index) += data;
+  }
 
   /*!
    * Get the values of the specified output channel.
@@ -159,7 +163,51 @@ public:
    * \param direction The channel direction represented by IO::flags_t
    * \return The value of the specified output channel.
    */
-  const double& readPort(IO::flags_t direction, size_t index);
+  const double& readPort(IO::flags_t direction, size_t index)
+  {
+    return this->port_value_ref(direction, index);
+  }
+
+  /*!
+   * Get the address of the value stored in the specified port.
+   *
+   * Ports are allocated once during construction, so the address stays valid
+   * for the lifetime of the block. RT::Connector uses it to compile block
+   * connections into a flat routing table.
+   *
+   * \param direction The channel direction represented by IO::flags_t
+   * \param index The channel's index.
+   * \return Pointer to the value of the port
+   *
+   * \sa IO::Block::readPort()
+   */
+  const double* getPortAddress(IO::flags_t direction, size_t index) const;
+
+  /*!
+   * Get the address of the buffer accumulating writes to an input channel.
+   *
+   * Adding to the pointed value is equivalent to calling writeinput().
+   *
+   * \param index The input channel's index.
+   * \return Pointer to the buffered value of the input port
+   *
+   * \sa IO::Block::writeinput()
+   */
+  double* getInputBufferAddress(size_t index);
+
+  /*!
+   * Discard the values written to the input channels since the last read.
+   *
+   * Used by RT::System in periods where the block does not execute so that
+   * writes do not accumulate until its next execution. The last read input
+   * values are kept.
+   *
+   * \sa IO::Block::writeinput()
+   */
+  void discardInputs()
+  {
+    std::fill(this->input_buffers.begin(), this->input_buffers.end(), 0.0);
+  }
 
   /*!
    * Returns the dependency property of the block
@@ -215,7 +263,16 @@ protected:
    *
    * \sa IO::Block::writeinput()
    */
-  double& readinput(size_t index);
+  double& readinput(size_t index)
+  {
+    // We must reset input values to zero so that the next cycle doesn't use
+    // these values
+    double& buffered = this->input_buffer_ref(index);
+    double& value = this->port_value_ref(IO::INPUT, index);
+    value = buffered;
+    buffered = 0.0;
+    return value;
+  }
 
   /*!
    * Writes output to specified channel. Only the block itself has access.
@@ -223,19 +280,41 @@ protected:
    * \param index The channel to write the output to
    * \param data A reference to value to send
    */
-  void writeoutput(size_t index, const double& data);
+  void writeoutput(size_t index, const double& data)
+  {
+    this->port_value_ref(IO::OUTPUT, index) = data;
+  }
 
 private:
-  size_t id = INVALID_BLOCK_ID;
-  typedef struct port_t
+  // The accessors below sit in the real-time path of every block, so bounds
+  // are only checked in debug builds.
+  double& port_value_ref(IO::flags_t direction, size_t index)
   {
-    double buff_value = 0.0;
-    double value = 0.0;
-    IO::channel_t channel_info;
-  } port_t;
+#ifdef NDEBUG
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
+    return this->port_values[direction][index];
+#else
+    return this->port_values.at(direction).at(index);
+#endif
+  }
+
+  double& input_buffer_ref(size_t index)
+  {
+#ifdef NDEBUG
+    return this->input_buffers[index];
+#else
+    return this->input_buffers.at(index);
+#endif
+  }
+
+  size_t id = INVALID_BLOCK_ID;
   std::string name;
   bool isInputDependent;
-  std::array<std::vector<port_t>, IO::UNKNOWN> ports;
+  // Port values are stored in contiguous arrays indexed by channel so the
+  // real-time path does not drag channel names and descriptions into cache.
+  std::array<std::vector<double>, IO::UNKNOWN> port_values;
+  std::vector<double> input_buffers;
+  std::array<std::vector<IO::channel_t>, IO::UNKNOWN> port_info;
   bool active = false;
 };  // class Block
 
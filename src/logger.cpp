@@ -1,154 +1,418 @@
 
+#include <cerrno>
 #include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 
 #include "logger.hpp"
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "debug.hpp"
 #include "event.hpp"
 #include "rt.hpp"
+#include "rtos.hpp"
 #include "widgets.hpp"
 
-// TODO: change localtime to be thread-safe
+namespace
+{
+std::string telemitry_to_string(RT::Telemitry::response_t type)
+{
+  switch (type) {
+    case RT::Telemitry::RT_PERIOD_UPDATE:
+      return "Period Updated";
+    case RT::Telemitry::RT_THREAD_LIST_UPDATE:
+      return "System Threadlist Updated";
+    case RT::Telemitry::RT_DEVICE_LIST_UPDATE:
+      return "System Devicelist Updated";
+    case RT::Telemitry::RT_NOOP:
+      return "NO-OP Acknowledged";
+    case RT::Telemitry::RT_SHUTDOWN:
+      return "Real-Time System Shutdown";
+    case RT::Telemitry::RT_WIDGET_PARAM_UPDATE:
+      return "Widget Parameter Updated";
+    case RT::Telemitry::IO_LINK_UPDATED:
+      return "IO Link Updated";
+    case RT::Telemitry::RT_WIDGET_STATE_UPDATE:
+      return "Widget State Updated";
+    case RT::Telemitry::RT_PROFILER_UPDATE:
+      return "Block Profiler Updated";
+    case RT::Telemitry::RT_OVERRUN_POLICY_UPDATE:
+      return "Overrun Policy Updated";
+    case RT::Telemitry::RT_BATCH_UPDATE:
+      return "Command Batch Applied";
+    case RT::Telemitry::RT_ERROR:
+      return "Real-Time System Error";
+    case RT::Telemitry::NO_TELEMITRY:
+      return "NO TELEMITRY";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+int64_t now_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+// Flag marking IO link records whose source port is an output
+constexpr uint8_t SOURCE_IS_OUTPUT = 0x08;
+}  // namespace
+
+eventLogger::eventLogger(std::filesystem::path path,
+                         size_t file_size_limit,
+                         size_t file_count)
+    : logfile(path.empty() ? default_logfile() : std::move(path))
+    , max_file_size(file_size_limit)
+    , max_files(std::max<size_t>(file_count, 1))
+{
+  std::error_code ec;
+  if (this->logfile.has_parent_path()) {
+    std::filesystem::create_directories(this->logfile.parent_path(), ec);
+  }
+  this->open_logfile();
+  this->writer = std::thread(&eventLogger::writer_loop, this);
+  RT::OS::renameOSThread(this->writer, std::string("RTXIEventLogger"));
+}
+
+eventLogger::~eventLogger()
+{
+  this->running = false;
+  this->not_empty.notifyAll();
+  if (this->writer.joinable()) {
+    this->writer.join();
+  }
+  if (this->fd >= 0) {
+    ::close(this->fd);
+  }
+}
+
+std::filesystem::path eventLogger::default_logdir()
+{
+  const char* state_home = std::getenv("XDG_STATE_HOME");  // NOLINT
+  if (state_home != nullptr && *state_home != '\0') {
+    return std::filesystem::path(state_home) / "rtxi";
+  }
+  const char* home = std::getenv("HOME");  // NOLINT
+  if (home != nullptr && *home != '\0') {
+    return std::filesystem::path(home) / ".local" / "state" / "rtxi";
+  }
+  std::error_code ec;
+  std::filesystem::path directory = std::filesystem::temp_directory_path(ec);
+  if (ec) {
+    directory = "/tmp";
+  }
+  return directory / ("rtxi-" + std::to_string(::getuid()));
+}
+
+std::filesystem::path eventLogger::default_logfile()
+{
+  return default_logdir() / ("events-" + std::to_string(::getpid()) + ".log");
+}
+
+void eventLogger::push(const record_t& record)
+{
+  if (!this->records.tryPush(record)) {
+    this->dropped_count.fetch_add(1, std::memory_order_relaxed);
+    this->dropped_total.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  this->logged_count.fetch_add(1, std::memory_order_release);
+  this->not_empty.notify(1);
+}
+
 void eventLogger::log(Event::Object* event)
 {
+  record_t record;
+  record.timestamp = now_ns();
+  record.kind = EVENT_RECORD;
+  record.type = static_cast<int16_t>(event->getType());
   try {
-    const std::unique_lock<std::mutex> lk(this->log_mutex);
-    const auto time_point = std::chrono::system_clock::now();
-    const std::time_t now = std::chrono::system_clock::to_time_t(time_point);
-    this->ss << "[ ";
-    this->ss << std::put_time(std::localtime(&now), "%F %T");  // NOLINT
-    this->ss << " ] (EVENT FIRED)\t";
-    this->ss << " TYPE -- " << event->getName();
     switch (event->getType()) {
       case Event::Type::RT_PERIOD_EVENT:
-        this->ss << "\t VALUE -- ";
-        this->ss << std::any_cast<int64_t>(event->getParam("period"));
-        break;
-      case Event::Type::RT_PREPERIOD_EVENT:
-      case Event::Type::RT_POSTPERIOD_EVENT:
+        record.value = static_cast<uint64_t>(
+            event->getPayload<Event::period_payload_t>().period);
+        record.flags = HAS_VALUE;
         break;
       case Event::Type::RT_THREAD_PAUSE_EVENT:
       case Event::Type::RT_THREAD_UNPAUSE_EVENT:
       case Event::Type::RT_THREAD_INSERT_EVENT:
       case Event::Type::RT_THREAD_REMOVE_EVENT:
-        this->ss << "\t SOURCE -- ";
-        this->ss
-            << std::any_cast<RT::Thread*>(event->getParam("thread"))->getName();
+        record.source =
+            event->getPayload<Event::thread_payload_t>().thread->getID();
+        record.flags = HAS_SOURCE;
         break;
       case Event::Type::RT_DEVICE_PAUSE_EVENT:
       case Event::Type::RT_DEVICE_UNPAUSE_EVENT:
       case Event::Type::RT_DEVICE_INSERT_EVENT:
       case Event::Type::RT_DEVICE_REMOVE_EVENT:
-        this->ss << "\t SOURCE -- ";
-        this->ss
-            << std::any_cast<RT::Device*>(event->getParam("device"))->getName();
+        record.source =
+            event->getPayload<Event::device_payload_t>().device->getID();
+        record.flags = HAS_SOURCE;
         break;
       case Event::Type::IO_LINK_INSERT_EVENT:
       case Event::Type::IO_LINK_REMOVE_EVENT: {
         auto connection = std::any_cast<RT::block_connection_t>(
             event->getParam("connection"));
-        this->ss << "\t CONNECTION -- {";
-        this->ss << "source: " << connection.src->getName();
-        this->ss << " type: "
-                 << (connection.src_port_type == IO::OUTPUT ? "Output"
-                                                            : "Input");
-        this->ss << " port: " << connection.src_port;
-        this->ss << "} <==> {";
-        this->ss << "destination: " << connection.dest->getName();
-        this->ss << " port: " << connection.dest_port << "}";
+        record.source = connection.src->getID();
+        record.value = connection.dest->getID();
+        record.aux = static_cast<uint32_t>((connection.src_port & 0xFFFF) << 16
+                                           | (connection.dest_port & 0xFFFF));
+        record.flags = HAS_SOURCE | HAS_VALUE | HAS_AUX;
+        if (connection.src_port_type == IO::OUTPUT) {
+          record.flags |= SOURCE_IS_OUTPUT;
+        }
         break;
       }
-      case Event::Type::PLUGIN_INSERT_EVENT:
-        this->ss << "\t SOURCE -- ";
-        this->ss << std::any_cast<std::string>(event->getParam("pluginName"));
+      case Event::Type::RT_WIDGET_PARAMETER_CHANGE_EVENT: {
+        const auto parameter =
+            event->getPayload<Event::widget_parameter_payload_t>();
+        record.source = parameter.component->getID();
+        record.value = static_cast<uint64_t>(parameter.type);
+        record.aux = static_cast<uint32_t>(parameter.id);
+        record.flags = HAS_SOURCE | HAS_VALUE | HAS_AUX;
         break;
-      case Event::Type::PLUGIN_REMOVE_EVENT:
-        this->ss << "\t SOURCE -- ";
-        this->ss << std::any_cast<Widgets::Plugin*>(
-                        event->getParam("pluginPointer"))
-                        ->getName();
-        break;
-      case Event::Type::RT_WIDGET_PARAMETER_CHANGE_EVENT:
-        this->ss << "\t SOURCE -- ";
-        this->ss << std::any_cast<Widgets::Component*>(
-                        event->getParam("paramWidget"))
-                        ->getName();
-        this->ss << " TYPE -- ";
-        this->ss << Widgets::Variable::vartype2string(
-            std::any_cast<Widgets::Variable::variable_t>(
-                event->getParam("paramType")));
-        break;
-      case Event::Type::RT_WIDGET_STATE_CHANGE_EVENT:
-        this->ss << "\t SOURCE -- ";
-        this->ss << std::any_cast<Widgets::Component*>(
-                        event->getParam("component"))
-                        ->getName();
-        this->ss << " TYPE -- ";
-        this->ss << Widgets::Variable::state2string(
-            std::any_cast<RT::State::state_t>(event->getParam("state")));
+      }
+      case Event::Type::RT_WIDGET_STATE_CHANGE_EVENT: {
+        const auto state = event->getPayload<Event::widget_state_payload_t>();
+        record.source = state.component->getID();
+        record.value = static_cast<uint64_t>(state.state);
+        record.flags = HAS_SOURCE | HAS_VALUE;
         break;
+      }
       default:
         break;
     }
-    this->ss << "\n";
-    std::cout << this->ss.str();
-    this->ss.str("");
   } catch (std::bad_any_cast&) {
-    ERROR_MSG("Error while parsing event of type: {}", event->getName());
-    ERROR_MSG("Flushing event stream");
-    ERROR_MSG("{}", this->ss.str());
-    this->ss.str("");
+    // still record that the event fired, just without its details
+    record.flags = 0;
   }
+  this->push(record);
 }
 
 void eventLogger::log(RT::Telemitry::Response response)
 {
-  try {
-    const std::unique_lock<std::mutex> lk(this->log_mutex);
-    const auto time_point = std::chrono::system_clock::now();
-    const std::time_t now = std::chrono::system_clock::to_time_t(time_point);
-    this->ss << "[ ";
-    this->ss << std::put_time(std::localtime(&now), "%F %T");  // NOLINT
-    this->ss << " ] (TELEMITRY)\t";
-    this->ss << " TYPE -- ";
-    switch (response.type) {
-      case RT::Telemitry::RT_PERIOD_UPDATE:
-        this->ss << "Period Updated";
-        break;
-      case RT::Telemitry::RT_THREAD_LIST_UPDATE:
-        this->ss << "System Threadlist Updated";
-        break;
-      case RT::Telemitry::RT_DEVICE_LIST_UPDATE:
-        this->ss << "System Devicelist Updated";
-        break;
-      case RT::Telemitry::RT_NOOP:
-        this->ss << "NO-OP Acknowledged";
-        break;
-      case RT::Telemitry::RT_SHUTDOWN:
-        this->ss << "Real-Time System Shutdown";
-        break;
-      case RT::Telemitry::RT_WIDGET_PARAM_UPDATE:
-        this->ss << "Widget Parameter Updated";
-        break;
-      case RT::Telemitry::IO_LINK_UPDATED:
-        this->ss << "IO Link Updated";
-        break;
-      case RT::Telemitry::RT_WIDGET_STATE_UPDATE:
-        this->ss << "Widget State Updated";
-        break;
-      case RT::Telemitry::RT_ERROR:
-        this->ss << "Real-Time System Error";
-        break;
-      case RT::Telemitry::NO_TELEMITRY:
-        this->ss << "NO TELEMITRY";
-        break;
-      default:
-        break;
+  record_t record;
+  record.timestamp = now_ns();
+  record.kind = TELEMITRY_RECORD;
+  record.type = static_cast<int16_t>(response.type);
+  this->push(record);
+}
+
+void eventLogger::flush()
+{
+  const size_t target = this->logged_count.load(std::memory_order_acquire);
+  while (this->running
+         && this->written_count.load(std::memory_order_acquire) < target)
+  {
+    this->not_empty.notify(1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+void eventLogger::writer_loop()
+{
+  std::vector<record_t> batch;
+  batch.reserve(RECORD_QUEUE_SIZE);
+  record_t record;
+  while (true) {
+    while (this->records.tryPop(record)) {
+      batch.push_back(record);
+    }
+    const size_t dropped = this->dropped_count.exchange(0);
+    if (dropped > 0) {
+      record_t dropped_record;
+      dropped_record.timestamp = now_ns();
+      dropped_record.kind = DROPPED_RECORD;
+      dropped_record.value = dropped;
+      dropped_record.flags = HAS_VALUE;
+      batch.push_back(dropped_record);
+    }
+    if (!batch.empty()) {
+      this->write_records(batch);
+      this->written_count.fetch_add(batch.size() - (dropped > 0 ? 1 : 0),
+                                    std::memory_order_release);
+      batch.clear();
+      continue;
     }
-    this->ss << "\n";
-    std::cout << this->ss.str();
-    this->ss.str("");
-  } catch (...) {
-    ERROR_MSG("Something went wrong while logging telemitry from RT system");
+    if (!this->running) {
+      break;
+    }
+    const uint32_t epoch_value = this->not_empty.prepare();
+    if (this->records.tryPop(record)) {
+      this->not_empty.cancel();
+      batch.push_back(record);
+      continue;
+    }
+    if (!this->running) {
+      this->not_empty.cancel();
+      continue;
+    }
+    this->not_empty.wait(epoch_value);
+  }
+}
+
+int eventLogger::open_logfile()
+{
+  // NOLINTNEXTLINE
+  this->fd = ::open(this->logfile.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (this->fd < 0) {
+    ERROR_MSG("eventLogger : unable to open log file {} : {}",
+              this->logfile.string(),
+              std::strerror(errno));  // NOLINT
+    return -1;
+  }
+  std::error_code ec;
+  this->file_size = std::filesystem::file_size(this->logfile, ec);
+  if (ec || this->file_size == 0) {
+    const file_header_t header;
+    if (::write(this->fd, &header, sizeof(header)) < 0) {
+      ERROR_MSG("eventLogger : unable to write log file header");
+    }
+    this->file_size = sizeof(header);
+  }
+  return 0;
+}
+
+void eventLogger::rotate()
+{
+  if (this->fd >= 0) {
+    ::close(this->fd);
+    this->fd = -1;
+  }
+  std::error_code ec;
+  const std::string base = this->logfile.string();
+  std::filesystem::remove(base + "." + std::to_string(this->max_files - 1),
+                          ec);
+  for (size_t index = this->max_files - 1; index > 1; index--) {
+    std::filesystem::rename(base + "." + std::to_string(index - 1),
+                            base + "." + std::to_string(index),
+                            ec);
+  }
+  if (this->max_files > 1) {
+    std::filesystem::rename(base, base + ".1", ec);
+  } else {
+    std::filesystem::remove(base, ec);
+  }
+  this->open_logfile();
+}
+
+void eventLogger::write_records(const std::vector<record_t>& batch)
+{
+  const size_t bytes = batch.size() * sizeof(record_t);
+  if (this->file_size + bytes > this->max_file_size
+      && this->file_size > sizeof(file_header_t))
+  {
+    this->rotate();
+  }
+  if (this->fd < 0) {
+    return;
+  }
+  const auto* buffer = reinterpret_cast<const char*>(batch.data());  // NOLINT
+  size_t written = 0;
+  while (written < bytes) {
+    const ssize_t result = ::write(this->fd, buffer + written, bytes - written);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ERROR_MSG("eventLogger : unable to write to log file {} : {}",
+                this->logfile.string(),
+                std::strerror(errno));  // NOLINT
+      return;
+    }
+    written += static_cast<size_t>(result);
+  }
+  this->file_size += bytes;
+}
+
+std::string eventLogger::format(const record_t& record)
+{
+  std::stringstream ss;
+  const auto seconds = static_cast<std::time_t>(record.timestamp / 1000000000);
+  const auto millis = (record.timestamp / 1000000) % 1000;
+  std::tm local_time {};
+  ::localtime_r(&seconds, &local_time);
+  ss << "[ " << std::put_time(&local_time, "%F %T") << "."
+     << std::setfill('0') << std::setw(3) << millis << " ] ";
+  switch (record.kind) {
+    case EVENT_RECORD:
+      ss << "(EVENT FIRED)\t TYPE -- "
+         << Event::type_to_string(static_cast<Event::Type>(record.type));
+      break;
+    case TELEMITRY_RECORD:
+      ss << "(TELEMITRY)\t TYPE -- " << telemitry_to_string(record.type);
+      return ss.str();
+    case DROPPED_RECORD:
+      ss << "(LOGGER)\t DROPPED -- " << record.value << " records";
+      return ss.str();
+    default:
+      ss << "(UNKNOWN RECORD)";
+      return ss.str();
+  }
+  if (record.flags == 0) {
+    return ss.str();
+  }
+  switch (static_cast<Event::Type>(record.type)) {
+    case Event::Type::RT_PERIOD_EVENT:
+      ss << "\t VALUE -- " << record.value;
+      break;
+    case Event::Type::IO_LINK_INSERT_EVENT:
+    case Event::Type::IO_LINK_REMOVE_EVENT:
+      ss << "\t CONNECTION -- {";
+      ss << "source: " << record.source;
+      ss << " type: "
+         << ((record.flags & SOURCE_IS_OUTPUT) != 0 ? "Output" : "Input");
+      ss << " port: " << (record.aux >> 16);
+      ss << "} <==> {";
+      ss << "destination: " << record.value;
+      ss << " port: " << (record.aux & 0xFFFF) << "}";
+      break;
+    case Event::Type::RT_WIDGET_PARAMETER_CHANGE_EVENT:
+      ss << "\t SOURCE -- " << record.source;
+      ss << " PARAMETER -- " << record.aux;
+      ss << " TYPE -- "
+         << Widgets::Variable::vartype2string(
+                static_cast<Widgets::Variable::variable_t>(record.value));
+      break;
+    case Event::Type::RT_WIDGET_STATE_CHANGE_EVENT:
+      ss << "\t SOURCE -- " << record.source;
+      ss << " TYPE -- "
+         << Widgets::Variable::state2string(
+                static_cast<RT::State::state_t>(record.value));
+      break;
+    default:
+      if ((record.flags & HAS_SOURCE) != 0) {
+        ss << "\t SOURCE -- " << record.source;
+      }
+      break;
+  }
+  return ss.str();
+}
+
+int eventLogger::decode(std::istream& input, std::ostream& output)
+{
+  file_header_t header;
+  const file_header_t expected;
+  input.read(reinterpret_cast<char*>(&header), sizeof(header));  // NOLINT
+  if (!input || header.magic != expected.magic
+      || header.record_size != sizeof(record_t))
+  {
+    ERROR_MSG("eventLogger::decode : input is not an RTXI event log");
+    return -1;
+  }
+  record_t record;
+  while (input.read(reinterpret_cast<char*>(&record),  // NOLINT
+                    sizeof(record_t)))
+  {
+    output << format(record) << "\n";
   }
+  return 0;
 }
@@ -1,10 +1,16 @@
 #ifndef LOGGER_HPP
 #define LOGGER_HPP
 
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <filesystem>
-#include <mutex>
-#include <sstream>
+#include <iosfwd>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include "event_queue.hpp"
 #include "rt.hpp"
 
 namespace Event
@@ -14,41 +20,176 @@ class Object;
 
 /*!
  * Class responsible for logging all events and telemitry
+ *
+ * Callers only fill a small fixed size record and hand it to a lock-free
+ * queue, so logging never waits on formatting or disk access. A background
+ * thread appends the records to a binary log file, starting a new file
+ * once the current one grows past a size limit. Use decode() or the
+ * rtxi_log_decode tool to turn a log file back into text.
  */
 class eventLogger
 {
 public:
   /*!
-   * Log the fired event in human readable format
+   * Kind of entry stored in a log record
+   */
+  enum record_kind : uint8_t
+  {
+    EVENT_RECORD = 0, /*!< An event routed by Event::Manager */
+    TELEMITRY_RECORD, /*!< A telemitry response from RT::System */
+    DROPPED_RECORD /*!< Records lost because the queue was full */
+  };
+
+  /*!
+   * Binary log entry
+   *
+   * The meaning of source, value and aux depends on the type of the
+   * entry. Blocks are identified by their IO::Block ID.
+   */
+  struct record_t
+  {
+    int64_t timestamp = 0; /*!< Nanoseconds since the unix epoch */
+    uint64_t source = 0; /*!< ID of the block the entry refers to */
+    uint64_t value = 0; /*!< Period, state, destination block, count... */
+    uint32_t aux = 0; /*!< Parameter ID, or source and destination ports */
+    int16_t type = 0; /*!< Event::Type or RT::Telemitry::response_t */
+    record_kind kind = EVENT_RECORD;
+    uint8_t flags = 0; /*!< Set when the source and value fields are used */
+  };
+  static_assert(sizeof(record_t) == 32, "log records are written as is");
+
+  static constexpr uint8_t HAS_SOURCE = 0x01;
+  static constexpr uint8_t HAS_VALUE = 0x02;
+  static constexpr uint8_t HAS_AUX = 0x04;
+
+  /*!
+   * Header written at the start of every log file
+   */
+  struct file_header_t
+  {
+    std::array<char, 8> magic = {'R', 'T', 'X', 'I', 'L', 'O', 'G', '\0'};
+    uint32_t version = 1;
+    uint32_t record_size = sizeof(record_t);
+  };
+
+  static constexpr size_t RECORD_QUEUE_SIZE = 4096;
+  static constexpr size_t DEFAULT_MAX_FILE_SIZE = 16 * 1024 * 1024;
+  static constexpr size_t DEFAULT_MAX_FILES = 4;
+
+  /*!
+   * Starts the background writer
    *
-   * The log function will take the pointer to the event object
-   * and send to standard output a string describing the event
-   * in human readable format. It will prepend information like
-   * the current local time and type of event fired. Unknown
-   * event types will be marked is type UNKNOWN and printed. It
-   * is thread safe.
+   * Records are appended to an existing log file. Once the file grows past
+   * max_file_size it is renamed to logfile.1, older files are shifted up
+   * by one, and anything past max_files is deleted.
+   *
+   * \param logfile Path of the log file. An empty path selects
+   *                default_logfile().
+   * \param max_file_size Size in bytes after which the file is rotated
+   * \param max_files Number of files kept, including the current one
+   */
+  explicit eventLogger(std::filesystem::path logfile = {},
+                       size_t max_file_size = DEFAULT_MAX_FILE_SIZE,
+                       size_t max_files = DEFAULT_MAX_FILES);
+  eventLogger(const eventLogger&) = delete;
+  eventLogger& operator=(const eventLogger&) = delete;
+  eventLogger(eventLogger&&) = delete;
+  eventLogger& operator=(eventLogger&&) = delete;
+
+  /*!
+   * Writes out every queued record and stops the background writer
+   */
+  ~eventLogger();
+
+  /*!
+   * Log the fired event
+   *
+   * Records the time, the event type and the IDs carried by its payload.
+   * It never blocks; if the writer falls behind the record is dropped and
+   * counted instead. It is thread safe.
    *
    * \param event A pointer to the fired event
    */
   void log(Event::Object* event);
 
   /*!
-   * Log the fired telemitry in human readable format
+   * Log the fired telemitry
    *
-   * The log function will take the pointer to the telemitry object
-   * and send to standard output a string describing the event
-   * in human readable format. It will prepend information like
-   * the current local time and type of telemitry fired. It is thread
-   * safe.
+   * Records the time and the telemitry type. Like the event overload it
+   * never blocks and is thread safe.
    *
-   * \param event A pointer to the fired telemitry
+   * \param response The fired telemitry
    */
   void log(RT::Telemitry::Response response);
 
+  /*!
+   * Blocks until every record logged before the call is written to disk
+   */
+  void flush();
+
+  /*!
+   * Number of records lost so far because the queue was full
+   */
+  size_t getDroppedCount() const { return this->dropped_total.load(); }
+
+  /*!
+   * Path of the file currently being written
+   */
+  const std::filesystem::path& getLogfile() const { return this->logfile; }
+
+  /*!
+   * Directory holding the default log files: rtxi under $XDG_STATE_HOME,
+   * falling back to ~/.local/state/rtxi and then to a per-user directory
+   * in the temporary directory
+   */
+  static std::filesystem::path default_logdir();
+
+  /*!
+   * Location used when no log file is given: events-<pid>.log in
+   * default_logdir(), so that instances never share a file
+   */
+  static std::filesystem::path default_logfile();
+
+  /*!
+   * Converts a record to a single line of human readable text
+   *
+   * \param record The record to format
+   *
+   * \return The formatted line, without a trailing newline
+   */
+  static std::string format(const record_t& record);
+
+  /*!
+   * Converts a binary log to text, one line per record
+   *
+   * \param input Stream positioned at the start of a log file
+   * \param output Stream receiving the text
+   *
+   * \return 0 if successful, -1 if the input is not an RTXI log
+   */
+  static int decode(std::istream& input, std::ostream& output);
+
 private:
+  void push(const record_t& record);
+  void writer_loop();
+  void write_records(const std::vector<record_t>& batch);
+  int open_logfile();
+  void rotate();
+
   std::filesystem::path logfile;
-  std::stringstream ss;
-  std::mutex log_mutex;
+  size_t max_file_size;
+  size_t max_files;
+  int fd = -1;
+  size_t file_size = 0;
+
+  Event::boundedRing<record_t> records {RECORD_QUEUE_SIZE};
+  Event::futexParker not_empty;
+  std::atomic<size_t> logged_count = 0;
+  std::atomic<size_t> written_count = 0;
+  std::atomic<size_t> dropped_count = 0;
+  std::atomic<size_t> dropped_total = 0;
+  std::atomic<bool> running = true;
+  std::thread writer;
 };
 
 #endif
@@ -1,4 +1,6 @@
 #include <QApplication>
+#include <cstdlib>
+#include <filesystem>
 #include <iostream>
 
 #include <signal.h>
@@ -19,6 +21,34 @@ void signal_handler(int signum)
   PRINT_BACKTRACE();
   exit(-1);  // NOLINT
 }
+
+// Additional real-time cores are opt-in as their workers busy wait
+size_t rt_worker_count()
+{
+  const char* workers = std::getenv("RTXI_RT_WORKERS");  // NOLINT
+  if (workers == nullptr) {
+    return 0;
+  }
+  return static_cast<size_t>(std::strtoul(workers, nullptr, 10));
+}
+
+size_t event_worker_count()
+{
+  const char* workers = std::getenv("RTXI_EVENT_WORKERS");  // NOLINT
+  if (workers == nullptr) {
+    return Event::Manager::DEFAULT_WORKER_COUNT;
+  }
+  return static_cast<size_t>(std::strtoul(workers, nullptr, 10));
+}
+
+std::filesystem::path event_logfile()
+{
+  const char* logfile = std::getenv("RTXI_EVENT_LOG");  // NOLINT
+  if (logfile == nullptr) {
+    return {};
+  }
+  return logfile;
+}
 }  // namespace
 
 int main(int argc, char* argv[])
@@ -42,10 +72,11 @@ int main(int argc, char* argv[])
   std::cout << RTXI_VERSION_PATCH << "\n";
 
   // Initializing core classes
-  auto event_manager = std::make_unique<Event::Manager>();
+  auto event_manager = std::make_unique<Event::Manager>(event_worker_count(),
+                                                        event_logfile());
   auto rt_connector = std::make_unique<RT::Connector>();
-  auto rt_system =
-      std::make_unique<RT::System>(event_manager.get(), rt_connector.get());
+  auto rt_system = std::make_unique<RT::System>(
+      event_manager.get(), rt_connector.get(), rt_worker_count());
   rt_system->createTelemitryProcessor();
   // Initializing GUI
   // QApplication::setDesktopSettingsAware(false);
@@ -772,7 +772,15 @@ void MainWindow::loadConnectionSettings(
     connection_events.back().setParam("connection", std::any(connection));
   }
   userprefs.endGroup();  // Connections
-  event_manager->postEvent(connection_events);
+  // All connections are applied by the real-time thread in a single period
+  std::vector<Event::Object*> batch;
+  batch.reserve(connection_events.size());
+  for (auto& event : connection_events) {
+    batch.push_back(&event);
+  }
+  Event::Object batch_event(Event::Type::RT_COMMAND_BATCH_EVENT);
+  batch_event.setParam("events", std::any(batch));
+  event_manager->postEvent(&batch_event);
 }
 
 void MainWindow::loadSettings()
@@ -18,7 +18,11 @@
 
  */
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
+#include <limits>
+#include <numeric>
 #include <queue>
 
 #include "rt.hpp"
@@ -30,28 +34,136 @@
 #include "rtos.hpp"
 #include "widgets.hpp"
 
-// TODO: convert cycle detection into non-recursive version
-int RT::Connector::find_cycle(RT::block_connection_t conn, IO::Block* ref_block)
+namespace
+{
+// Hint to the processor that we are busy waiting on another core
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+}  // namespace
+
+int RT::Connector::order_connection(const RT::block_connection_t& conn)
 {
   // devices can be connected recursively
   if (!conn.src->dependent() || !conn.dest->dependent()) {
     return 0;
   }
   // Cannot connect a block with itself
-  if (conn.dest == ref_block) {
+  if (conn.src == conn.dest) {
     return -1;
   }
-  // walk the connection graph and find a loop
-  for (const auto& temp_conn : this->connections[conn.dest->getID()]) {
-    if (ref_block == temp_conn.src
-        || this->find_cycle(temp_conn, ref_block) == -1)
-    {
-      return -1;
+  const size_t src_id = conn.src->getID();
+  const size_t dest_id = conn.dest->getID();
+  const size_t lower = this->topo_rank[dest_id];
+  const size_t upper = this->topo_rank[src_id];
+  if (lower > upper) {
+    return 0;
+  }
+
+  // Pearce-Kelly: only blocks ranked between dest and src can be out of
+  // order. Collect the ones reachable from dest and the ones reaching src,
+  // then hand their ranks back with the second group first.
+  std::vector<size_t> forward;
+  std::vector<size_t> backward;
+  std::vector<size_t> stack = {dest_id};
+  this->visit_marks[dest_id] = 1;
+  int result = 0;
+  while (!stack.empty() && result == 0) {
+    const size_t id = stack.back();
+    stack.pop_back();
+    forward.push_back(id);
+    for (const auto& out : this->connections[id]) {
+      if (!out.dest->dependent()) {
+        continue;
+      }
+      const size_t next = out.dest->getID();
+      if (next == src_id) {
+        result = -1;
+        break;
+      }
+      if (this->visit_marks[next] == 0 && this->topo_rank[next] < upper) {
+        this->visit_marks[next] = 1;
+        stack.push_back(next);
+      }
+    }
+  }
+  if (result == 0) {
+    stack = {src_id};
+    this->visit_marks[src_id] = 1;
+    while (!stack.empty()) {
+      const size_t id = stack.back();
+      stack.pop_back();
+      backward.push_back(id);
+      for (const auto& in : this->inbound[id]) {
+        if (!in.src->dependent()) {
+          continue;
+        }
+        const size_t prev = in.src->getID();
+        if (this->visit_marks[prev] == 0 && this->topo_rank[prev] > lower) {
+          this->visit_marks[prev] = 1;
+          stack.push_back(prev);
+        }
+      }
+    }
+  }
+  // leftovers on the stack were marked but never collected
+  for (const size_t id : stack) {
+    this->visit_marks[id] = 0;
+  }
+  for (const size_t id : forward) {
+    this->visit_marks[id] = 0;
+  }
+  for (const size_t id : backward) {
+    this->visit_marks[id] = 0;
+  }
+  if (result != 0) {
+    return result;
+  }
+
+  auto by_rank = [this](size_t lhs, size_t rhs)
+  { return this->topo_rank[lhs] < this->topo_rank[rhs]; };
+  std::sort(forward.begin(), forward.end(), by_rank);
+  std::sort(backward.begin(), backward.end(), by_rank);
+  std::vector<size_t> ranks;
+  ranks.reserve(forward.size() + backward.size());
+  for (const size_t id : backward) {
+    ranks.push_back(this->topo_rank[id]);
+  }
+  for (const size_t id : forward) {
+    ranks.push_back(this->topo_rank[id]);
+  }
+  std::sort(ranks.begin(), ranks.end());
+  size_t index = 0;
+  for (const auto& group : {backward, forward}) {
+    for (const size_t id : group) {
+      this->topo_rank[id] = ranks[index];
+      this->topo_order[ranks[index]] = this->block_registry[id];
+      index++;
     }
   }
   return 0;
 }
 
+void RT::Connector::compact_order()
+{
+  size_t rank = 0;
+  for (auto* block : this->topo_order) {
+    if (block == nullptr) {
+      continue;
+    }
+    this->topo_rank[block->getID()] = rank;
+    this->topo_order[rank] = block;
+    rank++;
+  }
+  this->topo_order.resize(rank);
+  this->removed_ranks = 0;
+}
+
 int RT::Connector::connect(RT::block_connection_t connection)
 {
   // Let's remind our users to register their block first
@@ -62,14 +174,15 @@ int RT::Connector::connect(RT::block_connection_t connection)
         "RT::Connector : source or destination blocks are not registered");
     return -1;
   }
-  if (this->find_cycle(connection, connection.src) == -1) {
+  if (this->connected(connection)) {
+    return 0;
+  }
+  if (this->order_connection(connection) == -1) {
     ERROR_MSG("RT::Connector : The Connection would have caused a cycle");
     return -1;
   }
-
-  if (!(this->connected(connection))) {
-    this->connections[connection.src->getID()].push_back(connection);
-  }
+  this->connections[connection.src->getID()].push_back(connection);
+  this->inbound[connection.dest->getID()].push_back(connection);
   return 0;
 }
 
@@ -101,6 +214,12 @@ void RT::Connector::disconnect(RT::block_connection_t connection)
   if (it != this->connections[src_id].end()) {
     this->connections[src_id].erase(it);
   }
+  // removing a connection never breaks the topological order
+  auto& dest_inbound = this->inbound[connection.dest->getID()];
+  auto in_it = std::find(dest_inbound.begin(), dest_inbound.end(), connection);
+  if (in_it != dest_inbound.end()) {
+    dest_inbound.erase(in_it);
+  }
 }
 
 void RT::Connector::insertBlock(
@@ -116,22 +235,26 @@ void RT::Connector::insertBlock(
   // memory again. We should make sure to use reserve() member function on
   // vectors in the non-rt thread so that further push_back calls are less
   // likely to allocate memory.
-  size_t id = 0;
-  bool stored = false;
-  for (id = 0; id < this->block_registry.size(); id++) {
-    if (this->block_registry[id] == nullptr) {
-      this->block_registry[id] = block;
-      block->assignID(id);
-      this->connections[id].swap(block_connections);
-      stored = true;
-      break;
-    }
-  }
-
-  if (!stored) {
+  if (!this->free_ids.empty()) {
+    // reuse the slot of the most recently removed block
+    const size_t id = this->free_ids.back();
+    this->free_ids.pop_back();
+    this->block_registry[id] = block;
+    block->assignID(id);
+    this->connections[id].swap(block_connections);
+  } else {
     block->assignID(this->block_registry.size());
     this->block_registry.push_back(block);
     this->connections.emplace_back(std::move(block_connections));
+    this->inbound.emplace_back();
+    this->topo_rank.push_back(INVALID_RANK);
+    this->visit_marks.push_back(0);
+  }
+
+  // new threads have no connections yet, so they can simply run last
+  if (block->dependent()) {
+    this->topo_rank[block->getID()] = this->topo_order.size();
+    this->topo_order.push_back(block);
   }
 }
 
@@ -140,8 +263,21 @@ void RT::Connector::removeBlock(IO::Block* block)
   if (block == nullptr || !(this->isRegistered(block))) {
     return;
   }
+  // connections would otherwise be inherited by the next user of the slot
+  this->clearAllConnections(block);
   // remove block from registry
-  this->block_registry[block->getID()] = nullptr;
+  const size_t id = block->getID();
+  this->block_registry[id] = nullptr;
+  this->free_ids.push_back(id);
+  if (this->topo_rank[id] != INVALID_RANK) {
+    this->topo_order[this->topo_rank[id]] = nullptr;
+    this->topo_rank[id] = INVALID_RANK;
+    this->removed_ranks++;
+  }
+  // squeeze out the holes once they make up half of the order
+  if (2 * this->removed_ranks > this->topo_order.size()) {
+    this->compact_order();
+  }
   // block->assignID(IO::INVALID_BLOCK_ID);
 }
 
@@ -158,52 +294,11 @@ bool RT::Connector::isRegistered(IO::Block* block)
 
 std::vector<RT::Thread*> RT::Connector::topological_sort()
 {
-  auto processing_q = std::queue<IO::Block*>();
-  auto sorted_blocks = std::vector<IO::Block*>();
-  auto sources_per_block = std::unordered_map<IO::Block*, int>();
-
-  for (auto* block : this->block_registry) {
-    if (block == nullptr) {
-      continue;
-    }
-    if (!block->dependent()) {
-      continue;
-    }
-    sources_per_block[block] += 0;  // initialize please
-    for (const auto& conn : getOutputs(block)) {
-      if (!conn.dest->dependent()) {
-        continue;
-      }
-      sources_per_block[conn.dest] += 1;
-    }
-  }
-
-  // Initialize queue for processing nodes in graph
-  for (const auto& block_count : sources_per_block) {
-    if (block_count.second == 0) {
-      processing_q.push(block_count.first);
-    }
-  }
-
-  // Process the graph nodes.
-  while (!processing_q.empty()) {
-    for (const auto& conn : getOutputs(processing_q.front())) {
-      if (!conn.dest->dependent()) {
-        continue;
-      }
-      sources_per_block[conn.dest] -= 1;
-      if (sources_per_block[conn.dest] == 0) {
-        processing_q.push(conn.dest);
-      }
-    }
-    sorted_blocks.push_back(processing_q.front());
-    processing_q.pop();
-  }
-
-  // System only cares about active threads
+  // The order is kept up to date by connect(), so we only have to pick the
+  // threads that are active. System only cares about active threads.
   std::vector<RT::Thread*> sorted_active_threads;
-  for (auto* block : sorted_blocks) {
-    if (block->getActive()) {
+  for (auto* block : this->topo_order) {
+    if (block != nullptr && block->getActive()) {
       sorted_active_threads.push_back(dynamic_cast<RT::Thread*>(block));
     }
   }
@@ -229,6 +324,83 @@ std::vector<RT::Thread*> RT::Connector::getThreads()
   return this->topological_sort();
 }
 
+std::vector<size_t> RT::Connector::getThreadLevels(
+    std::vector<RT::Thread*>& threads)
+{
+  // The level of a thread is the length of the longest chain of active
+  // threads leading to it. Since the list is sorted, all sources of a thread
+  // have their final level by the time we reach it.
+  auto thread_level = std::unordered_map<IO::Block*, size_t>();
+  for (auto* thread : threads) {
+    thread_level[thread] = 0;
+  }
+  size_t level_count = threads.empty() ? 0 : 1;
+  for (auto* thread : threads) {
+    const size_t next_level = thread_level[thread] + 1;
+    for (const auto& conn : this->connections[thread->getID()]) {
+      auto dest_level = thread_level.find(conn.dest);
+      if (dest_level == thread_level.end()) {
+        continue;
+      }
+      dest_level->second = std::max(dest_level->second, next_level);
+      level_count = std::max(level_count, next_level + 1);
+    }
+  }
+  std::stable_sort(threads.begin(),
+                   threads.end(),
+                   [&thread_level](RT::Thread* lhs, RT::Thread* rhs)
+                   { return thread_level[lhs] < thread_level[rhs]; });
+
+  std::vector<size_t> levels(level_count + 1, 0);
+  for (auto* thread : threads) {
+    levels[thread_level[thread] + 1] += 1;
+  }
+  for (size_t level = 1; level < levels.size(); level++) {
+    levels[level] += levels[level - 1];
+  }
+  return levels;
+}
+
+std::vector<RT::thread_rate_t> RT::Connector::getThreadRates(
+    const std::vector<RT::Thread*>& threads)
+{
+  // Greedily place every thread in the phase whose busiest period, over the
+  // hyperperiod of all divisors, has the fewest threads executing. Divisors
+  // that would grow the hyperperiod past the cap are balanced over the
+  // largest window found so far instead.
+  uint64_t window = 1;
+  for (auto* thread : threads) {
+    const uint64_t hyperperiod = std::lcm(window, thread->getRateDivisor());
+    window = hyperperiod <= RT::MAX_PHASE_WINDOW
+        ? hyperperiod
+        : std::max(window, thread->getRateDivisor());
+  }
+  std::vector<size_t> load(window, 0);
+  std::vector<RT::thread_rate_t> rates;
+  rates.reserve(threads.size());
+  for (auto* thread : threads) {
+    RT::thread_rate_t rate;
+    rate.divisor = thread->getRateDivisor();
+    size_t min_load = std::numeric_limits<size_t>::max();
+    for (uint64_t phase = 0; phase < rate.divisor; phase++) {
+      size_t phase_load = 0;
+      for (uint64_t period = phase; period < window; period += rate.divisor) {
+        phase_load = std::max(phase_load, load[period]);
+      }
+      if (phase_load < min_load) {
+        min_load = phase_load;
+        rate.phase = phase;
+      }
+    }
+    for (uint64_t period = rate.phase; period < window; period += rate.divisor)
+    {
+      load[period] += 1;
+    }
+    rates.push_back(rate);
+  }
+  return rates;
+}
+
 std::vector<RT::block_connection_t> RT::Connector::getOutputs(IO::Block* src)
 {
   if (!this->isRegistered(src)) {
@@ -239,22 +411,77 @@ std::vector<RT::block_connection_t> RT::Connector::getOutputs(IO::Block* src)
 
 void RT::Connector::propagateBlockConnections(IO::Block* block)
 {
-  for (auto& conn : this->connections[block->getID()]) {
-    conn.dest->writeinput(
-        conn.dest_port, conn.src->readPort(conn.src_port_type, conn.src_port));
+  const RT::routing_table_t* table = this->routing_table.get();
+  const size_t id = block->getID();
+  if (table->block_offsets.empty() || id >= table->block_offsets.size() - 1) {
+    return;
+  }
+  const size_t end = table->block_offsets[id + 1];
+  for (size_t i = table->block_offsets[id]; i < end; i++) {
+    *(table->destinations[i]) += *(table->sources[i]);
+  }
+}
+
+std::unique_ptr<RT::routing_table_t> RT::Connector::compileRoutingTable()
+{
+  auto table = std::make_unique<RT::routing_table_t>();
+  table->block_offsets.reserve(this->block_registry.size() + 1);
+  for (size_t id = 0; id < this->block_registry.size(); id++) {
+    table->block_offsets.push_back(table->sources.size());
+    if (this->block_registry[id] == nullptr) {
+      continue;
+    }
+    for (const auto& conn : this->connections[id]) {
+      if (!this->isRegistered(conn.dest)) {
+        continue;
+      }
+      table->sources.push_back(
+          conn.src->getPortAddress(conn.src_port_type, conn.src_port));
+      table->destinations.push_back(
+          conn.dest->getInputBufferAddress(conn.dest_port));
+    }
+  }
+  table->block_offsets.push_back(table->sources.size());
+  return table;
+}
+
+void RT::Connector::swapRoutingTable(
+    std::unique_ptr<RT::routing_table_t>& table)
+{
+  if (table == nullptr) {
+    return;
   }
+  this->routing_table.swap(table);
 }
 
 void RT::Connector::clearAllConnections(IO::Block* block)
 {
-  for (auto& entry : this->connections) {
-    entry.erase(std::remove_if(entry.begin(),
-                               entry.end(),
-                               [&](RT::block_connection_t conn) {
-                                 return conn.dest == block || conn.src == block;
-                               }),
-                entry.end());
+  if (!this->isRegistered(block)) {
+    return;
+  }
+  const size_t id = block->getID();
+  // Work on local lists so that connections of a device with itself do not
+  // modify the list being walked. Swapping them back keeps their capacity.
+  std::vector<RT::block_connection_t> outputs;
+  std::vector<RT::block_connection_t> inputs;
+  outputs.swap(this->connections[id]);
+  inputs.swap(this->inbound[id]);
+  for (const auto& conn : outputs) {
+    if (conn.dest != block) {
+      auto& entry = this->inbound[conn.dest->getID()];
+      entry.erase(std::remove(entry.begin(), entry.end(), conn), entry.end());
+    }
   }
+  for (const auto& conn : inputs) {
+    if (conn.src != block) {
+      auto& entry = this->connections[conn.src->getID()];
+      entry.erase(std::remove(entry.begin(), entry.end(), conn), entry.end());
+    }
+  }
+  outputs.clear();
+  inputs.clear();
+  outputs.swap(this->connections[id]);
+  inputs.swap(this->inbound[id]);
 }
 
 std::vector<IO::Block*> RT::Connector::getRegisteredBlocks()
@@ -277,7 +504,9 @@ std::vector<RT::block_connection_t> RT::Connector::getAllConnections()
   return all_connections;
 }
 
-RT::System::System(Event::Manager* em, RT::Connector* rtc)
+RT::System::System(Event::Manager* em,
+                   RT::Connector* rtc,
+                   size_t worker_count)
     : event_manager(em)
     , rt_connector(rtc)
 {
@@ -288,21 +517,42 @@ RT::System::System(Event::Manager* em, RT::Connector* rtc)
     ERROR_MSG("RT::System::System : failed to create Fifo");
     return;
   }
+  if (RT::OS::getFifo(this->profileFifo, RT::PROFILE_FIFO_SIZE) != 0) {
+    ERROR_MSG("RT::System::System : failed to create profiler Fifo");
+    return;
+  }
+  if (RT::OS::getFifo(this->overrunFifo, RT::OVERRUN_FIFO_SIZE) != 0) {
+    ERROR_MSG("RT::System::System : failed to create overrun Fifo");
+    return;
+  }
+  this->cmd_pool = std::vector<std::optional<CMD>>(RT::System::CMD_POOL_SIZE);
+  this->free_cmds.reserve(RT::System::CMD_POOL_SIZE);
+  for (size_t slot = RT::System::CMD_POOL_SIZE; slot > 0; slot--) {
+    this->free_cmds.push_back(slot - 1);
+  }
+  // The real-time loop reads these as soon as it starts
+  this->recent_overruns.reserve(RT::OVERRUN_RECENT_COUNT);
+  this->threads.reserve(100);
+  this->thread_levels.reserve(101);
+  this->thread_rates.reserve(100);
+  this->devices.reserve(100);
   this->task = std::make_unique<RT::OS::Task>();
+  // workers have to be waiting before the real-time loop dispatches to them
+  this->createWorkers(worker_count);
+  this->startDrain();
   if (RT::OS::createTask(this->task.get(), &RT::System::execute, this) != 0) {
     ERROR_MSG("RT::System::System : failed to create realtime thread\n");
     return;
   }
-
-  this->threads.reserve(100);
-  this->devices.reserve(100);
   this->event_manager->registerHandler(this);
 }
 
 RT::System::~System()
 {
+  this->stopDrain();
   this->task->task_finished = true;
   RT::OS::deleteTask(this->task.get());
+  this->destroyWorkers();
   this->event_manager->unregisterHandler(this);
   this->telemitry_processing_thread_running = false;
   this->eventFifo->close();
@@ -311,6 +561,158 @@ RT::System::~System()
   }
 }
 
+void RT::System::createWorkers(size_t worker_count)
+{
+  for (size_t i = 0; i < worker_count; i++) {
+    auto worker = std::make_unique<worker_t>();
+    worker->system = this;
+    worker->task = std::make_unique<RT::OS::Task>();
+    if (RT::OS::getFifo(worker->profile_fifo, RT::PROFILE_FIFO_SIZE) != 0) {
+      ERROR_MSG("RT::System::createWorkers : failed to create profiler Fifo");
+      break;
+    }
+    // Leave the first processor to the rest of the system
+    if (RT::OS::PROCESSOR_COUNT > 1) {
+      worker->task->cpu = static_cast<int>((i + 1) % RT::OS::PROCESSOR_COUNT);
+    }
+    if (RT::OS::createTask(
+            worker->task.get(), &RT::System::worker_execute, worker.get())
+        != 0)
+    {
+      ERROR_MSG("RT::System::createWorkers : failed to create worker {}", i);
+      break;
+    }
+    this->workers.push_back(std::move(worker));
+  }
+
+  // A worker that never starts would stall the real-time loop forever, so
+  // run serially unless every worker checks in
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(1);
+  auto all_ready = [&]()
+  {
+    return std::all_of(
+        this->workers.begin(),
+        this->workers.end(),
+        [](const auto& worker)
+        { return worker->ready.load(std::memory_order_acquire); });
+  };
+  while (!all_ready() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  if (!all_ready()) {
+    ERROR_MSG("RT::System::createWorkers : workers failed to start");
+    this->destroyWorkers();
+  }
+}
+
+void RT::System::destroyWorkers()
+{
+  for (auto& worker : this->workers) {
+    worker->task->task_finished.store(true, std::memory_order_release);
+    RT::OS::deleteTask(worker->task.get());
+  }
+  this->workers.clear();
+}
+
+void RT::System::worker_execute(void* arg)
+{
+  auto* worker = static_cast<RT::System::worker_t*>(arg);
+  RT::System* system = worker->system;
+  uint64_t generation =
+      system->dispatch_generation.load(std::memory_order_acquire);
+  worker->ready.store(true, std::memory_order_release);
+  while (!worker->task->task_finished.load(std::memory_order_acquire)) {
+    const uint64_t current =
+        system->dispatch_generation.load(std::memory_order_acquire);
+    if (current == generation) {
+      cpu_relax();
+      continue;
+    }
+    generation = current;
+    // Threads query the period through RT::OS::getPeriod(), which reads
+    // the worker's own task
+    worker->task->period =
+        system->dispatch_period.load(std::memory_order_relaxed);
+    system->runDispatchedThreads(worker->profile_fifo.get());
+    system->dispatch_pending.fetch_sub(1, std::memory_order_release);
+  }
+}
+
+void RT::System::runDispatchedThreads(RT::OS::Fifo* profile_fifo)
+{
+  size_t index = this->dispatch_next.fetch_add(1, std::memory_order_relaxed);
+  while (index < this->dispatch_end) {
+    this->runThread(index, profile_fifo);
+    index = this->dispatch_next.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+template<typename Callable>
+void RT::System::profile(RT::OS::Fifo* fifo,
+                         IO::Block* block,
+                         RT::profile_stage_t stage,
+                         const Callable& stage_function)
+{
+  if (!this->profiling) {
+    stage_function();
+    return;
+  }
+  const int64_t start = RT::OS::getTime();
+  stage_function();
+  RT::profile_sample_t sample = {block, stage, RT::OS::getTime() - start};
+  // samples are dropped if the fifo is full
+  if (fifo->writeRT(&sample, sizeof(RT::profile_sample_t)) <= 0) {
+    this->profile_dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void RT::System::runThread(size_t index, RT::OS::Fifo* profile_fifo)
+{
+  const RT::thread_rate_t& rate = this->thread_rates[index];
+  RT::Thread* thread = this->threads[index];
+  if (rate.divisor == 1 || this->tick % rate.divisor == rate.phase) {
+    this->profile(profile_fifo,
+                  thread,
+                  RT::PROFILE_EXECUTE,
+                  [thread]() { thread->execute(); });
+  } else {
+    // inputs hold the value read in the last execution
+    this->threads[index]->discardInputs();
+  }
+}
+
+void RT::System::executeThreads(size_t begin, size_t end)
+{
+  if (this->workers.empty() || end - begin < 2) {
+    for (size_t i = begin; i < end; i++) {
+      this->runThread(i, this->profileFifo.get());
+    }
+  } else {
+    this->dispatch_end = end;
+    this->dispatch_next.store(begin, std::memory_order_relaxed);
+    this->dispatch_pending.store(this->workers.size(),
+                                 std::memory_order_relaxed);
+    this->dispatch_period.store(this->task->period, std::memory_order_relaxed);
+    this->dispatch_generation.fetch_add(1, std::memory_order_release);
+    this->runDispatchedThreads(this->profileFifo.get());
+    while (this->dispatch_pending.load(std::memory_order_acquire) != 0) {
+      cpu_relax();
+    }
+  }
+  // Threads of the same level may feed the same input, so outputs are
+  // propagated from a single core once the whole level is done. Threads that
+  // did not execute keep propagating their last outputs.
+  for (size_t i = begin; i < end; i++) {
+    RT::Thread* thread = this->threads[i];
+    this->profile(this->profileFifo.get(),
+                  thread,
+                  RT::PROFILE_PROPAGATE,
+                  [this, thread]()
+                  { this->rt_connector->propagateBlockConnections(thread); });
+  }
+}
+
 int64_t RT::System::getPeriod()
 {
   return this->task->period;
@@ -318,21 +720,58 @@ int64_t RT::System::getPeriod()
 
 void RT::System::postTelemitry(RT::Telemitry::Response telemitry)
 {
+  if (this->executing_batch) {
+    this->batch_failed =
+        this->batch_failed || telemitry.type == RT::Telemitry::RT_ERROR;
+    return;
+  }
+  telemitry.timestamp = RT::OS::getTime();
   this->eventFifo->writeRT(&telemitry, sizeof(RT::Telemitry::Response));
 }
 
+std::shared_future<RT::Telemitry::response_t> RT::System::trackAsync(
+    RT::System::pooled_cmd_t cmd)
+{
+  const std::unique_lock<std::mutex> lk(this->async_mut);
+  Event::Object* key = cmd.get();
+  auto entry = this->pending_async.emplace(
+      key, async_cmd_t {std::move(cmd), {}});
+  return entry.first->second.completion.get_future().share();
+}
+
+bool RT::System::releaseAsync(RT::Telemitry::Response telemitry)
+{
+  const std::unique_lock<std::mutex> lk(this->async_mut);
+  auto entry = this->pending_async.find(telemitry.cmd);
+  if (entry == this->pending_async.end()) {
+    return false;
+  }
+  entry->second.completion.set_value(telemitry.type);
+  this->pending_async.erase(entry);
+  return true;
+}
+
 void RT::System::createTelemitryProcessor()
 {
   auto proc = [&]()
   {
     eventLogger* logger = this->event_manager->getLogger();
     std::vector<RT::Telemitry::Response> responses;
+    responses.reserve(RT::TELEMITRY_BATCH_SIZE);
     while (!this->task->task_finished
            && this->telemitry_processing_thread_running)
     {
-      responses = this->getTelemitry();
+      // Only sleep once everything posted so far has been handled
+      if (this->drainTelemitry(responses) == 0) {
+        this->telemitry_wakeups.fetch_add(1, std::memory_order_relaxed);
+        this->eventFifo->poll();
+        continue;
+      }
+      this->recordTelemitryDrain(responses);
       for (auto telem : responses) {
-        if (telem.cmd != nullptr) {
+        // Waking up a synchronous caller lets its command be recycled, so
+        // the command must not be looked up after done() is called
+        if (telem.cmd != nullptr && !this->releaseAsync(telem)) {
           telem.cmd->done();
         }
         if (telem.type == RT::Telemitry::RT_SHUTDOWN) {
@@ -352,32 +791,83 @@ std::vector<RT::Telemitry::Response> RT::System::getTelemitry()
 {
   this->eventFifo->poll();
   std::vector<RT::Telemitry::Response> responses;
+  responses.reserve(RT::TELEMITRY_BATCH_SIZE);
+  this->drainTelemitry(responses);
+  return responses;
+}
+
+size_t RT::System::drainTelemitry(
+    std::vector<RT::Telemitry::Response>& responses)
+{
+  responses.clear();
+  const size_t room = responses.capacity();
+  const RT::OS::fifo_span_t span = this->eventFifo->peek();
+  if (span.data != nullptr) {
+    const size_t count =
+        std::min(span.size / sizeof(RT::Telemitry::Response), room);
+    const auto* first = static_cast<RT::Telemitry::Response*>(span.data);
+    responses.insert(responses.end(), first, first + count);
+    this->eventFifo->consume(count * sizeof(RT::Telemitry::Response));
+    return count;
+  }
   RT::Telemitry::Response telemitry;
-  while (this->eventFifo->read(&telemitry, sizeof(RT::Telemitry::Response)) > 0)
+  while (responses.size() < room
+         && this->eventFifo->read(&telemitry, sizeof(RT::Telemitry::Response))
+             > 0)
   {
     responses.push_back(telemitry);
   }
-  return responses;
+  return responses.size();
+}
+
+void RT::System::recordTelemitryDrain(
+    const std::vector<RT::Telemitry::Response>& responses)
+{
+  // Counters are only written by the telemitry processor
+  const int64_t now = RT::OS::getTime();
+  int64_t latency = this->telemitry_max_latency.load(std::memory_order_relaxed);
+  for (const auto& telem : responses) {
+    latency = std::max(latency, now - telem.timestamp);
+  }
+  this->telemitry_max_latency.store(latency, std::memory_order_relaxed);
+  if (responses.size()
+      > this->telemitry_max_depth.load(std::memory_order_relaxed))
+  {
+    this->telemitry_max_depth.store(responses.size(),
+                                    std::memory_order_relaxed);
+  }
+  this->telemitry_responses.fetch_add(responses.size(),
+                                      std::memory_order_relaxed);
+  this->telemitry_drains.fetch_add(1, std::memory_order_relaxed);
+}
+
+RT::telemitry_stats_t RT::System::getTelemitryStats() const
+{
+  RT::telemitry_stats_t stats;
+  stats.responses = this->telemitry_responses.load(std::memory_order_relaxed);
+  stats.drains = this->telemitry_drains.load(std::memory_order_relaxed);
+  stats.wakeups = this->telemitry_wakeups.load(std::memory_order_relaxed);
+  stats.max_depth = this->telemitry_max_depth.load(std::memory_order_relaxed);
+  stats.max_drain_latency =
+      this->telemitry_max_latency.load(std::memory_order_relaxed);
+  return stats;
 }
 
 void RT::System::setPeriod(RT::System::CMD* cmd)
 {
-  auto period = std::get<int64_t>(cmd->getRTParam("period"));
-  this->task->period = period;
+  this->task->period = cmd->getPayload<period_cmd_t>().period;
   const RT::Telemitry::Response telem = {RT::Telemitry::RT_PERIOD_UPDATE, cmd};
   this->postTelemitry(telem);
 }
 
 void RT::System::updateDeviceList(RT::System::CMD* cmd)
 {
-  std::vector<RT::Device*>* vec_ptr =
-      std::get<std::vector<RT::Device*>*>(cmd->getRTParam("deviceList"));
+  auto& payload = cmd->getPayload<device_list_cmd_t>();
   this->devices.clear();
-  this->devices.assign(vec_ptr->begin(), vec_ptr->end());
+  this->devices.assign(payload.devices->begin(), payload.devices->end());
   if (cmd->getType() == Event::Type::RT_DEVICE_REMOVE_EVENT) {
-    auto* device = std::get<RT::Device*>(cmd->getRTParam("device"));
-    this->rt_connector->clearAllConnections(device);
-    device->assignID(IO::INVALID_BLOCK_ID);
+    this->rt_connector->swapRoutingTable(*payload.routing_table);
+    payload.device->assignID(IO::INVALID_BLOCK_ID);
   }
   const RT::Telemitry::Response telem = {RT::Telemitry::RT_DEVICE_LIST_UPDATE,
                                          cmd};
@@ -386,14 +876,16 @@ void RT::System::updateDeviceList(RT::System::CMD* cmd)
 
 void RT::System::updateThreadList(RT::System::CMD* cmd)
 {
-  std::vector<RT::Thread*>* vec_ptr =
-      std::get<std::vector<RT::Thread*>*>(cmd->getRTParam("threadList"));
+  auto& payload = cmd->getPayload<thread_list_cmd_t>();
   this->threads.clear();
-  this->threads.assign(vec_ptr->begin(), vec_ptr->end());
+  this->threads.assign(payload.threads->begin(), payload.threads->end());
+  this->thread_levels.clear();
+  this->thread_levels.assign(payload.levels->begin(), payload.levels->end());
+  this->thread_rates.clear();
+  this->thread_rates.assign(payload.rates->begin(), payload.rates->end());
   if (cmd->getType() == Event::Type::RT_THREAD_REMOVE_EVENT) {
-    auto* thread = std::get<RT::Thread*>(cmd->getRTParam("thread"));
-    this->rt_connector->clearAllConnections(thread);
-    thread->assignID(IO::INVALID_BLOCK_ID);
+    this->rt_connector->swapRoutingTable(*payload.routing_table);
+    payload.thread->assignID(IO::INVALID_BLOCK_ID);
   }
   const RT::Telemitry::Response telem = {RT::Telemitry::RT_THREAD_LIST_UPDATE,
                                          cmd};
@@ -402,18 +894,23 @@ void RT::System::updateThreadList(RT::System::CMD* cmd)
 
 void RT::System::ioLinkUpdateCMD(RT::System::CMD* cmd)
 {
-  auto conn = std::get<RT::block_connection_t>(cmd->getRTParam("connection"));
   RT::Telemitry::Response telem;
   telem.cmd = cmd;
   switch (cmd->getType()) {
     case Event::Type::IO_LINK_INSERT_EVENT:
-      this->rt_connector->connect(conn);
-      telem.type = RT::Telemitry::IO_LINK_UPDATED;
-      break;
-    case Event::Type::IO_LINK_REMOVE_EVENT:
-      this->rt_connector->disconnect(conn);
+    case Event::Type::IO_LINK_REMOVE_EVENT: {
+      auto& payload = cmd->getPayload<thread_list_cmd_t>();
+      this->rt_connector->swapRoutingTable(*payload.routing_table);
+      this->threads.clear();
+      this->threads.assign(payload.threads->begin(), payload.threads->end());
+      this->thread_levels.clear();
+      this->thread_levels.assign(payload.levels->begin(),
+                                 payload.levels->end());
+      this->thread_rates.clear();
+      this->thread_rates.assign(payload.rates->begin(), payload.rates->end());
       telem.type = RT::Telemitry::IO_LINK_UPDATED;
       break;
+    }
     default:
       telem.type = RT::Telemitry::RT_NOOP;
       break;
@@ -423,15 +920,12 @@ void RT::System::ioLinkUpdateCMD(RT::System::CMD* cmd)
 
 void RT::System::getPeriodTicksCMD(RT::System::CMD* cmd)
 {
-  RT::command_param_t value;
   switch (cmd->getType()) {
     case Event::Type::RT_PREPERIOD_EVENT:
-      value = &(this->periodStartTime);
-      cmd->setRTParam("pre-period", value);
+      cmd->setPayload(period_ticks_cmd_t {&(this->periodStartTime)});
       break;
     case Event::Type::RT_POSTPERIOD_EVENT:
-      value = &(this->periodEndTime);
-      cmd->setRTParam("post-period", value);
+      cmd->setPayload(period_ticks_cmd_t {&(this->periodEndTime)});
       break;
     default:
       return;
@@ -445,30 +939,16 @@ void RT::System::changeWidgetParametersCMD(RT::System::CMD* cmd)
   RT::Telemitry::Response telem;
   telem.cmd = cmd;
   telem.type = RT::Telemitry::RT_WIDGET_PARAM_UPDATE;
-  auto* component =
-      std::get<Widgets::Component*>(cmd->getRTParam("paramWidget"));
-  auto param_id = std::get<size_t>(cmd->getRTParam("paramID"));
-  auto param_type_num = std::get<uint64_t>(cmd->getRTParam("paramType"));
-  auto param_type = static_cast<Widgets::Variable::variable_t>(param_type_num);
-  RT::command_param_t param_value_any = cmd->getRTParam("paramValue");
-  switch (param_type) {
-    case Widgets::Variable::DOUBLE_PARAMETER:
-      component->setValue<double>(param_id, std::get<double>(param_value_any));
-      break;
-    case Widgets::Variable::INT_PARAMETER:
-      component->setValue<int64_t>(param_id,
-                                   std::get<int64_t>(param_value_any));
-      break;
-    case Widgets::Variable::UINT_PARAMETER:
-    case Widgets::Variable::STATE:
-      component->setValue<uint64_t>(param_id,
-                                    std::get<uint64_t>(param_value_any));
-      break;
-    default:
-      ERROR_MSG(
-          "Widget Parameter Change event does not contain expected parameter "
-          "types");
-      telem.type = RT::Telemitry::RT_ERROR;
+  auto& payload = cmd->getPayload<widget_parameter_cmd_t>();
+  // the stored alternative tells which kind of parameter is being changed
+  if (const auto* double_value = std::get_if<double>(&payload.value)) {
+    payload.component->setValue<double>(payload.id, *double_value);
+  } else if (const auto* int_value = std::get_if<int64_t>(&payload.value)) {
+    payload.component->setValue<int64_t>(payload.id, *int_value);
+  } else if (const auto* uint_value = std::get_if<uint64_t>(&payload.value)) {
+    payload.component->setValue<uint64_t>(payload.id, *uint_value);
+  } else {
+    telem.type = RT::Telemitry::RT_ERROR;
   }
   this->postTelemitry(telem);
 }
@@ -478,9 +958,49 @@ void RT::System::changeWidgetStateCMD(RT::System::CMD* cmd)
   RT::Telemitry::Response telem;
   telem.cmd = cmd;
   telem.type = RT::Telemitry::RT_WIDGET_STATE_UPDATE;
-  auto* component = std::get<Widgets::Component*>(cmd->getRTParam("component"));
-  auto state = std::get<RT::State::state_t>(cmd->getRTParam("state"));
-  component->setState(state);
+  auto& payload = cmd->getPayload<widget_state_cmd_t>();
+  payload.component->setState(payload.state);
+  this->postTelemitry(telem);
+}
+
+void RT::System::profilerChangeCMD(RT::System::CMD* cmd)
+{
+  this->profiling = cmd->getType() == Event::Type::RT_PROFILER_START_EVENT;
+  const RT::Telemitry::Response telem = {RT::Telemitry::RT_PROFILER_UPDATE,
+                                         cmd};
+  this->postTelemitry(telem);
+}
+
+void RT::System::overrunPolicyChangeCMD(RT::System::CMD* cmd)
+{
+  this->task->overrun_policy =
+      cmd->getPayload<overrun_policy_cmd_t>().policy;
+  const RT::Telemitry::Response telem = {
+      RT::Telemitry::RT_OVERRUN_POLICY_UPDATE, cmd};
+  this->postTelemitry(telem);
+}
+
+void RT::System::reportOverrun(int64_t time, uint64_t skipped_periods)
+{
+  RT::overrun_t overrun = {time, skipped_periods};
+  // The counters in the task stay exact even if this fifo is full
+  if (this->overrunFifo->writeRT(&overrun, sizeof(RT::overrun_t)) <= 0) {
+    this->overrun_dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void RT::System::commandBatchCMD(RT::System::CMD* cmd)
+{
+  this->executing_batch = true;
+  this->batch_failed = false;
+  for (auto* command : *cmd->getPayload<batch_cmd_t>().commands) {
+    this->executeCMD(command);
+  }
+  this->executing_batch = false;
+  const RT::Telemitry::Response telem = {
+      this->batch_failed ? RT::Telemitry::RT_ERROR
+                         : RT::Telemitry::RT_BATCH_UPDATE,
+      cmd};
   this->postTelemitry(telem);
 }
 
@@ -524,6 +1044,16 @@ void RT::System::executeCMD(RT::System::CMD* cmd)
     case Event::Type::RT_WIDGET_STATE_CHANGE_EVENT:
       this->changeWidgetStateCMD(cmd);
       break;
+    case Event::Type::RT_PROFILER_START_EVENT:
+    case Event::Type::RT_PROFILER_STOP_EVENT:
+      this->profilerChangeCMD(cmd);
+      break;
+    case Event::Type::RT_OVERRUN_POLICY_EVENT:
+      this->overrunPolicyChangeCMD(cmd);
+      break;
+    case Event::Type::RT_COMMAND_BATCH_EVENT:
+      this->commandBatchCMD(cmd);
+      break;
     case Event::Type::NOOP:
       telem.type = RT::Telemitry::RT_NOOP;
       telem.cmd = cmd;
@@ -591,6 +1121,22 @@ void RT::System::receiveEvent(Event::Object* event)
     case Event::Type::RT_WIDGET_STATE_CHANGE_EVENT:
       this->changeWidgetState(event);
       break;
+    case Event::Type::RT_PROFILER_START_EVENT:
+    case Event::Type::RT_PROFILER_STOP_EVENT:
+      this->profilerChange(event);
+      break;
+    case Event::Type::RT_PROFILER_QUERY_EVENT:
+      this->profilerQuery(event);
+      break;
+    case Event::Type::RT_OVERRUN_POLICY_EVENT:
+      this->overrunPolicyChange(event);
+      break;
+    case Event::Type::RT_OVERRUN_QUERY_EVENT:
+      this->overrunQuery(event);
+      break;
+    case Event::Type::RT_COMMAND_BATCH_EVENT:
+      this->commandBatch(event);
+      break;
     case Event::Type::RT_SHUTDOWN_EVENT:
       this->shutdown(event);
       break;
@@ -609,12 +1155,47 @@ void RT::System::receiveEvent(Event::Object* event)
   }
 }
 
+std::vector<Event::Type> RT::System::subscriptions() const
+{
+  return {Event::Type::RT_PERIOD_EVENT,
+          Event::Type::RT_PREPERIOD_EVENT,
+          Event::Type::RT_POSTPERIOD_EVENT,
+          Event::Type::RT_GET_PERIOD_EVENT,
+          Event::Type::RT_THREAD_INSERT_EVENT,
+          Event::Type::RT_THREAD_REMOVE_EVENT,
+          Event::Type::RT_THREAD_PAUSE_EVENT,
+          Event::Type::RT_THREAD_UNPAUSE_EVENT,
+          Event::Type::RT_DEVICE_INSERT_EVENT,
+          Event::Type::RT_DEVICE_REMOVE_EVENT,
+          Event::Type::RT_DEVICE_PAUSE_EVENT,
+          Event::Type::RT_DEVICE_UNPAUSE_EVENT,
+          Event::Type::RT_WIDGET_PARAMETER_CHANGE_EVENT,
+          Event::Type::RT_WIDGET_STATE_CHANGE_EVENT,
+          Event::Type::RT_SHUTDOWN_EVENT,
+          Event::Type::RT_PROFILER_START_EVENT,
+          Event::Type::RT_PROFILER_STOP_EVENT,
+          Event::Type::RT_PROFILER_QUERY_EVENT,
+          Event::Type::RT_OVERRUN_POLICY_EVENT,
+          Event::Type::RT_OVERRUN_QUERY_EVENT,
+          Event::Type::RT_COMMAND_BATCH_EVENT,
+          Event::Type::IO_LINK_INSERT_EVENT,
+          Event::Type::IO_LINK_REMOVE_EVENT,
+          Event::Type::IO_BLOCK_QUERY_EVENT,
+          Event::Type::IO_BLOCK_OUTPUTS_QUERY_EVENT,
+          Event::Type::IO_ALL_CONNECTIONS_QUERY_EVENT,
+          Event::Type::NOOP};
+}
+
+void RT::System::fillPeriodCMD(RT::System::CMD* cmd, Event::Object* event)
+{
+  cmd->setPayload(
+      period_cmd_t {event->getPayload<Event::period_payload_t>().period});
+}
+
 void RT::System::setPeriod(Event::Object* event)
 {
-  // auto period = std::any_cast<int64_t>(event->getParam("period"));
   RT::System::CMD cmd(event->getType());
-  auto period = std::any_cast<int64_t>(event->getParam("period"));
-  cmd.setRTParam("period", period);
+  RT::System::fillPeriodCMD(&cmd, event);
   RT::System::CMD* cmd_ptr = &cmd;
   this->eventFifo->write(&cmd_ptr, sizeof(RT::System::CMD*));
   cmd.wait();
@@ -635,17 +1216,17 @@ void RT::System::NOOP(Event::Object* /*event*/)
 
 void RT::System::insertDevice(Event::Object* event)
 {
-  auto* device = std::any_cast<RT::Device*>(event->getParam("device"));
+  auto* device = event->getPayload<Event::device_payload_t>().device;
   std::vector<RT::block_connection_t> connections_memory;
   connections_memory.reserve(10);
   if (device == nullptr) {
     ERROR_MSG("RT::System::insertDevice : invalid device pointer\n");
     return;
   }
+  const std::unique_lock<std::mutex> lk(this->connector_mut);
   this->rt_connector->insertBlock(device, connections_memory);
   std::vector<RT::Device*> device_list = this->rt_connector->getDevices();
-  RT::System::CMD cmd(event->getType());
-  cmd.setRTParam("deviceList", &device_list);
+  RT::System::CMD cmd(event->getType(), device_list_cmd_t {&device_list});
   RT::System::CMD* cmd_ptr = &cmd;
   this->eventFifo->write(&cmd_ptr, sizeof(RT::System::CMD*));
   cmd.wait();
@@ -653,35 +1234,44 @@ void RT::System::insertDevice(Event::Object* event)
 
 void RT::System::removeDevice(Event::Object* event)
 {
-  auto* device = std::any_cast<RT::Device*>(event->getParam("device"));
+  auto* device = event->getPayload<Event::device_payload_t>().device;
   if (device == nullptr) {
     ERROR_MSG("RT::System::removeDevice : invalid device pointer\n");
     return;
   }
   // We have to make sure to deactivate device before removing
+  std::unique_lock<std::mutex> lk(this->connector_mut);
   this->rt_connector->removeBlock(device);
   std::vector<RT::Device*> device_list = this->rt_connector->getDevices();
-  RT::System::CMD cmd(event->getType());
-  cmd.setRTParam("deviceList", &device_list);
-  cmd.setRTParam("device", device);
+  auto routing_table = this->rt_connector->compileRoutingTable();
+  RT::System::CMD cmd(event->getType(),
+                      device_list_cmd_t {&device_list, device, &routing_table});
   RT::System::CMD* cmd_ptr = &cmd;
   this->eventFifo->write(&cmd_ptr, sizeof(RT::System::CMD*));
   cmd.wait();
+  lk.unlock();
+  this->forgetProfile(device);
 }
 
 void RT::System::insertThread(Event::Object* event)
 {
-  auto* thread = std::any_cast<RT::Thread*>(event->getParam("thread"));
+  auto* thread = event->getPayload<Event::thread_payload_t>().thread;
   std::vector<RT::block_connection_t> connections_memory;
   connections_memory.reserve(10);
   if (thread == nullptr) {
     ERROR_MSG("RT::System::removeDevice : invalid device pointer\n");
     return;
   }
+  const std::unique_lock<std::mutex> lk(this->connector_mut);
   this->rt_connector->insertBlock(thread, connections_memory);
   std::vector<RT::Thread*> thread_list = this->rt_connector->getThreads();
-  RT::System::CMD cmd(event->getType());
-  cmd.setRTParam("threadList", &thread_list);
+  std::vector<size_t> levels =
+      this->rt_connector->getThreadLevels(thread_list);
+  std::vector<RT::thread_rate_t> rates =
+      this->rt_connector->getThreadRates(thread_list);
+  RT::System::CMD cmd(
+      event->getType(),
+      thread_list_cmd_t {&thread_list, &levels, &rates});
   RT::System::CMD* cmd_ptr = &cmd;
   this->eventFifo->write(&cmd_ptr, sizeof(RT::System::CMD*));
   cmd.wait();
@@ -690,32 +1280,47 @@ void RT::System::insertThread(Event::Object* event)
 // TODO: come back after figuring out connection problems
 void RT::System::removeThread(Event::Object* event)
 {
-  auto* thread = std::any_cast<RT::Thread*>(event->getParam("thread"));
+  auto* thread = event->getPayload<Event::thread_payload_t>().thread;
   if (thread == nullptr) {
     ERROR_MSG("RT::System::removeDevice : invalid device pointer\n");
     return;
   }
   // We have to make sure to deactivate thread before removing
   thread->setActive(/*act=*/false);
+  std::unique_lock<std::mutex> lk(this->connector_mut);
   this->rt_connector->removeBlock(thread);
   std::vector<RT::Thread*> thread_list = this->rt_connector->getThreads();
-  RT::System::CMD cmd(event->getType());
-  cmd.setRTParam("threadList", &thread_list);
-  cmd.setRTParam("thread", thread);
+  std::vector<size_t> levels =
+      this->rt_connector->getThreadLevels(thread_list);
+  std::vector<RT::thread_rate_t> rates =
+      this->rt_connector->getThreadRates(thread_list);
+  auto routing_table = this->rt_connector->compileRoutingTable();
+  RT::System::CMD cmd(event->getType(),
+                      thread_list_cmd_t {&thread_list,
+                                         &levels,
+                                         &rates,
+                                         thread,
+                                         &routing_table});
   RT::System::CMD* cmd_ptr = &cmd;
   this->eventFifo->write(&cmd_ptr, sizeof(RT::System::CMD*));
   cmd.wait();
+  lk.unlock();
+  this->forgetProfile(thread);
 }
 
 void RT::System::threadActivityChange(Event::Object* event)
 {
   auto isactive = event->getType() == Event::Type::RT_THREAD_UNPAUSE_EVENT;
-  RT::System::CMD cmd(event->getType());
-  RT::System::CMD* cmd_ptr = &cmd;
-  auto* thread = std::any_cast<RT::Thread*>(event->getParam("thread"));
+  auto* thread = event->getPayload<Event::thread_payload_t>().thread;
   thread->setActive(isactive);
+  const std::unique_lock<std::mutex> lk(this->connector_mut);
   auto thread_list = this->rt_connector->getThreads();
-  cmd.setRTParam("threadList", &thread_list);
+  auto levels = this->rt_connector->getThreadLevels(thread_list);
+  auto rates = this->rt_connector->getThreadRates(thread_list);
+  RT::System::CMD cmd(
+      event->getType(),
+      thread_list_cmd_t {&thread_list, &levels, &rates});
+  RT::System::CMD* cmd_ptr = &cmd;
   this->eventFifo->write(&cmd_ptr, sizeof(RT::System::CMD*));
   cmd.wait();
 }
@@ -723,46 +1328,152 @@ void RT::System::threadActivityChange(Event::Object* event)
 void RT::System::deviceActivityChange(Event::Object* event)
 {
   auto isactive = event->getType() == Event::Type::RT_DEVICE_UNPAUSE_EVENT;
-  RT::System::CMD cmd(event->getType());
-  RT::System::CMD* cmd_ptr = &cmd;
-  auto* device = std::any_cast<RT::Device*>(event->getParam("device"));
+  auto* device = event->getPayload<Event::device_payload_t>().device;
   device->setActive(isactive);
+  const std::unique_lock<std::mutex> lk(this->connector_mut);
   auto device_list = this->rt_connector->getDevices();
-  cmd.setRTParam("deviceList", &device_list);
+  RT::System::CMD cmd(event->getType(), device_list_cmd_t {&device_list});
+  RT::System::CMD* cmd_ptr = &cmd;
   this->eventFifo->write(&cmd_ptr, sizeof(RT::System::CMD*));
   cmd.wait();
 }
 
 void RT::System::ioLinkChange(Event::Object* event)
 {
+  auto connection =
+      std::any_cast<RT::block_connection_t>(event->getParam("connection"));
+  const std::unique_lock<std::mutex> lk(this->connector_mut);
+  if (event->getType() == Event::Type::IO_LINK_INSERT_EVENT) {
+    if (this->rt_connector->connect(connection) != 0) {
+      // Nothing changed, the real-time thread keeps its current table
+      event->setParam("status", std::any(std::string("failure")));
+      return;
+    }
+  } else {
+    this->rt_connector->disconnect(connection);
+  }
   RT::System::CMD cmd(event->getType());
-  cmd.setRTParam(
-      "connection",
-      std::any_cast<RT::block_connection_t>(event->getParam("connection")));
+  this->fillIOLinkCMD(&cmd);
   RT::System::CMD* cmd_ptr = &cmd;
   this->eventFifo->write(&cmd_ptr, sizeof(RT::System::CMD*));
   cmd.wait();
+  event->setParam("status", std::any(std::string("success")));
+}
+
+void RT::System::fillIOLinkCMD(RT::System::CMD* cmd)
+{
+  // The real-time thread only ever sees the compiled table. The previously
+  // active table is handed back through the command and released with it.
+  auto* routing_table = cmd->own(this->rt_connector->compileRoutingTable());
+  // connections also decide the execution order of threads
+  auto* thread_list = cmd->own(this->rt_connector->getThreads());
+  auto* levels = cmd->own(this->rt_connector->getThreadLevels(*thread_list));
+  auto* rates = cmd->own(this->rt_connector->getThreadRates(*thread_list));
+  cmd->setPayload(thread_list_cmd_t {
+      thread_list, levels, rates, nullptr, routing_table});
+}
+
+void RT::System::commandBatch(Event::Object* event)
+{
+  auto events =
+      std::any_cast<std::vector<Event::Object*>>(event->getParam("events"));
+  const bool async = event->paramExists("async")
+      && std::any_cast<bool>(event->getParam("async"));
+  RT::System::pooled_cmd_t batch = this->acquireCMD(event->getType());
+  auto* commands = batch->own(std::vector<RT::System::CMD*>());
+  auto* sub_commands = batch->own(std::vector<RT::System::pooled_cmd_t>());
+  RT::System::CMD* link_cmd = nullptr;
+  std::unique_lock<std::mutex> lk(this->connector_mut);
+  for (auto* sub_event : events) {
+    const Event::Type type = sub_event->getType();
+    switch (type) {
+      case Event::Type::RT_PERIOD_EVENT:
+        sub_commands->push_back(this->acquireCMD(type));
+        RT::System::fillPeriodCMD(sub_commands->back().get(), sub_event);
+        break;
+      case Event::Type::RT_WIDGET_PARAMETER_CHANGE_EVENT:
+        sub_commands->push_back(this->acquireCMD(type));
+        RT::System::fillWidgetParametersCMD(sub_commands->back().get(),
+                                            sub_event);
+        break;
+      case Event::Type::RT_WIDGET_STATE_CHANGE_EVENT:
+        sub_commands->push_back(this->acquireCMD(type));
+        RT::System::fillWidgetStateCMD(sub_commands->back().get(), sub_event);
+        break;
+      case Event::Type::IO_LINK_INSERT_EVENT:
+      case Event::Type::IO_LINK_REMOVE_EVENT: {
+        auto connection = std::any_cast<RT::block_connection_t>(
+            sub_event->getParam("connection"));
+        if (type == Event::Type::IO_LINK_INSERT_EVENT) {
+          if (this->rt_connector->connect(connection) != 0) {
+            sub_event->setParam("status", std::any(std::string("failure")));
+            continue;
+          }
+        } else {
+          this->rt_connector->disconnect(connection);
+        }
+        sub_event->setParam("status", std::any(std::string("success")));
+        // every link change is carried by one command, filled in once the
+        // whole graph has been updated
+        if (link_cmd != nullptr) {
+          continue;
+        }
+        sub_commands->push_back(this->acquireCMD(type));
+        link_cmd = sub_commands->back().get();
+        break;
+      }
+      default:
+        // Changes to the block lists wait on the real-time thread and take
+        // the connector lock themselves
+        lk.unlock();
+        this->receiveEvent(sub_event);
+        lk.lock();
+        continue;
+    }
+    commands->push_back(sub_commands->back().get());
+  }
+  if (link_cmd != nullptr) {
+    this->fillIOLinkCMD(link_cmd);
+  }
+  batch->setPayload(batch_cmd_t {commands});
+
+  RT::System::CMD* cmd_ptr = batch.get();
+  if (async) {
+    // tracked before submission so that completion can never be missed
+    event->setParam("completion",
+                    std::any(this->trackAsync(std::move(batch))));
+    this->eventFifo->write(&cmd_ptr, sizeof(RT::System::CMD*));
+    return;
+  }
+  this->eventFifo->write(&cmd_ptr, sizeof(RT::System::CMD*));
+  cmd_ptr->wait();
 }
 
 void RT::System::connectionsInfoRequest(Event::Object* event)
 {
   auto* source = std::any_cast<IO::Block*>(event->getParam("block"));
+  std::unique_lock<std::mutex> lk(this->connector_mut);
   const std::vector<RT::block_connection_t> outputs =
       this->rt_connector->getOutputs(source);
+  lk.unlock();
   event->setParam("outputs", std::any(outputs));
 }
 
 void RT::System::allConnectionsInfoRequest(Event::Object* event)
 {
+  std::unique_lock<std::mutex> lk(this->connector_mut);
   const std::vector<RT::block_connection_t> all_conn =
       this->rt_connector->getAllConnections();
+  lk.unlock();
   event->setParam("connections", std::any(all_conn));
 }
 
 void RT::System::blockInfoRequest(Event::Object* event)
 {
+  std::unique_lock<std::mutex> lk(this->connector_mut);
   const std::vector<IO::Block*> blocks =
       this->rt_connector->getRegisteredBlocks();
+  lk.unlock();
   event->setParam("blockList", std::any(blocks));
 }
 
@@ -781,102 +1492,277 @@ void RT::System::provideTimetickPointers(Event::Object* event)
   this->eventFifo->write(&cmd_ptr, sizeof(RT::System::CMD*));
   cmd.wait();
 
-  int64_t* startperiod = nullptr;
-  int64_t* stopperiod = nullptr;
+  int64_t* ticks = cmd.getPayload<period_ticks_cmd_t>().ticks;
   // transfer values to event for poster to use
   switch (event->getType()) {
     case Event::Type::RT_PREPERIOD_EVENT:
-      startperiod = std::get<int64_t*>(cmd.getRTParam("pre-period"));
-      event->setParam("pre-period", std::any(startperiod));
+      event->setParam("pre-period", std::any(ticks));
       break;
     case Event::Type::RT_POSTPERIOD_EVENT:
-      stopperiod = std::get<int64_t*>(cmd.getRTParam("post-period"));
-      event->setParam("post-period", std::any(stopperiod));
+      event->setParam("post-period", std::any(ticks));
       break;
     default:
       return;
   }
 }
 
-void RT::System::changeWidgetParameters(Event::Object* event)
+void RT::System::fillWidgetParametersCMD(RT::System::CMD* cmd,
+                                         Event::Object* event)
 {
   // we must convert event object to cmd object
-  RT::System::CMD cmd(event->getType());
-  auto* component =
-      std::any_cast<Widgets::Component*>(event->getParam("paramWidget"));
-  cmd.setRTParam("paramWidget", component);
-  auto param_id = std::any_cast<size_t>(event->getParam("paramID"));
-  cmd.setRTParam("paramID", param_id);
-  auto param_type = std::any_cast<Widgets::Variable::variable_t>(
-      event->getParam("paramType"));
-  cmd.setRTParam("paramType", param_type);
-  std::any param_value_any = event->getParam("paramValue");
-  switch (param_type) {
+  const auto parameter =
+      event->getPayload<Event::widget_parameter_payload_t>();
+  widget_parameter_cmd_t payload;
+  payload.component = parameter.component;
+  payload.id = parameter.id;
+  switch (parameter.type) {
     case Widgets::Variable::DOUBLE_PARAMETER:
-      cmd.setRTParam("paramValue", std::any_cast<double>(param_value_any));
+      payload.value = std::get<double>(parameter.value);
       break;
     case Widgets::Variable::INT_PARAMETER:
-      cmd.setRTParam("paramValue", std::any_cast<int64_t>(param_value_any));
-
+      payload.value = std::get<int64_t>(parameter.value);
       break;
     case Widgets::Variable::UINT_PARAMETER:
     case Widgets::Variable::STATE:
-      cmd.setRTParam("paramValue", std::any_cast<uint64_t>(param_value_any));
+      payload.value = std::get<uint64_t>(parameter.value);
       break;
     default:
       ERROR_MSG(
           "Widget Parameter Change event does not contain expected parameter "
           "types");
   }
+  cmd->setPayload(payload);
+}
 
+void RT::System::changeWidgetParameters(Event::Object* event)
+{
+  RT::System::CMD cmd(event->getType());
+  RT::System::fillWidgetParametersCMD(&cmd, event);
   RT::System::CMD* cmd_ptr = &cmd;
   this->eventFifo->write(&cmd_ptr, sizeof(RT::System::CMD*));
   cmd_ptr->wait();
 }
 
+void RT::System::fillWidgetStateCMD(RT::System::CMD* cmd, Event::Object* event)
+{
+  const auto state = event->getPayload<Event::widget_state_payload_t>();
+  cmd->setPayload(widget_state_cmd_t {state.component, state.state});
+}
+
 void RT::System::changeWidgetState(Event::Object* event)
 {
   RT::System::CMD cmd(event->getType());
-  auto* component =
-      std::any_cast<Widgets::Component*>(event->getParam("component"));
-  auto state = std::any_cast<RT::State::state_t>(event->getParam("state"));
-  cmd.setRTParam("component", component);
-  cmd.setRTParam("state", state);
+  RT::System::fillWidgetStateCMD(&cmd, event);
   RT::System::CMD* cmd_ptr = &cmd;
   this->eventFifo->write(&cmd_ptr, sizeof(RT::System::CMD*));
   cmd.wait();
 }
 
-RT::System::CMD::CMD(Event::Type et)
-    : Event::Object(et)
+void RT::System::profilerChange(Event::Object* event)
 {
+  // Results from a previous session are discarded when starting over
+  if (event->getType() == Event::Type::RT_PROFILER_START_EVENT) {
+    this->resetProfile();
+  }
+  RT::System::CMD cmd(event->getType());
+  RT::System::CMD* cmd_ptr = &cmd;
+  this->eventFifo->write(&cmd_ptr, sizeof(RT::System::CMD*));
+  cmd.wait();
+  // Keep what was measured until the profiler was stopped
+  const std::unique_lock<std::mutex> lk(this->profile_mut);
+  this->drainProfileFifos();
 }
 
-RT::command_param_t RT::System::CMD::getRTParam(
-    const std::string_view& param_name)
+void RT::System::resetProfile()
 {
-  for (auto& parameter : rt_params) {
-    if (parameter.name == param_name) {
-      return parameter.value;
+  const std::unique_lock<std::mutex> lk(this->profile_mut);
+  this->drainProfileFifos();
+  this->profile_stats.clear();
+  this->profile_dropped.store(0, std::memory_order_relaxed);
+}
+
+void RT::System::startDrain()
+{
+  const std::unique_lock<std::mutex> lk(this->profile_mut);
+  this->drain_thread = std::thread(&RT::System::drainLoop, this);
+  RT::OS::renameOSThread(this->drain_thread, std::string("RTXIDrain"));
+}
+
+void RT::System::stopDrain()
+{
+  std::thread owned_thread;
+  {
+    const std::unique_lock<std::mutex> lk(this->profile_mut);
+    owned_thread = std::move(this->drain_thread);
+  }
+  this->drain_cond.notify_all();
+  if (owned_thread.joinable()) {
+    owned_thread.join();
+  }
+}
+
+void RT::System::drainLoop()
+{
+  const auto owned = [this]()
+  { return this->drain_thread.get_id() == std::this_thread::get_id(); };
+  std::unique_lock<std::mutex> lk(this->profile_mut);
+  while (owned()) {
+    this->drainProfileFifos();
+    {
+      const std::unique_lock<std::mutex> overrun_lk(this->overrun_mut);
+      this->drainOverrunFifo();
     }
+    this->drain_cond.wait_for(
+        lk, RT::DRAIN_INTERVAL, [&owned]() { return !owned(); });
   }
-  return std::monostate();
 }
 
-void RT::System::CMD::setRTParam(const std::string_view& param_name,
-                                 const RT::command_param_t& value)
+void RT::System::profilerQuery(Event::Object* event)
 {
-  for (auto& parameter : rt_params) {
-    if (parameter.name == param_name) {
-      parameter.value = value;
-      return;
+  const std::unique_lock<std::mutex> lk(this->profile_mut);
+  this->drainProfileFifos();
+  std::vector<RT::block_profile_t> profile;
+  std::vector<int64_t> recent;
+  for (auto& [key, stats] : this->profile_stats) {
+    RT::block_profile_t entry;
+    // Stats of removed blocks are dropped, so the block is still alive
+    entry.block_name = key.first->getName();
+    entry.stage = key.second;
+    entry.count = stats.count;
+    entry.mean = stats.total / static_cast<double>(stats.count);
+    entry.max = stats.max;
+    recent = stats.recent;
+    const size_t p99_index = (recent.size() * 99) / 100;
+    std::nth_element(recent.begin(),
+                     recent.begin() + static_cast<int64_t>(p99_index),
+                     recent.end());
+    entry.p99 = recent[p99_index];
+    profile.push_back(entry);
+  }
+  event->setParam("profile", std::any(profile));
+  event->setParam(
+      "profile_dropped",
+      std::any(this->profile_dropped.load(std::memory_order_relaxed)));
+}
+
+void RT::System::drainProfileFifo(RT::OS::Fifo* fifo)
+{
+  RT::profile_sample_t sample;
+  while (fifo->read(&sample, sizeof(RT::profile_sample_t)) > 0) {
+    auto& stats = this->profile_stats[{sample.block, sample.stage}];
+    stats.count++;
+    stats.total += static_cast<double>(sample.duration);
+    stats.max = std::max(stats.max, sample.duration);
+    if (stats.recent.size() < RT::PROFILE_RECENT_SAMPLES) {
+      stats.recent.push_back(sample.duration);
+    } else {
+      stats.recent[stats.next_recent] = sample.duration;
+      stats.next_recent = (stats.next_recent + 1) % RT::PROFILE_RECENT_SAMPLES;
+    }
+  }
+}
+
+void RT::System::drainProfileFifos()
+{
+  this->drainProfileFifo(this->profileFifo.get());
+  for (auto& worker : this->workers) {
+    this->drainProfileFifo(worker->profile_fifo.get());
+  }
+}
+
+void RT::System::forgetProfile(IO::Block* block)
+{
+  const std::unique_lock<std::mutex> lk(this->profile_mut);
+  // Pending samples may still refer to the block
+  this->drainProfileFifos();
+  for (auto iter = this->profile_stats.begin();
+       iter != this->profile_stats.end();)
+  {
+    if (iter->first.first == block) {
+      iter = this->profile_stats.erase(iter);
+    } else {
+      iter++;
+    }
+  }
+}
+
+void RT::System::overrunPolicyChange(Event::Object* event)
+{
+  RT::System::CMD cmd(
+      event->getType(),
+      overrun_policy_cmd_t {
+          std::any_cast<RT::OS::overrun_policy_t>(event->getParam("policy"))});
+  RT::System::CMD* cmd_ptr = &cmd;
+  this->eventFifo->write(&cmd_ptr, sizeof(RT::System::CMD*));
+  cmd.wait();
+}
+
+void RT::System::drainOverrunFifo()
+{
+  RT::overrun_t overrun;
+  while (this->overrunFifo->read(&overrun, sizeof(RT::overrun_t)) > 0) {
+    if (this->recent_overruns.size() < RT::OVERRUN_RECENT_COUNT) {
+      this->recent_overruns.push_back(overrun);
+    } else {
+      this->recent_overruns[this->next_overrun] = overrun;
+      this->next_overrun = (this->next_overrun + 1) % RT::OVERRUN_RECENT_COUNT;
     }
   }
+}
 
-  rt_param temp = {};
-  temp.name = param_name;
-  temp.value = value;
-  rt_params.push_back(temp);
+void RT::System::overrunQuery(Event::Object* event)
+{
+  const std::unique_lock<std::mutex> lk(this->overrun_mut);
+  this->drainOverrunFifo();
+  RT::overrun_stats_t stats;
+  stats.overruns = this->task->overruns.load(std::memory_order_relaxed);
+  stats.skipped_periods =
+      this->task->skipped_periods.load(std::memory_order_relaxed);
+  stats.dropped = this->overrun_dropped.load(std::memory_order_relaxed);
+  stats.recent.reserve(this->recent_overruns.size());
+  stats.recent.insert(stats.recent.end(),
+                      this->recent_overruns.begin()
+                          + static_cast<int64_t>(this->next_overrun),
+                      this->recent_overruns.end());
+  stats.recent.insert(stats.recent.end(),
+                      this->recent_overruns.begin(),
+                      this->recent_overruns.begin()
+                          + static_cast<int64_t>(this->next_overrun));
+  event->setParam("overruns", std::any(stats));
+}
+
+RT::System::CMD::CMD(Event::Type et, RT::System::cmd_payload_t cmd_payload)
+    : Event::Object(et)
+    , payload(cmd_payload)
+{
+}
+
+RT::System::pooled_cmd_t RT::System::acquireCMD(
+    Event::Type type, RT::System::cmd_payload_t cmd_payload)
+{
+  std::unique_lock<std::mutex> lk(this->cmd_pool_mut);
+  if (this->free_cmds.empty()) {
+    lk.unlock();
+    return {new RT::System::CMD(type, cmd_payload),
+            cmd_releaser_t {this, RT::System::CMD_POOL_SIZE}};
+  }
+  const size_t slot = this->free_cmds.back();
+  this->free_cmds.pop_back();
+  auto& cmd = this->cmd_pool[slot].emplace(type, cmd_payload);
+  return {&cmd, cmd_releaser_t {this, slot}};
+}
+
+void RT::System::cmd_releaser_t::operator()(RT::System::CMD* cmd) const
+{
+  if (this->slot == RT::System::CMD_POOL_SIZE) {
+    delete cmd;
+    return;
+  }
+  // The slot is not shared until it is back in the free list. Commands can
+  // own other pooled commands, so it is destroyed before taking the lock.
+  this->system->cmd_pool[this->slot].reset();
+  const std::unique_lock<std::mutex> lk(this->system->cmd_pool_mut);
+  this->system->free_cmds.push_back(this->slot);
 }
 
 void RT::System::execute(void* sys)
@@ -901,21 +1787,44 @@ void RT::System::execute(void* sys)
     system->periodEndTime = endtime;
 
     // sleep until next cycle
+    const uint64_t overruns =
+        system->task->overruns.load(std::memory_order_relaxed);
+    const uint64_t skipped_periods =
+        system->task->skipped_periods.load(std::memory_order_relaxed);
     RT::OS::sleepTimestep(system->task.get());
     starttime = RT::OS::getTime();
+    system->tick++;
+    if (system->task->overruns.load(std::memory_order_relaxed) != overruns) {
+      system->reportOverrun(
+          starttime,
+          system->task->skipped_periods.load(std::memory_order_relaxed)
+              - skipped_periods);
+    }
 
     for (auto* iDevice : system->devices) {
-      iDevice->read();
-      system->rt_connector->propagateBlockConnections(iDevice);
+      system->profile(system->profileFifo.get(),
+                      iDevice,
+                      RT::PROFILE_READ,
+                      [iDevice]() { iDevice->read(); });
+      system->profile(
+          system->profileFifo.get(),
+          iDevice,
+          RT::PROFILE_PROPAGATE,
+          [system, iDevice]()
+          { system->rt_connector->propagateBlockConnections(iDevice); });
     }
 
-    for (auto* iThread : system->threads) {
-      iThread->execute();
-      system->rt_connector->propagateBlockConnections(iThread);
+    for (size_t level = 0; level + 1 < system->thread_levels.size(); level++)
+    {
+      system->executeThreads(system->thread_levels[level],
+                             system->thread_levels[level + 1]);
     }
 
     for (auto* iDevice : system->devices) {
-      iDevice->write();
+      system->profile(system->profileFifo.get(),
+                      iDevice,
+                      RT::PROFILE_WRITE,
+                      [iDevice]() { iDevice->write(); });
     }
 
     while (system->eventFifo->readRT(&cmd, sizeof(RT::System::CMD*)) > 0) {
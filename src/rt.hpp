@@ -21,6 +21,18 @@
 #ifndef RT_H
 #define RT_H
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
 #include <variant>
 #include <vector>
 
@@ -31,6 +43,7 @@ namespace RT::OS
 {
 struct Task;
 class Fifo;
+enum overrun_policy_t : int8_t;
 }  // namespace RT::OS
 
 // forward declaration
@@ -83,6 +96,12 @@ constexpr response_t IO_LINK_UPDATED =
     6; /*!< A interblock connection was updated*/
 constexpr response_t RT_WIDGET_STATE_UPDATE =
     7; /*!< The state of a widget was updated*/
+constexpr response_t RT_PROFILER_UPDATE =
+    8; /*!< The block profiler was started or stopped*/
+constexpr response_t RT_OVERRUN_POLICY_UPDATE =
+    9; /*!< The overrun policy was updated*/
+constexpr response_t RT_BATCH_UPDATE =
+    10; /*!< A batch of commands was applied*/
 constexpr response_t RT_ERROR =
     -1; /*!< There was an error with the last event handling*/
 constexpr response_t NO_TELEMITRY = -2; /*!< No Telemitry (placeholder)*/
@@ -101,6 +120,7 @@ struct Response
 {
   response_t type = NO_TELEMITRY;
   Event::Object* cmd = nullptr;
+  int64_t timestamp = 0; /*!< RT::OS::getTime() when it was posted*/
 };
 }  // namespace Telemitry
 
@@ -170,6 +190,32 @@ public:
    * \sa RT::System
    */
   virtual void execute() = 0;
+
+  /*!
+   * Set how often the thread executes relative to the real-time period
+   *
+   * A divisor of N makes the thread execute once every N periods, with its
+   * inputs and outputs holding their values in between. RT::OS::getPeriod()
+   * still reports the base period, so time dependent calculations should
+   * scale it by the divisor. Takes effect the next time RT::System updates
+   * its list of threads.
+   *
+   * \param divisor Number of periods between executions. Zero is taken as 1.
+   */
+  void setRateDivisor(uint64_t divisor)
+  {
+    this->rate_divisor = divisor == 0 ? 1 : divisor;
+  }
+
+  /*!
+   * Get how often the thread executes relative to the real-time period
+   *
+   * \returns The number of periods between executions
+   */
+  uint64_t getRateDivisor() const { return this->rate_divisor; }
+
+private:
+  uint64_t rate_divisor = 1;
 };  // class Thread
 
 /*!
@@ -205,6 +251,45 @@ typedef struct block_connection_t
   }
 } block_connection_t;
 
+// Largest number of periods getThreadRates balances thread phases over
+constexpr uint64_t MAX_PHASE_WINDOW = 1 << 16;
+
+/*!
+ * Execution rate assigned to a thread by the scheduler
+ *
+ * \param divisor The thread executes once every divisor periods
+ * \param phase The period, modulo divisor, in which the thread executes
+ *
+ * \sa RT::Thread::setRateDivisor()
+ */
+typedef struct thread_rate_t
+{
+  uint64_t divisor = 1;
+  uint64_t phase = 0;
+} thread_rate_t;
+
+/*!
+ * Flattened representation of all connections between blocks
+ *
+ * The connection graph is compiled into a struct of arrays so that the
+ * real-time loop can propagate values with nothing more than pointer loads
+ * and additions. Connections originating from the block with id n occupy the
+ * index range [block_offsets[n], block_offsets[n+1]) of the sources and
+ * destinations arrays.
+ *
+ * \param block_offsets Start index of the connections of each block id
+ * \param sources Pointers to the source port values
+ * \param destinations Pointers to the buffered destination input values
+ *
+ * \sa RT::Connector::compileRoutingTable()
+ */
+typedef struct routing_table_t
+{
+  std::vector<size_t> block_offsets;
+  std::vector<const double*> sources;
+  std::vector<double*> destinations;
+} routing_table_t;
+
 /*!
  * Class that manages connections between blocks.
  *
@@ -217,6 +302,16 @@ typedef struct block_connection_t
  * responsible for moving outputs of blocks to their appropriate inputs during
  * runtime.
  *
+ * The connection registry is only modified outside of real-time. Changes reach
+ * the real-time loop through a routing table compiled by compileRoutingTable()
+ * and handed over with swapRoutingTable(). Only propagateBlockConnections()
+ * and swapRoutingTable() are meant to be called from the real-time thread.
+ *
+ * Threads are kept in topological order at all times. A new connection only
+ * reorders the threads ranked between its destination and its source, and
+ * the same search detects cycles, so inserting, pausing and disconnecting
+ * threads never rebuilds the whole order.
+ *
  * The connector plugin communicates with RT::System through events to query and
  * establish block connections.
  *
@@ -292,6 +387,9 @@ public:
   /*!
    * Unregister the block from the registry
    *
+   * All connections to and from the block are destroyed, and its slot is
+   * handed to the next inserted block.
+   *
    * \param block Pointer to block to unregister
    */
   void removeBlock(IO::Block* block);
@@ -324,6 +422,35 @@ public:
    */
   std::vector<RT::Thread*> getThreads();
 
+  /*!
+   * Group topologically sorted threads into dependency levels
+   *
+   * Threads belonging to the same level have no connections between each
+   * other and can therefore be executed concurrently. The given list is
+   * reordered in place so that every level is contiguous, while keeping
+   * the topological order between levels.
+   *
+   * \param threads Sorted list of active threads as returned by getThreads()
+   * \returns The start index of each level in threads, followed by the size
+   *          of threads
+   */
+  std::vector<size_t> getThreadLevels(std::vector<RT::Thread*>& threads);
+
+  /*!
+   * Assign execution phases to threads running at reduced rates
+   *
+   * Threads with a rate divisor greater than one are staggered across the
+   * periods of their cycle, so that slow threads do not all execute in the
+   * same period.
+   *
+   * \param threads List of active threads in execution order
+   * \returns The rate of each thread, in the same order as threads
+   *
+   * \sa RT::Thread::setRateDivisor()
+   */
+  std::vector<RT::thread_rate_t> getThreadRates(
+      const std::vector<RT::Thread*>& threads);
+
   /*!
    * Returns a list of output connections for the given block
    *
@@ -338,17 +465,43 @@ public:
    *
    * This function is used in the real-time loop to propagate values
    * from one block to another. It works by using the assigned index of
-   * the block to quickly access the block, then iterates through all
-   * connections of the block and copies output values to the input values
-   * of the next block.
+   * the block to find its range in the active routing table, then adds
+   * every source value to the buffered input of the destination.
    *
    * \param Pointer to block that is the source of the output.
+   *
+   * \sa RT::Connector::swapRoutingTable()
    */
   void propagateBlockConnections(IO::Block* block);
 
+  /*!
+   * Compile the current connections into a flat routing table
+   *
+   * This allocates memory and should only be called outside of real-time.
+   * The returned table does not take effect until it is passed to
+   * swapRoutingTable().
+   *
+   * \return A newly built RT::routing_table_t
+   */
+  std::unique_ptr<RT::routing_table_t> compileRoutingTable();
+
+  /*!
+   * Exchange the active routing table with the given one
+   *
+   * Safe to call in real-time as it only swaps pointers. After the call the
+   * argument holds the previously active table, which the caller should
+   * release outside of real-time.
+   *
+   * \param table The routing table to activate
+   */
+  void swapRoutingTable(std::unique_ptr<RT::routing_table_t>& table);
+
   /*!
    * Destroys all connections for a given block
    *
+   * Only the connection lists of the block and of the blocks it is
+   * connected to are visited.
+   *
    * \param block The IO::Block object pointer to remove connections from
    */
   void clearAllConnections(IO::Block* block);
@@ -372,30 +525,170 @@ public:
   std::vector<RT::block_connection_t> getAllConnections();
 
 private:
-  int find_cycle(RT::block_connection_t conn, IO::Block* ref_block);
+  static constexpr size_t INVALID_RANK = std::numeric_limits<size_t>::max();
+  int order_connection(const RT::block_connection_t& conn);
+  void compact_order();
   std::vector<RT::Thread*> topological_sort();
+  // slot map of registered blocks, indexed by block id. Slots of removed
+  // blocks are nullptr and listed in free_ids for reuse.
   std::vector<IO::Block*> block_registry;
+  std::vector<size_t> free_ids;
   std::vector<std::vector<RT::block_connection_t>> connections;
+  // connections ending at each block, indexed by destination id
+  std::vector<std::vector<RT::block_connection_t>> inbound;
+
+  // Threads in topological order, maintained incrementally on connect.
+  // topo_order may contain holes left by removed blocks.
+  std::vector<IO::Block*> topo_order;
+  std::vector<size_t> topo_rank;
+  std::vector<uint8_t> visit_marks;
+  size_t removed_ranks = 0;
+  std::unique_ptr<RT::routing_table_t> routing_table =
+      std::make_unique<RT::routing_table_t>();
 };  // class Connector
 
 /*!
- * Variant used internally by RT::System to receive commands and
- * updates
+ * Stages of the real-time loop measured by the block profiler
+ */
+enum profile_stage_t : int8_t
+{
+  PROFILE_READ = 0, /*!< RT::Device::read() */
+  PROFILE_EXECUTE, /*!< RT::Thread::execute() */
+  PROFILE_PROPAGATE, /*!< RT::Connector::propagateBlockConnections() */
+  PROFILE_WRITE, /*!< RT::Device::write() */
+};
+
+/*!
+ * Single measurement sent by the real-time loop to the block profiler
+ *
+ * \param block The block that was measured
+ * \param stage The stage of the real-time loop that was measured
+ * \param duration Time spent in the stage in nanoseconds
+ */
+typedef struct profile_sample_t
+{
+  IO::Block* block = nullptr;
+  profile_stage_t stage = PROFILE_EXECUTE;
+  int64_t duration = 0;
+} profile_sample_t;
+
+/*!
+ * Capacity of the fifo used by each real-time core to report measurements
+ */
+constexpr size_t PROFILE_FIFO_SIZE = 4096 * sizeof(profile_sample_t);
+
+/*!
+ * How often the profiler and overrun fifos are emptied. At 20 kHz with a
+ * handful of blocks this leaves room for several times the samples
+ * produced in between.
+ */
+constexpr std::chrono::milliseconds DRAIN_INTERVAL(1);
+
+/*!
+ * Number of recent measurements used to compute percentiles
+ */
+constexpr size_t PROFILE_RECENT_SAMPLES = 1000;
+
+/*!
+ * Cost of a block in one stage of the real-time loop
+ *
+ * Provided by RT::System in response to Event::Type::RT_PROFILER_QUERY_EVENT
+ * under the "profile" parameter as a std::vector<RT::block_profile_t>. Times
+ * are in nanoseconds and cover every sample since the profiler was started,
+ * except for p99 which is computed over the most recent samples. Samples
+ * lost because a profiler fifo was full are counted in the uint64_t
+ * "profile_dropped" parameter of the same event.
+ *
+ * \param block_name Name of the measured block
+ * \param stage The stage of the real-time loop that was measured
+ * \param count Number of samples
+ * \param mean Average duration
+ * \param p99 99th percentile of the recent durations
+ * \param max Longest duration
+ */
+typedef struct block_profile_t
+{
+  std::string block_name;
+  profile_stage_t stage = PROFILE_EXECUTE;
+  size_t count = 0;
+  double mean = 0.0;
+  int64_t p99 = 0;
+  int64_t max = 0;
+} block_profile_t;
+
+/*!
+ * A wakeup deadline missed by the real-time loop
+ *
+ * \param time Time, as given by RT::OS::getTime(), at which the late period
+ *             started
+ * \param skipped_periods Number of periods that were dropped because of it
+ */
+typedef struct overrun_t
+{
+  int64_t time = 0;
+  uint64_t skipped_periods = 0;
+} overrun_t;
+
+/*!
+ * Size of the fifo used to pass overruns out of the real-time thread
  */
-using command_param_t = std::variant<std::monostate,
-                                     int64_t,
-                                     int64_t*,
-                                     uint64_t,
-                                     double,
-                                     RT::Thread*,
-                                     std::vector<RT::Thread*>*,
-                                     RT::Device*,
-                                     std::vector<RT::Device*>*,
-                                     IO::Block*,
-                                     RT::block_connection_t,
-                                     Widgets::Component*,
-                                     State::state_t,
-                                     std::string>;
+constexpr size_t OVERRUN_FIFO_SIZE = 1024 * sizeof(overrun_t);
+
+/*!
+ * Number of recent overruns kept for RT::overrun_stats_t
+ */
+constexpr size_t OVERRUN_RECENT_COUNT = 100;
+
+/*!
+ * Deadline miss accounting of the real-time loop
+ *
+ * Provided by RT::System in response to Event::Type::RT_OVERRUN_QUERY_EVENT
+ * under the "overruns" parameter. Counts cover the whole lifetime of the
+ * system.
+ *
+ * \param overruns Number of periods that started after their deadline
+ * \param skipped_periods Number of periods that were not run at all
+ * \param dropped Number of overruns whose time was lost because the overrun
+ *                fifo was full. They are still part of the counts.
+ * \param recent The most recent overruns, oldest first
+ */
+typedef struct overrun_stats_t
+{
+  uint64_t overruns = 0;
+  uint64_t skipped_periods = 0;
+  uint64_t dropped = 0;
+  std::vector<overrun_t> recent;
+} overrun_stats_t;
+
+/*!
+ * Largest number of telemitry responses handled in one pass of the
+ * telemitry processor
+ */
+constexpr size_t TELEMITRY_BATCH_SIZE = 256;
+
+/*!
+ * Counters describing the telemitry processor
+ *
+ * Returned by RT::System::getTelemitryStats(). Counts cover the whole
+ * lifetime of the system.
+ *
+ * \param responses Number of telemitry responses processed
+ * \param drains Number of batches drained from the fifo
+ * \param wakeups Number of times the processor went to sleep waiting for
+ *                telemitry
+ * \param max_depth Largest number of responses found waiting in one drain
+ * \param max_drain_latency Longest time in nanoseconds between a response
+ *                          being posted and it being drained
+ */
+typedef struct telemitry_stats_t
+{
+  uint64_t responses = 0;
+  uint64_t drains = 0;
+  uint64_t wakeups = 0;
+  size_t max_depth = 0;
+  int64_t max_drain_latency = 0;
+} telemitry_stats_t;
+
 /*!
  * Manages the RTOS as well as all objects that require
  *   realtime execution.
@@ -409,11 +702,59 @@ using command_param_t = std::variant<std::monostate,
  * programmed to transform into commands it can understand internally. This
  * is designed to prevent use of non-realtime concurrency primitives that can
  * slow down the system.
+ *
+ * Threads are executed one dependency level at a time. When the system is
+ * given real-time workers, threads within the same level are distributed
+ * among the workers and the real-time thread, which then wait on each other
+ * in a spin barrier before propagating outputs. Workers spin for the whole
+ * lifetime of the system and are meant to be pinned to isolated cores.
+ *
+ * The system can also time every block in the real-time loop. Profiling is
+ * turned on and off with Event::Type::RT_PROFILER_START_EVENT and
+ * Event::Type::RT_PROFILER_STOP_EVENT. While it is active each measurement is
+ * pushed into a preallocated fifo. Summaries are returned when
+ * Event::Type::RT_PROFILER_QUERY_EVENT is received.
+ *
+ * Every missed wakeup deadline is counted, and the time of each overrun is
+ * sent out of the real-time thread through its own fifo so that command
+ * telemitry is not disturbed. Both are returned by
+ * Event::Type::RT_OVERRUN_QUERY_EVENT.
+ * Event::Type::RT_OVERRUN_POLICY_EVENT chooses whether missed periods are
+ * skipped or run back to back, see RT::OS::overrun_policy_t.
+ *
+ * A non real-time thread empties the profiler and overrun fifos every
+ * RT::DRAIN_INTERVAL for the whole lifetime of the system, so nothing is
+ * lost between queries.
+ *
+ * Event::Type::RT_COMMAND_BATCH_EVENT applies several events in a single
+ * period. Its "events" parameter holds a std::vector<Event::Object*> with
+ * the events to apply, in order. Period, widget parameter, widget state and
+ * IO link events are turned into commands that the real-time thread applies
+ * together, and all link changes share a single routing table rebuild. Any
+ * other event is handled right away, before the batch is submitted. When the
+ * optional "async" parameter is true the handler does not wait for the
+ * real-time thread and instead stores a
+ * std::shared_future<RT::Telemitry::response_t> in the "completion" parameter,
+ * which becomes ready with RT::Telemitry::RT_BATCH_UPDATE, or
+ * RT::Telemitry::RT_ERROR if any command in the batch failed. Other handlers
+ * only receive the batch, the events inside it are logged by Event::Manager
+ * but never routed on their own.
  */
 class System : public Event::Handler
 {
 public:
-  explicit System(Event::Manager* em, RT::Connector* rtc);
+  /*!
+   * Creates the real-time thread and its workers
+   *
+   * \param em Event manager to register the system with
+   * \param rtc Connector used to manage block connections
+   * \param worker_count Number of additional real-time threads used to
+   *                     execute independent threads in parallel. Zero keeps
+   *                     all execution on the real-time thread.
+   */
+  explicit System(Event::Manager* em,
+                  RT::Connector* rtc,
+                  size_t worker_count = 0);
   System(const System& system) = delete;  // copy constructor
   System& operator=(const System& system) = delete;  // copy assignment operator
   System(System&&) = delete;  // move constructor
@@ -430,10 +771,34 @@ public:
   /*!
    * Extracts telemitry from the system running in real-time
    *
+   * Sleeps until telemitry is available.
+   *
    * \return A vector of RT::Telemitry::Response structs
    */
   std::vector<RT::Telemitry::Response> getTelemitry();
 
+  /*!
+   * Moves the available telemitry into a buffer without sleeping
+   *
+   * The buffer is cleared and then filled up to its capacity, so a buffer
+   * reserved once is reused without further allocations. When the fifo
+   * exposes its storage all responses are copied out in one go.
+   *
+   * \param responses Buffer receiving the responses, oldest first
+   *
+   * \return Number of responses drained
+   */
+  size_t drainTelemitry(std::vector<RT::Telemitry::Response>& responses);
+
+  /*!
+   * Counters of the telemitry processor
+   *
+   * \return A copy of the current counters
+   *
+   * \sa RT::System::createTelemitryProcessor()
+   */
+  RT::telemitry_stats_t getTelemitryStats() const;
+
   /*!
    * Creates a worker thread that reads telemitry from real-time thread
    *
@@ -445,6 +810,10 @@ public:
    * this, any caller that sends events to the system class will block
    * indefinitely.
    *
+   * The processor only sleeps once the fifo is empty, so a burst of
+   * responses is handled in batches of up to RT::TELEMITRY_BATCH_SIZE with a
+   * single wakeup.
+   *
    * \sa RT::System::getTelemitry()
    */
   void createTelemitryProcessor();
@@ -464,25 +833,109 @@ public:
    */
   void receiveEvent(Event::Object* event) override;
 
+  std::vector<Event::Type> subscriptions() const override;
+
 private:
+  class CMD;
+
+  // Typed payloads of the commands sent to the real-time thread. The command
+  // type selects the payload, so the real-time thread reads fields directly.
+  // Pointers refer to memory owned by the non-realtime side of the command.
+  struct period_cmd_t
+  {
+    int64_t period = 0;
+  };
+  struct period_ticks_cmd_t
+  {
+    int64_t* ticks = nullptr;
+  };
+  struct device_list_cmd_t
+  {
+    std::vector<RT::Device*>* devices = nullptr;
+    RT::Device* device = nullptr;
+    std::unique_ptr<RT::routing_table_t>* routing_table = nullptr;
+  };
+  struct thread_list_cmd_t
+  {
+    std::vector<RT::Thread*>* threads = nullptr;
+    std::vector<size_t>* levels = nullptr;
+    std::vector<RT::thread_rate_t>* rates = nullptr;
+    RT::Thread* thread = nullptr;
+    std::unique_ptr<RT::routing_table_t>* routing_table = nullptr;
+  };
+  struct widget_parameter_cmd_t
+  {
+    Widgets::Component* component = nullptr;
+    size_t id = 0;
+    std::variant<std::monostate, double, int64_t, uint64_t> value;
+  };
+  struct widget_state_cmd_t
+  {
+    Widgets::Component* component = nullptr;
+    State::state_t state = State::UNDEFINED;
+  };
+  struct overrun_policy_cmd_t
+  {
+    RT::OS::overrun_policy_t policy;
+  };
+  struct batch_cmd_t
+  {
+    std::vector<CMD*>* commands = nullptr;
+  };
+  using cmd_payload_t = std::variant<std::monostate,
+                                     period_cmd_t,
+                                     period_ticks_cmd_t,
+                                     device_list_cmd_t,
+                                     thread_list_cmd_t,
+                                     widget_parameter_cmd_t,
+                                     widget_state_cmd_t,
+                                     overrun_policy_cmd_t,
+                                     batch_cmd_t>;
+
   // We want our cmd class to be private. the only way to access
   // RT::System functions is through its event handler.
   class CMD : public Event::Object
   {
   public:
-    explicit CMD(Event::Type et);
-    command_param_t getRTParam(const std::string_view& param_name);
-    void setRTParam(const std::string_view& param_name,
-                    const command_param_t& value);
+    explicit CMD(Event::Type et, cmd_payload_t cmd_payload = {});
 
-  private:
-    struct rt_param
+    template<typename T>
+    T& getPayload()
+    {
+      return std::get<T>(this->payload);
+    }
+
+    template<typename T>
+    void setPayload(T value)
+    {
+      this->payload = value;
+    }
+
+    // Keeps a value alive for as long as the command, so that pointer
+    // parameters stay valid after the function building the command returns
+    template<typename T>
+    T* own(T value)
     {
-      std::string_view name;
-      RT::command_param_t value;
-    };
-    std::vector<rt_param> rt_params;
+      auto holder = std::make_shared<T>(std::move(value));
+      owned_values.push_back(holder);
+      return holder.get();
+    }
+
+  private:
+    cmd_payload_t payload;
+    std::vector<std::shared_ptr<void>> owned_values;
+  };
+
+  // Commands outliving their handler are drawn from a preallocated pool, and
+  // only fall back to the heap when the pool runs dry
+  struct cmd_releaser_t
+  {
+    RT::System* system = nullptr;
+    size_t slot = 0;
+    void operator()(CMD* cmd) const;
   };
+  using pooled_cmd_t = std::unique_ptr<CMD, cmd_releaser_t>;
+  pooled_cmd_t acquireCMD(Event::Type type, cmd_payload_t cmd_payload = {});
 
   void insertDevice(Event::Object* event);
   void removeDevice(Event::Object* event);
@@ -502,6 +955,18 @@ private:
   void provideTimetickPointers(Event::Object* event);
   void changeWidgetParameters(Event::Object* event);
   void changeWidgetState(Event::Object* event);
+  void profilerChange(Event::Object* event);
+  void profilerQuery(Event::Object* event);
+  void overrunPolicyChange(Event::Object* event);
+  void overrunQuery(Event::Object* event);
+  void commandBatch(Event::Object* event);
+
+  // Convert events into commands. Shared by the single event handlers and
+  // command batches.
+  static void fillPeriodCMD(CMD* cmd, Event::Object* event);
+  static void fillWidgetParametersCMD(CMD* cmd, Event::Object* event);
+  static void fillWidgetStateCMD(CMD* cmd, Event::Object* event);
+  void fillIOLinkCMD(CMD* cmd);
 
   void executeCMD(CMD* cmd);
   void updateDeviceList(CMD* cmd);
@@ -513,11 +978,59 @@ private:
   void getPeriodTicksCMD(CMD* cmd);
   void changeWidgetParametersCMD(CMD* cmd);
   void changeWidgetStateCMD(CMD* cmd);
+  void profilerChangeCMD(CMD* cmd);
+  void overrunPolicyChangeCMD(CMD* cmd);
+  void commandBatchCMD(CMD* cmd);
 
   void postTelemitry(RT::Telemitry::Response telemitry);
 
+  // Commands executed inside a batch are acknowledged by the batch as a
+  // whole. Both flags are only touched by the real-time thread.
+  bool executing_batch = false;
+  bool batch_failed = false;
+
+  static constexpr size_t CMD_POOL_SIZE = 256;
+  std::mutex cmd_pool_mut;
+  std::vector<std::optional<CMD>> cmd_pool;
+  std::vector<size_t> free_cmds;
+
+  // Commands whose caller did not wait for them. They are released by the
+  // telemitry processor once the real-time thread is done with them.
+  struct async_cmd_t
+  {
+    pooled_cmd_t cmd;
+    std::promise<RT::Telemitry::response_t> completion;
+  };
+  std::shared_future<RT::Telemitry::response_t> trackAsync(pooled_cmd_t cmd);
+  bool releaseAsync(RT::Telemitry::Response telemitry);
+  std::mutex async_mut;
+  std::map<Event::Object*, async_cmd_t> pending_async;
+
   static void execute(void* sys);
 
+  // Multi-core execution of independent threads. dispatch_next and
+  // dispatch_pending are written by every worker each period, so they are
+  // kept away from the read-mostly generation counter.
+  struct worker_t
+  {
+    RT::System* system = nullptr;
+    std::unique_ptr<RT::OS::Task> task;
+    std::unique_ptr<RT::OS::Fifo> profile_fifo;
+    std::atomic<bool> ready = false;
+  };
+  void createWorkers(size_t worker_count);
+  void destroyWorkers();
+  void executeThreads(size_t begin, size_t end);
+  void runThread(size_t index, RT::OS::Fifo* profile_fifo);
+  void runDispatchedThreads(RT::OS::Fifo* profile_fifo);
+  static void worker_execute(void* arg);
+  std::vector<std::unique_ptr<worker_t>> workers;
+  alignas(64) std::atomic<uint64_t> dispatch_generation = 0;
+  size_t dispatch_end = 0;
+  std::atomic<int64_t> dispatch_period = 0;
+  alignas(64) std::atomic<size_t> dispatch_next = 0;
+  alignas(64) std::atomic<size_t> dispatch_pending = 0;
+
   int64_t periodStartTime = 1;
   int64_t periodEndTime = 1;
   int64_t lastperiodStartTime = 1;
@@ -527,15 +1040,75 @@ private:
   std::unique_ptr<RT::OS::Fifo> eventFifo;
   std::thread telemitry_processing_thread;
   std::atomic<bool> telemitry_processing_thread_running = true;
+  void recordTelemitryDrain(
+      const std::vector<RT::Telemitry::Response>& responses);
+  std::atomic<uint64_t> telemitry_responses = 0;
+  std::atomic<uint64_t> telemitry_drains = 0;
+  std::atomic<uint64_t> telemitry_wakeups = 0;
+  std::atomic<size_t> telemitry_max_depth = 0;
+  std::atomic<int64_t> telemitry_max_latency = 0;
 
   // system doesn't own any of the below variables. That's why they are
   // only pointers.
   Event::Manager* event_manager;
   RT::Connector* rt_connector;
 
+  // Event handlers run on several workers at once. Handlers hold this lock
+  // while they use rt_connector and until the real-time thread has the
+  // resulting command, so block lists and tables arrive in order.
+  std::mutex connector_mut;
+
   // System's real-time loop maintains copy of device and thread pointers
   std::vector<RT::Device*> devices;
   std::vector<RT::Thread*> threads;
+  // start index of each dependency level in threads, followed by its size
+  std::vector<size_t> thread_levels;
+  std::vector<RT::thread_rate_t> thread_rates;
+  uint64_t tick = 0;
+
+  // Block profiler. The flag is only written by the real-time thread, and
+  // every core running blocks has its own fifo.
+  template<typename Callable>
+  void profile(RT::OS::Fifo* fifo,
+               IO::Block* block,
+               RT::profile_stage_t stage,
+               const Callable& stage_function);
+  void drainProfileFifo(RT::OS::Fifo* fifo);
+  void drainProfileFifos();
+  void resetProfile();
+  void forgetProfile(IO::Block* block);
+  struct profile_accumulator_t
+  {
+    size_t count = 0;
+    double total = 0.0;
+    int64_t max = 0;
+    std::vector<int64_t> recent;
+    size_t next_recent = 0;
+  };
+  bool profiling = false;
+  std::atomic<uint64_t> profile_dropped = 0;
+  std::unique_ptr<RT::OS::Fifo> profileFifo;
+  std::mutex profile_mut;
+  std::map<std::pair<IO::Block*, RT::profile_stage_t>, profile_accumulator_t>
+      profile_stats;
+
+  // Overrun accounting. Counters live in the task, while the time of each
+  // overrun is passed through a fifo and kept in a ring outside real-time.
+  void reportOverrun(int64_t time, uint64_t skipped_periods);
+  void drainOverrunFifo();
+  std::atomic<uint64_t> overrun_dropped = 0;
+  std::unique_ptr<RT::OS::Fifo> overrunFifo;
+  std::mutex overrun_mut;
+  std::vector<RT::overrun_t> recent_overruns;
+  size_t next_overrun = 0;
+
+  // Empties the profiler and overrun fifos. The drain thread runs while it
+  // is the one stored here, and waits on drain_cond under profile_mut.
+  void startDrain();
+  void stopDrain();
+  void drainLoop();
+  std::thread drain_thread;
+  std::condition_variable drain_cond;
 };  // class System
 }  // namespace RT
 #endif  // RT_H
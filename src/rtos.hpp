@@ -2,6 +2,7 @@
 #define RTOS_H
 
 #include <any>
+#include <atomic>
 #include <thread>
 
 #include <string.h>
@@ -14,6 +15,19 @@ const int64_t SECONDS_TO_NANOSECONDS =
 const int64_t DEFAULT_PERIOD = 1000000;  // Default period is set to 1 msec
 const uint64_t DEFAULT_FIFO_SIZE = 255;  // Default Fifo size of 255 bytes
 const size_t PROCESSOR_COUNT = std::thread::hardware_concurrency();
+// Most missed periods the catch up policy runs back to back after a stall
+const int64_t MAX_CATCH_UP_PERIODS = 10;
+
+/*!
+ * What the real-time loop does after missing a wakeup deadline
+ */
+enum overrun_policy_t : int8_t
+{
+  OVERRUN_SKIP, /*!< Drop the missed periods and stay on the period grid */
+  OVERRUN_CATCH_UP /*!< Run missed periods back to back, dropping all but
+                      the last MAX_CATCH_UP_PERIODS of them */
+};
+
 /*!
  * Object representation of a real-time loop
  *
@@ -21,12 +35,24 @@ const size_t PROCESSOR_COUNT = std::thread::hardware_concurrency();
  * \param next_t Next wakeup time in absolute clock time (nanoseconds).
  * \param task_finished Bool field used by real-time loop to signal end.
  * \param rt_thread a std::thread object representing the rt loop.
+ * \param cpu Processor the task is pinned to, or -1 to leave it unpinned.
+ *            Must be set before calling RT::OS::createTask().
+ * \param overrun_policy How RT::OS::sleepTimestep() recovers from an overrun.
+ * \param overruns Number of times the loop woke up after its deadline.
+ *                 Only written by the real-time thread.
+ * \param skipped_periods Number of periods dropped by the skip policy, or
+ *                        beyond the catch up limit. Only written by the
+ *                        real-time thread.
  */
 struct Task
 {
   int64_t period = DEFAULT_PERIOD;
   int64_t next_t = 0;
-  bool task_finished = false;
+  std::atomic<bool> task_finished = false;
+  int cpu = -1;
+  overrun_policy_t overrun_policy = OVERRUN_SKIP;
+  std::atomic<uint64_t> overruns = 0;
+  std::atomic<uint64_t> skipped_periods = 0;
   std::thread rt_thread;
   std::any thread_id;
 };
@@ -92,12 +118,60 @@ int64_t getPeriod();
  * Uses real-time core to sleep until the next periodic wakeup.
  * It uses the timestep given in task to determine next waekup.
  *
+ * If the wakeup time has already passed the function returns immediately
+ * and the overrun is counted in the task. The next wakeup is then chosen
+ * according to the task overrun policy.
+ *
  * \param task Object holding the timestep data for the task
  *
  * \sa RT::OS::setPeriod()
+ * \sa RT::OS::handleOverrun()
  */
 void sleepTimestep(Task* task);
 
+/*!
+ * Checks whether the task missed its wakeup deadline and, if so, counts the
+ * overrun and moves the next wakeup according to the overrun policy. Shared
+ * by every RT::OS::sleepTimestep() implementation.
+ *
+ * \param task Object holding the timestep data for the task
+ * \param current_time The current time in the clock used by the task
+ *
+ * \return true if the deadline was missed, false otherwise
+ */
+inline bool handleOverrun(Task* task, int64_t current_time)
+{
+  if (task->next_t >= current_time) {
+    return false;
+  }
+  task->overruns.store(task->overruns.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+  if (task->overrun_policy == OVERRUN_CATCH_UP) {
+    // A long stall would otherwise be followed by thousands of periods run
+    // back to back, only the most recent ones are made up
+    const int64_t behind = (current_time - task->next_t) / task->period;
+    if (behind > MAX_CATCH_UP_PERIODS) {
+      const int64_t dropped = behind - MAX_CATCH_UP_PERIODS;
+      task->skipped_periods.store(
+          task->skipped_periods.load(std::memory_order_relaxed)
+              + static_cast<uint64_t>(dropped),
+          std::memory_order_relaxed);
+      task->next_t += dropped * task->period;
+    }
+    task->next_t += task->period;
+    return true;
+  }
+  // The late period runs now, and every later deadline that already passed
+  // is dropped so that wakeups stay in phase with the original schedule
+  const int64_t missed = (current_time - task->next_t) / task->period + 1;
+  task->skipped_periods.store(
+      task->skipped_periods.load(std::memory_order_relaxed)
+          + static_cast<uint64_t>(missed - 1),
+      std::memory_order_relaxed);
+  task->next_t += missed * task->period;
+  return true;
+}
+
 /*!
  * CHecks whether the calling thread is in real time. Important
  * for functions that should not have access to real-time
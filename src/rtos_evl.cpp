@@ -54,7 +54,8 @@ int RT::OS::initiate(RT::OS::Task* task)
     return retval;
   }
 
-  int thread_fd = evl_attach_self("RTXI-RT-Thread:%d", getpid());  // NOLINT
+  // Element names must be unique, and there may be several real-time tasks
+  int thread_fd = evl_attach_self("RTXI-RT-Thread:%d", gettid());  // NOLINT
   if (thread_fd < 0) {
     strerror_r(errno, strbuf.data(), strbuf.size());
     ERROR_MSG("RT::OS(EVL)::initiate : evl_attach_self() : {}", strbuf);
@@ -91,6 +92,18 @@ int RT::OS::createTask(Task* task, void (*func)(void*), void* arg)
   auto wrapper = [](RT::OS::Task* tsk, void (*fn)(void*), void* args)
   {
     std::string strbuf(256, '\0');
+    // affinity has to be set before attaching to the evl core
+    if (tsk->cpu >= 0) {
+      cpu_set_t cpuset;
+      CPU_ZERO(&cpuset);
+      CPU_SET(static_cast<size_t>(tsk->cpu), &cpuset);
+      if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset)
+          != 0)
+      {
+        ERROR_MSG("RT::OS::createTask : unable to pin task to cpu {}",
+                  tsk->cpu);
+      }
+    }
     auto resval = RT::OS::initiate(tsk);
     if (resval != 0) {
       strerror_r(errno, strbuf.data(), strbuf.size());
@@ -155,9 +168,7 @@ int64_t RT::OS::getPeriod()
 
 void RT::OS::sleepTimestep(RT::OS::Task* task)
 {
-  const int64_t current_time = RT::OS::getTime();
-  if (task->next_t < current_time) {
-    task->next_t = current_time + task->period;
+  if (RT::OS::handleOverrun(task, RT::OS::getTime())) {
     return;
   }
   int64_t wakeup_time = task->next_t;
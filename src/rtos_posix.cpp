@@ -82,6 +82,17 @@ int RT::OS::createTask(Task* task, void (*func)(void*), void* arg)
   auto wrapper = [](RT::OS::Task* tsk, void (*fn)(void*), void* args)
   {
     std::string strbuf(256, '\0');
+    if (tsk->cpu >= 0) {
+      cpu_set_t cpuset;
+      CPU_ZERO(&cpuset);
+      CPU_SET(static_cast<size_t>(tsk->cpu), &cpuset);
+      if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset)
+          != 0)
+      {
+        ERROR_MSG("RT::OS::createTask : unable to pin task to cpu {}",
+                  tsk->cpu);
+      }
+    }
     auto resval = RT::OS::initiate(tsk);
     strerror_r(errno, strbuf.data(), strbuf.size());
     if (resval != 0) {
@@ -140,9 +151,7 @@ int64_t RT::OS::getPeriod()
 
 void RT::OS::sleepTimestep(RT::OS::Task* task)
 {
-  const int64_t current_time = RT::OS::getTime();
-  if (task->next_t < current_time) {
-    task->next_t = current_time + task->period;
+  if (RT::OS::handleOverrun(task, RT::OS::getTime())) {
     return;
   }
   const int64_t wakeup_time = task->next_t;
@@ -68,7 +68,10 @@ int RT::OS::createTask(RT::OS::Task* task, void (*func)(void*), void* arg)
 
   // Tell Xenomai to report mode issues
   rt_task_set_mode(0, T_WARNSW, nullptr);
-  retval = rt_task_create(&xenomai_task, "Real-Time Task", 0, 50, 0);
+  // Alchemy registers tasks by name, so let it pick one for pinned workers
+  const char* name = task->cpu >= 0 ? nullptr : "Real-Time Task";
+  const int mode = task->cpu >= 0 ? T_CPU(task->cpu) : 0;
+  retval = rt_task_create(&xenomai_task, name, 0, 50, mode);
   if (retval != 0) {
     ERROR_MSG("RT::OS::createTask : failed to create task\n");
     return retval;
@@ -147,6 +150,9 @@ int64_t RT::OS::getPeriod()
 
 void RT::OS::sleepTimestep(RT::OS::Task* task)
 {
+  if (RT::OS::handleOverrun(task, RT::OS::getTime())) {
+    return;
+  }
   auto wakeup_time = static_cast<SRTIME>(task->next_t);
   task->next_t += task->period;
   rt_task_sleep_until(rt_timer_ns2ticks(wakeup_time));
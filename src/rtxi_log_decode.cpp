@@ -0,0 +1,79 @@
+/*
+         The Real-Time eXperiment Interface (RTXI)
+         Copyright (C) 2011 Georgia Institute of Technology, University of Utah,
+   Will Cornell Medical College
+
+         This program is free software: you can redistribute it and/or modify
+         it under the terms of the GNU General Public License as published by
+         the Free Software Foundation, either version 3 of the License, or
+         (at your option) any later version.
+
+         This program is distributed in the hope that it will be useful,
+         but WITHOUT ANY WARRANTY; without even the implied warranty of
+         MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+         GNU General Public License for more details.
+
+         You should have received a copy of the GNU General Public License
+         along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+ * Prints binary RTXI event logs as text. With no arguments it decodes the
+ * most recently written default log file; otherwise each file given is
+ * decoded in order, so rotated logs can be passed oldest first.
+ */
+
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "debug.hpp"
+#include "logger.hpp"
+
+namespace
+{
+// Every instance logs to its own events-<pid>.log, pick the newest one
+std::filesystem::path latest_default_logfile()
+{
+  std::filesystem::path latest;
+  std::filesystem::file_time_type latest_time;
+  std::error_code ec;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(eventLogger::default_logdir(), ec))
+  {
+    const std::string name = entry.path().filename().string();
+    if (name.rfind("events-", 0) != 0 || entry.path().extension() != ".log") {
+      continue;
+    }
+    const auto write_time = entry.last_write_time(ec);
+    if (!ec && (latest.empty() || write_time > latest_time)) {
+      latest = entry.path();
+      latest_time = write_time;
+    }
+  }
+  return latest.empty() ? eventLogger::default_logfile() : latest;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+  std::vector<std::filesystem::path> logfiles(argv + 1, argv + argc);
+  if (logfiles.empty()) {
+    logfiles.push_back(latest_default_logfile());
+  }
+  int result = 0;
+  for (const auto& logfile : logfiles) {
+    std::ifstream input(logfile, std::ios::binary);
+    if (!input) {
+      ERROR_MSG("rtxi_log_decode : unable to open {}", logfile.string());
+      result = -1;
+      continue;
+    }
+    if (eventLogger::decode(input, std::cout) != 0) {
+      ERROR_MSG("rtxi_log_decode : skipping {}", logfile.string());
+      result = -1;
+    }
+  }
+  return result;
+}
@@ -8,6 +8,8 @@
 #include <QMainWindow>
 #include <QMdiArea>
 #include <QMdiSubWindow>
+#include <QMetaObject>
+#include <QPointer>
 #include <QPushButton>
 #include <QScrollArea>
 #include <QSettings>
@@ -476,7 +478,7 @@ void Widgets::Panel::setParameter(const QString& var_name, double value)
   {
     n->second.edit->setText(QString::number(value));
     auto param_id = static_cast<Widgets::Variable::Id>(n->second.info.id);
-    this->hostPlugin->setComponentParameter<double>(param_id, value);
+    this->hostPlugin->setComponentParameterAsync<double>(param_id, value);
   }
 }
 
@@ -488,7 +490,7 @@ void Widgets::Panel::setParameter(const QString& var_name, int64_t value)
   {
     n->second.edit->setText(QString::number(value));
     auto param_id = static_cast<Widgets::Variable::Id>(n->second.info.id);
-    this->hostPlugin->setComponentParameter<int64_t>(param_id, value);
+    this->hostPlugin->setComponentParameterAsync<int64_t>(param_id, value);
   }
 }
 
@@ -500,7 +502,7 @@ void Widgets::Panel::setParameter(const QString& var_name, uint64_t value)
   {
     n->second.edit->setText(QString::number(value));
     auto param_id = static_cast<Widgets::Variable::Id>(n->second.info.id);
-    this->hostPlugin->setComponentParameter<uint64_t>(param_id, value);
+    this->hostPlugin->setComponentParameterAsync<uint64_t>(param_id, value);
   }
 }
 
@@ -525,6 +527,10 @@ Widgets::Plugin::Plugin(Event::Manager* ev_manager, std::string mod_name)
 
 Widgets::Plugin::~Plugin()
 {
+  if (this->posted_async) {
+    // pending changes still point to the component
+    this->event_manager->flushAsync();
+  }
   if (this->plugin_component != nullptr) {
     Event::Object unplug_block_event(Event::Type::RT_THREAD_REMOVE_EVENT);
     unplug_block_event.setParam(
@@ -551,10 +557,8 @@ void Widgets::Plugin::setComponentState(RT::State::state_t state)
     return;
   }
   Event::Object event(Event::Type::RT_WIDGET_STATE_CHANGE_EVENT);
-  event.setParam(
-      "component",
-      std::any(static_cast<Widgets::Component*>(this->plugin_component.get())));
-  event.setParam("state", std::any(state));
+  event.setPayload(
+      Event::widget_state_payload_t {this->plugin_component.get(), state});
   this->event_manager->postEvent(&event);
 }
 
@@ -635,6 +639,35 @@ void Widgets::Plugin::receiveEvent(Event::Object* event)
   }
 }
 
+void Widgets::Plugin::postParameterChangeAsync(
+    const Event::widget_parameter_payload_t& payload,
+    std::function<void()> on_done)
+{
+  auto event = this->event_manager->acquireEvent(
+      Event::Type::RT_WIDGET_PARAMETER_CHANGE_EVENT);
+  event->setPayload(payload);
+  this->posted_async = true;
+  if (!on_done) {
+    this->event_manager->postEventAsync(std::move(event));
+    return;
+  }
+  // The callback runs in the event manager thread, so it is handed over to
+  // the Qt event loop that owns the panel
+  QPointer<QObject> context = this->widget_panel;
+  if (context.isNull()) {
+    context = QCoreApplication::instance();
+  }
+  this->event_manager->postEventAsync(
+      std::move(event),
+      [context, on_done = std::move(on_done)](Event::Object* /*event*/)
+      {
+        if (!context.isNull()) {
+          QMetaObject::invokeMethod(
+              context.data(), on_done, Qt::QueuedConnection);
+        }
+      });
+}
+
 bool Widgets::Plugin::getActive()
 {
   bool active = false;
@@ -2,9 +2,11 @@
 #define WIDGET_HPP
 
 #include <QLineEdit>
+#include <functional>
 #include <limits>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <variant>
 #include <vector>
@@ -372,6 +374,7 @@ public slots:
 protected:
   /*!
    * Set the value of double parameter within the Workspace and GUI.
+   * The change is sent to the realtime system without waiting for it.
    *
    * \param name The name of the parameter.
    * \param ref A reference to the parameter.
@@ -381,6 +384,7 @@ protected:
 
   /*!
    * Set the value of unsigned int parameter within the Workspace and GUI.
+   * The change is sent to the realtime system without waiting for it.
    *
    * \param name The name of the parameter.
    * \param ref A reference to the parameter.
@@ -390,6 +394,7 @@ protected:
 
   /*!
    * Set the value of int parameter within the Workspace and GUI.
+   * The change is sent to the realtime system without waiting for it.
    *
    * \param name The name of the parameter.
    * \param ref A reference to the parameter.
@@ -565,32 +570,42 @@ public:
   template<typename T>
   int setComponentParameter(const Variable::Id& parameter_id, T value)
   {
-    if (this->plugin_component == nullptr) {
-      return -1;
-    }
-    const int result = 0;
-    Widgets::Variable::variable_t param_type = Widgets::Variable::UNKNOWN;
-    if (typeid(T) == typeid(int64_t)) {
-      param_type = Widgets::Variable::INT_PARAMETER;
-    } else if (typeid(T) == typeid(double)) {
-      param_type = Widgets::Variable::DOUBLE_PARAMETER;
-    } else if (typeid(T) == typeid(uint64_t)) {
-      param_type = Widgets::Variable::UINT_PARAMETER;
-    } else if (typeid(T) == typeid(std::string)) {
-      param_type = Widgets::Variable::COMMENT;
-    } else {
-      ERROR_MSG(
-          "Widgets::Plugin::setComponentParameter : Parameter type not "
-          "supported");
+    Event::widget_parameter_payload_t payload;
+    if (this->makeParameterPayload(parameter_id, value, payload) != 0) {
       return -1;
     }
     Event::Object event(Event::Type::RT_WIDGET_PARAMETER_CHANGE_EVENT);
-    event.setParam("paramID", std::any(parameter_id));
-    event.setParam("paramType", std::any(param_type));
-    event.setParam("paramValue", std::any(value));
-    event.setParam("paramWidget", std::any(this->plugin_component.get()));
+    event.setPayload(payload);
     this->event_manager->postEvent(&event);
-    return result;
+    return 0;
+  }
+
+  /*!
+   * Sets the component parameter without waiting for the realtime system
+   *
+   * Same as setComponentParameter(), but the call returns as soon as the
+   * event is queued. Changes made this way are applied in the order they
+   * were requested.
+   *
+   * \param parameter_id The id of the widget's parameter to change
+   * \param value The new value to change the parameter to
+   * \param on_done Optional function called from the Qt event loop once the
+   *                change has been applied. It is dropped if the panel is
+   *                closed first.
+   * \return an error code 0 for success, and -1 for failure (no attached
+   *         component)
+   */
+  template<typename T>
+  int setComponentParameterAsync(const Variable::Id& parameter_id,
+                                 T value,
+                                 std::function<void()> on_done = nullptr)
+  {
+    Event::widget_parameter_payload_t payload;
+    if (this->makeParameterPayload(parameter_id, value, payload) != 0) {
+      return -1;
+    }
+    this->postParameterChangeAsync(payload, std::move(on_done));
+    return 0;
   }
 
   /*!
@@ -728,6 +743,44 @@ protected:
   Widgets::Panel* getPanel();
 
 private:
+  template<typename T>
+  int makeParameterPayload(const Variable::Id& parameter_id,
+                           T value,
+                           Event::widget_parameter_payload_t& payload)
+  {
+    if (this->plugin_component == nullptr) {
+      return -1;
+    }
+    Widgets::Variable::variable_t param_type = Widgets::Variable::UNKNOWN;
+    if (typeid(T) == typeid(int64_t)) {
+      param_type = Widgets::Variable::INT_PARAMETER;
+    } else if (typeid(T) == typeid(double)) {
+      param_type = Widgets::Variable::DOUBLE_PARAMETER;
+    } else if (typeid(T) == typeid(uint64_t)) {
+      param_type = Widgets::Variable::UINT_PARAMETER;
+    } else if (typeid(T) == typeid(std::string)) {
+      param_type = Widgets::Variable::COMMENT;
+    } else {
+      ERROR_MSG(
+          "Widgets::Plugin::setComponentParameter : Parameter type not "
+          "supported");
+      return -1;
+    }
+    payload.component = this->plugin_component.get();
+    payload.id = parameter_id;
+    payload.type = param_type;
+    // Unsupported types were rejected above, but must still compile
+    if constexpr (std::is_assignable_v<decltype(payload.value)&, T>) {
+      payload.value = value;
+    }
+    return 0;
+  }
+
+  void postParameterChangeAsync(
+      const Event::widget_parameter_payload_t& payload,
+      std::function<void()> on_done);
+  bool posted_async = false;
+
   // owned pointers
   std::unique_ptr<Widgets::Component> plugin_component;
 
@@ -373,6 +373,14 @@ void Workspace::Manager::unregisterFactories(const std::string& widget_name)
   }
 }
 
+std::vector<Event::Type> Workspace::Manager::subscriptions() const
+{
+  return {Event::Type::PLUGIN_INSERT_EVENT,
+          Event::Type::PLUGIN_REMOVE_EVENT,
+          Event::Type::DAQ_DEVICE_QUERY_EVENT,
+          Event::Type::PLUGIN_LIST_QUERY_EVENT};
+}
+
 void Workspace::Manager::receiveEvent(Event::Object* event)
 {
   std::string plugin_name;
@@ -90,6 +90,8 @@ public:
    */
   void receiveEvent(Event::Object* event) override;
 
+  std::vector<Event::Type> subscriptions() const override;
+
   /*!
    * Checks whether plugin is registered.
    *
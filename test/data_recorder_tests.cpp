@@ -0,0 +1,373 @@
+/*
+         The Real-Time eXperiment Interface (RTXI)
+         Copyright (C) 2011 Georgia Institute of Technology, University of Utah,
+   Will Cornell Medical College
+
+         This program is free software: you can redistribute it and/or modify
+         it under the terms of the GNU General Public License as published by
+         the Free Software Foundation, either version 3 of the License, or
+         (at your option) any later version.
+
+         This program is distributed in the hope that it will be useful,
+         but WITHOUT ANY WARRANTY; without even the implied warranty of
+         MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+         GNU General Public License for more details.
+
+         You should have received a copy of the GNU General Public License
+         along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "data_recorder_tests.hpp"
+
+ChunkPipelineTest::ChunkPipelineTest()
+{
+  const hid_t access = H5Pcreate(H5P_FILE_ACCESS);
+  H5Pset_fapl_core(access, 1 << 20, /*backing_store=*/0);
+  this->file = H5Fcreate(
+      "chunk_pipeline_test.h5", H5F_ACC_TRUNC, H5P_DEFAULT, access);
+  H5Pclose(access);
+}
+
+ChunkPipelineTest::~ChunkPipelineTest()
+{
+  if (this->file != H5I_INVALID_HID) {
+    H5Fclose(this->file);
+  }
+}
+
+hid_t ChunkPipelineTest::create_dataset(
+    const char* name,
+    hid_t file_type,
+    hsize_t channel_count,
+    hsize_t chunk_frames,
+    const DataRecorder::chunk_filter_t& filter)
+{
+  const int rank = channel_count == 0 ? 1 : 2;
+  const std::array<hsize_t, 2> dims = {0, channel_count};
+  const std::array<hsize_t, 2> max_dims = {H5S_UNLIMITED, channel_count};
+  const std::array<hsize_t, 2> chunk_dims = {chunk_frames, channel_count};
+  const hid_t space = H5Screate_simple(rank, dims.data(), max_dims.data());
+  const hid_t properties = H5Pcreate(H5P_DATASET_CREATE);
+  H5Pset_chunk(properties, rank, chunk_dims.data());
+  if (filter.shuffle) {
+    H5Pset_shuffle(properties);
+  }
+  if (filter.deflate_level >= 0) {
+    H5Pset_deflate(properties, static_cast<unsigned>(filter.deflate_level));
+  }
+  const hid_t dataset = H5Dcreate(this->file,
+                                  name,
+                                  file_type,
+                                  space,
+                                  H5P_DEFAULT,
+                                  properties,
+                                  H5P_DEFAULT);
+  H5Pclose(properties);
+  H5Sclose(space);
+  return dataset;
+}
+
+TEST_F(ChunkPipelineTest, shuffleMatchesHDF5)
+{
+  const hsize_t chunk_frames = 32;
+  DataRecorder::chunk_filter_t filter;
+  filter.shuffle = true;
+  const hid_t dataset =
+      this->create_dataset("Shuffled", H5T_IEEE_F64LE, 0, chunk_frames, filter);
+  ASSERT_NE(dataset, H5I_INVALID_HID);
+
+  std::vector<double> values(chunk_frames);
+  for (size_t i = 0; i < values.size(); i++) {
+    values[i] = 1.0 / static_cast<double>(i + 3) - static_cast<double>(i);
+  }
+  const std::array<hsize_t, 1> extent = {chunk_frames};
+  ASSERT_GE(H5Dset_extent(dataset, extent.data()), 0);
+  ASSERT_GE(H5Dwrite(dataset,
+                     H5T_NATIVE_DOUBLE,
+                     H5S_ALL,
+                     H5S_ALL,
+                     H5P_DEFAULT,
+                     values.data()),
+            0);
+  ASSERT_GE(H5Fflush(dataset, H5F_SCOPE_LOCAL), 0);
+
+  // The chunk as stored by HDF5, after its own shuffle filter
+  const std::array<hsize_t, 1> offset = {0};
+  hsize_t stored_size = 0;
+  ASSERT_GE(H5Dget_chunk_storage_size(dataset, offset.data(), &stored_size),
+            0);
+  std::vector<char> stored(stored_size);
+  uint32_t filter_mask = 0;
+  ASSERT_GE(
+      H5Dread_chunk(
+          dataset, H5P_DEFAULT, offset.data(), &filter_mask, stored.data()),
+      0);
+
+  std::vector<char> raw(values.size() * sizeof(double));
+  std::memcpy(raw.data(), values.data(), raw.size());
+  std::vector<char> scratch;
+  std::vector<char> packed;
+  ASSERT_EQ(DataRecorder::ChunkPipeline::encode(
+                raw, sizeof(double), filter, scratch, packed),
+            0);
+  EXPECT_EQ(packed, stored);
+  H5Dclose(dataset);
+}
+
+TEST_F(ChunkPipelineTest, deflateRoundTrip)
+{
+  if (!DataRecorder::ChunkPipeline::supported()) {
+    GTEST_SKIP() << "direct chunk writes need little endian native types";
+  }
+  const hsize_t channel_count = 3;
+  const hsize_t chunk_frames = 16;
+  DataRecorder::chunk_filter_t filter;
+  filter.shuffle = true;
+  filter.deflate_level = 4;
+  const hid_t data = this->create_dataset(
+      "Data", H5T_IEEE_F64LE, channel_count, chunk_frames, filter);
+  const hid_t time =
+      this->create_dataset("Time", H5T_STD_I64LE, 0, chunk_frames, filter);
+  ASSERT_NE(data, H5I_INVALID_HID);
+  ASSERT_NE(time, H5I_INVALID_HID);
+
+  // Enough full chunks to keep several workers busy at once, plus a
+  // partial last chunk
+  const size_t frame_count = (chunk_frames * 23) + 5;
+  const size_t frame_size = sizeof(int64_t) + (channel_count * sizeof(double));
+  std::vector<char> frames(frame_count * frame_size);
+  for (size_t frame = 0; frame < frame_count; frame++) {
+    char* position = frames.data() + (frame * frame_size);
+    const auto timestamp = static_cast<int64_t>(frame * 1000);
+    std::memcpy(position, &timestamp, sizeof(int64_t));
+    for (size_t channel = 0; channel < channel_count; channel++) {
+      const double value =
+          static_cast<double>(frame) + (0.25 * static_cast<double>(channel));
+      std::memcpy(position + sizeof(int64_t) + (channel * sizeof(double)),
+                  &value,
+                  sizeof(double));
+    }
+  }
+
+  DataRecorder::ChunkPipeline pipeline(/*worker_count=*/3);
+  ASSERT_EQ(pipeline.open(data, time, channel_count, chunk_frames, filter), 0);
+  // Batches that do not line up with chunk boundaries
+  size_t appended = 0;
+  size_t batch = 1;
+  while (appended < frame_count) {
+    batch = std::min(batch, frame_count - appended);
+    ASSERT_EQ(
+        pipeline.append(frames.data() + (appended * frame_size), batch), 0);
+    appended += batch;
+    batch = (batch * 3) % 41 + 1;
+  }
+  ASSERT_EQ(pipeline.close(), 0);
+
+  std::array<hsize_t, 2> dims = {0, 0};
+  const hid_t data_space = H5Dget_space(data);
+  H5Sget_simple_extent_dims(data_space, dims.data(), nullptr);
+  H5Sclose(data_space);
+  ASSERT_EQ(dims[0], frame_count);
+  ASSERT_EQ(dims[1], channel_count);
+
+  std::vector<double> values(frame_count * channel_count);
+  std::vector<int64_t> times(frame_count);
+  ASSERT_GE(H5Dread(data,
+                    H5T_NATIVE_DOUBLE,
+                    H5S_ALL,
+                    H5S_ALL,
+                    H5P_DEFAULT,
+                    values.data()),
+            0);
+  ASSERT_GE(
+      H5Dread(
+          time, H5T_NATIVE_INT64, H5S_ALL, H5S_ALL, H5P_DEFAULT, times.data()),
+      0);
+  for (size_t frame = 0; frame < frame_count; frame++) {
+    ASSERT_EQ(times[frame], static_cast<int64_t>(frame * 1000));
+    for (size_t channel = 0; channel < channel_count; channel++) {
+      ASSERT_EQ(values[(frame * channel_count) + channel],
+                static_cast<double>(frame)
+                    + (0.25 * static_cast<double>(channel)))
+          << "frame " << frame << " channel " << channel;
+    }
+  }
+  H5Dclose(time);
+  H5Dclose(data);
+}
+
+std::vector<char> DownsamplerTest::make_frames(
+    const std::vector<int64_t>& times, const std::vector<double>& values)
+{
+  const size_t channel_count = values.size() / times.size();
+  const size_t frame_size = sizeof(int64_t) + (channel_count * sizeof(double));
+  std::vector<char> frames(times.size() * frame_size);
+  for (size_t frame = 0; frame < times.size(); frame++) {
+    char* position = frames.data() + (frame * frame_size);
+    std::memcpy(position, &times[frame], sizeof(int64_t));
+    std::memcpy(position + sizeof(int64_t),
+                values.data() + (frame * channel_count),
+                channel_count * sizeof(double));
+  }
+  return frames;
+}
+
+void DownsamplerTest::split_frames(const std::vector<char>& frames,
+                                   size_t channel_count,
+                                   std::vector<int64_t>& times,
+                                   std::vector<double>& values)
+{
+  const size_t frame_size = sizeof(int64_t) + (channel_count * sizeof(double));
+  const size_t frame_count = frames.size() / frame_size;
+  times.resize(frame_count);
+  values.resize(frame_count * channel_count);
+  for (size_t frame = 0; frame < frame_count; frame++) {
+    const char* position = frames.data() + (frame * frame_size);
+    std::memcpy(&times[frame], position, sizeof(int64_t));
+    std::memcpy(values.data() + (frame * channel_count),
+                position + sizeof(int64_t),
+                channel_count * sizeof(double));
+  }
+}
+
+TEST_F(DownsamplerTest, configureRejectsFactor)
+{
+  DataRecorder::Downsampler downsampler;
+  EXPECT_EQ(downsampler.configure(DataRecorder::DECIMATE, 0, 1), -1);
+  EXPECT_EQ(downsampler.configure(DataRecorder::DECIMATE,
+                                  DataRecorder::MAX_DOWNSAMPLE_FACTOR + 1,
+                                  1),
+            -1);
+  EXPECT_EQ(downsampler.configure(DataRecorder::DOWNSAMPLE_MODE_COUNT, 2, 1),
+            -1);
+  EXPECT_EQ(downsampler.configure(
+                DataRecorder::DECIMATE, DataRecorder::MAX_DOWNSAMPLE_FACTOR, 1),
+            0);
+  EXPECT_EQ(downsampler.getFactor(), DataRecorder::MAX_DOWNSAMPLE_FACTOR);
+  EXPECT_EQ(downsampler.configure(DataRecorder::DECIMATE, 1, 1), 0);
+  EXPECT_FALSE(downsampler.active());
+}
+
+TEST_F(DownsamplerTest, decimateKeepsLastFrame)
+{
+  const size_t channel_count = 2;
+  DataRecorder::Downsampler downsampler;
+  ASSERT_EQ(downsampler.configure(DataRecorder::DECIMATE, 4, channel_count),
+            0);
+  std::vector<int64_t> times;
+  std::vector<double> values;
+  for (int64_t frame = 0; frame < 10; frame++) {
+    times.push_back(frame);
+    values.push_back(static_cast<double>(frame));
+    values.push_back(-static_cast<double>(frame));
+  }
+  std::vector<char> output;
+  ASSERT_EQ(
+      downsampler.process(make_frames(times, values).data(), 10, output), 2);
+
+  // The two frames left over start the next block
+  times = {10, 11};
+  values = {10.0, -10.0, 11.0, -11.0};
+  ASSERT_EQ(downsampler.process(make_frames(times, values).data(), 2, output),
+            1);
+  split_frames(output, channel_count, times, values);
+  EXPECT_EQ(times, std::vector<int64_t>({3, 7, 11}));
+  EXPECT_EQ(values, std::vector<double>({3.0, -3.0, 7.0, -7.0, 11.0, -11.0}));
+}
+
+TEST_F(DownsamplerTest, blockAverageAcrossCalls)
+{
+  DataRecorder::Downsampler downsampler;
+  ASSERT_EQ(downsampler.configure(DataRecorder::BLOCK_AVERAGE, 3, 1), 0);
+  std::vector<char> output;
+  // Blocks of three frames, fed in batches that split the second block
+  const std::vector<std::vector<int64_t>> batches = {{1, 2}, {3, 4, 5, 6}, {7}};
+  size_t produced = 0;
+  for (const auto& batch : batches) {
+    std::vector<double> batch_values(batch.begin(), batch.end());
+    produced += downsampler.process(
+        make_frames(batch, batch_values).data(), batch.size(), output);
+  }
+  EXPECT_EQ(produced, 2);
+  std::vector<int64_t> times;
+  std::vector<double> values;
+  split_frames(output, 1, times, values);
+  EXPECT_EQ(times, std::vector<int64_t>({3, 6}));
+  EXPECT_EQ(values, std::vector<double>({2.0, 5.0}));
+}
+
+TEST_F(DownsamplerTest, firGainAndDelay)
+{
+  const size_t factor = 4;
+  const std::vector<double> taps =
+      DataRecorder::Downsampler::design_filter(factor);
+  ASSERT_EQ(taps.size(), (DataRecorder::FIR_TAPS_PER_FACTOR * factor) + 1);
+  double gain = 0.0;
+  for (const double tap : taps) {
+    gain += tap;
+  }
+  EXPECT_NEAR(gain, 1.0, 1e-12);
+
+  // A symmetric filter with unit gain turns a ramp into the same ramp
+  // delayed by half its length
+  DataRecorder::Downsampler downsampler;
+  ASSERT_EQ(downsampler.configure(DataRecorder::FIR_DECIMATE, factor, 1), 0);
+  ASSERT_EQ(downsampler.getTapCount(), taps.size());
+  const size_t frame_count = 50 * factor;
+  std::vector<int64_t> times(frame_count);
+  std::vector<double> values(frame_count);
+  for (size_t frame = 0; frame < frame_count; frame++) {
+    times[frame] = static_cast<int64_t>(frame);
+    values[frame] = static_cast<double>(frame);
+  }
+  std::vector<char> output;
+  ASSERT_EQ(downsampler.process(
+                make_frames(times, values).data(), frame_count, output),
+            frame_count / factor);
+  split_frames(output, 1, times, values);
+  const double delay = static_cast<double>(taps.size() - 1) / 2.0;
+  for (size_t index = 0; index < times.size(); index++) {
+    // Earlier outputs still see the zeros from before the trial
+    if (static_cast<size_t>(times[index]) + 1 < taps.size()) {
+      continue;
+    }
+    EXPECT_NEAR(values[index], static_cast<double>(times[index]) - delay, 1e-9)
+        << "output " << index;
+  }
+}
+
+TEST_F(DownsamplerTest, firStopband)
+{
+  const size_t factor = 4;
+  DataRecorder::Downsampler downsampler;
+  ASSERT_EQ(downsampler.configure(DataRecorder::FIR_DECIMATE, factor, 1), 0);
+  // Well above the downsampled Nyquist frequency of 1 / (2 * factor)
+  const double frequency = 0.2;
+  const size_t frame_count = 200 * factor;
+  std::vector<int64_t> times(frame_count);
+  std::vector<double> values(frame_count);
+  for (size_t frame = 0; frame < frame_count; frame++) {
+    times[frame] = static_cast<int64_t>(frame);
+    values[frame] =
+        std::sin(2.0 * M_PI * frequency * static_cast<double>(frame));
+  }
+  std::vector<char> output;
+  downsampler.process(make_frames(times, values).data(), frame_count, output);
+  split_frames(output, 1, times, values);
+  double peak = 0.0;
+  for (size_t index = 0; index < times.size(); index++) {
+    if (static_cast<size_t>(times[index]) + 1 >= downsampler.getTapCount()) {
+      peak = std::max(peak, std::abs(values[index]));
+    }
+  }
+  // At least 40 dB below the unit amplitude tone
+  EXPECT_LT(peak, 1e-2);
+}
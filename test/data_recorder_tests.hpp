@@ -0,0 +1,71 @@
+/*
+         The Real-Time eXperiment Interface (RTXI)
+         Copyright (C) 2011 Georgia Institute of Technology, University of Utah,
+   Will Cornell Medical College
+
+         This program is free software: you can redistribute it and/or modify
+         it under the terms of the GNU General Public License as published by
+         the Free Software Foundation, either version 3 of the License, or
+         (at your option) any later version.
+
+         This program is distributed in the hope that it will be useful,
+         but WITHOUT ANY WARRANTY; without even the implied warranty of
+         MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+         GNU General Public License for more details.
+
+         You should have received a copy of the GNU General Public License
+         along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef DATA_RECORDER_TESTS_H
+#define DATA_RECORDER_TESTS_H
+
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <hdf5.h>
+
+#include "data_recorder/chunk_pipeline.hpp"
+#include "data_recorder/downsampler.hpp"
+
+class ChunkPipelineTest : public ::testing::Test
+{
+protected:
+  ChunkPipelineTest();
+  ~ChunkPipelineTest() override;
+  ChunkPipelineTest(const ChunkPipelineTest&) = delete;
+  ChunkPipelineTest(ChunkPipelineTest&&) = delete;
+  ChunkPipelineTest& operator=(const ChunkPipelineTest&) = delete;
+  ChunkPipelineTest& operator=(ChunkPipelineTest&&) = delete;
+
+  // Chunked, extendible dataset laid out like the recorder's Data and Time
+  // sets. A channel count of zero makes a one dimensional set.
+  hid_t create_dataset(const char* name,
+                       hid_t file_type,
+                       hsize_t channel_count,
+                       hsize_t chunk_frames,
+                       const DataRecorder::chunk_filter_t& filter);
+
+  // In memory file, nothing is written to disk
+  hid_t file = H5I_INVALID_HID;
+};
+
+class DownsamplerTest : public ::testing::Test
+{
+protected:
+  // Interleaves times and values the way the recording component does.
+  // values holds channel_count values per frame.
+  static std::vector<char> make_frames(const std::vector<int64_t>& times,
+                                       const std::vector<double>& values);
+
+  // Splits interleaved frames back into times and values
+  static void split_frames(const std::vector<char>& frames,
+                           size_t channel_count,
+                           std::vector<int64_t>& times,
+                           std::vector<double>& values);
+};
+
+#endif
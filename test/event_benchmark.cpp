@@ -0,0 +1,197 @@
+/*
+         The Real-Time eXperiment Interface (RTXI)
+         Copyright (C) 2011 Georgia Institute of Technology, University of Utah,
+   Will Cornell Medical College
+
+         This program is free software: you can redistribute it and/or modify
+         it under the terms of the GNU General Public License as published by
+         the Free Software Foundation, either version 3 of the License, or
+         (at your option) any later version.
+
+         This program is distributed in the hope that it will be useful,
+         but WITHOUT ANY WARRANTY; without even the implied warranty of
+         MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+         GNU General Public License for more details.
+
+         You should have received a copy of the GNU General Public License
+         along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+ * Throughput benchmarks for the event manager queue. Not part of the test
+ * suite; run eventBenchmark by hand and compare the numbers between builds.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "event.hpp"
+#include "event_queue.hpp"
+
+namespace
+{
+// The queue the event manager used before Event::Queue
+class lockedQueue
+{
+public:
+  void push(Event::Object* event, const std::atomic<bool>& /*running*/)
+  {
+    {
+      const std::unique_lock<std::mutex> lk(this->mut);
+      this->events.push(event);
+    }
+    this->available.notify_one();
+  }
+
+  Event::Object* pop(const std::atomic<bool>& running)
+  {
+    std::unique_lock<std::mutex> lk(this->mut);
+    this->available.wait(lk,
+                         [&]() { return !this->events.empty() || !running; });
+    if (this->events.empty()) {
+      return nullptr;
+    }
+    Event::Object* event = this->events.front();
+    this->events.pop();
+    return event;
+  }
+
+private:
+  std::mutex mut;
+  std::condition_variable available;
+  std::queue<Event::Object*> events;
+};
+
+template<class queue_t>
+double queue_throughput(queue_t& queue,
+                        size_t producer_count,
+                        size_t consumer_count,
+                        size_t events_per_producer)
+{
+  const std::atomic<bool> running = true;
+  Event::Object event(Event::Type::NOOP);
+  const size_t total = producer_count * events_per_producer;
+  std::atomic<int64_t> remaining = static_cast<int64_t>(total);
+  std::vector<std::thread> threads;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t consumer = 0; consumer < consumer_count; consumer++) {
+    threads.emplace_back(
+        [&]()
+        {
+          // each consumer claims an event before popping it, so nobody
+          // blocks on a queue that will never be refilled
+          while (remaining.fetch_sub(1) > 0) {
+            queue.pop(running);
+          }
+        });
+  }
+  for (size_t producer = 0; producer < producer_count; producer++) {
+    threads.emplace_back(
+        [&]()
+        {
+          for (size_t count = 0; count < events_per_producer; count++) {
+            queue.push(&event, running);
+          }
+        });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return static_cast<double>(total) / elapsed.count();
+}
+
+class nullHandler : public Event::Handler
+{
+public:
+  void receiveEvent(Event::Object* /*event*/) override {}
+  std::vector<Event::Type> subscriptions() const override
+  {
+    return {Event::Type::NOOP};
+  }
+};
+
+double post_event_throughput(size_t worker_count,
+                             size_t producer_count,
+                             size_t events_per_producer)
+{
+  Event::Manager manager(worker_count);
+  nullHandler handler;
+  manager.registerHandler(&handler);
+  std::vector<std::thread> producers;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t producer = 0; producer < producer_count; producer++) {
+    producers.emplace_back(
+        [&]()
+        {
+          for (size_t count = 0; count < events_per_producer; count++) {
+            Event::Object event(Event::Type::NOOP);
+            manager.postEvent(&event);
+          }
+        });
+  }
+  for (auto& thread : producers) {
+    thread.join();
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  manager.unregisterHandler(&handler);
+  return static_cast<double>(producer_count * events_per_producer)
+      / elapsed.count();
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+  size_t events_per_producer = 200000;
+  if (argc > 1) {
+    events_per_producer = std::strtoul(argv[1], nullptr, 10);
+  }
+  const std::vector<size_t> thread_counts = {1, 2, 4, 8};
+
+  fmt::print(stderr, "queue throughput (events/s, producers x consumers)\n");
+  fmt::print(stderr,
+             "{:>8} {:>16} {:>16}\n",
+             "threads",
+             "mutex+condvar",
+             "lock-free");
+  for (const size_t threads : thread_counts) {
+    lockedQueue locked;
+    Event::Queue lockfree(1024);
+    const double locked_rate =
+        queue_throughput(locked, threads, threads, events_per_producer);
+    const double lockfree_rate =
+        queue_throughput(lockfree, threads, threads, events_per_producer);
+    fmt::print(stderr,
+               "{:>8} {:>16.0f} {:>16.0f}\n",
+               threads,
+               locked_rate,
+               lockfree_rate);
+  }
+
+  fmt::print(stderr,
+             "\npostEvent throughput (events/s, {} workers)\n",
+             Event::Manager::DEFAULT_WORKER_COUNT);
+  fmt::print(stderr, "{:>8} {:>16}\n", "posters", "postEvent");
+  for (const size_t threads : thread_counts) {
+    const double rate =
+        post_event_throughput(Event::Manager::DEFAULT_WORKER_COUNT,
+                              threads,
+                              events_per_producer / 10);
+    fmt::print(stderr, "{:>8} {:>16.0f}\n", threads, rate);
+  }
+  return 0;
+}
@@ -18,6 +18,15 @@
 
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
 #include <thread>
 
 #include "event_tests.hpp"
@@ -34,6 +43,37 @@ TEST_F(EventObjectTest, ParameterTests)
   ASSERT_FALSE(event.getParam("DOESNOTEXIST").has_value());
 }
 
+TEST_F(EventObjectTest, PayloadTests)
+{
+  Event::Object typed_event(Event::Type::RT_PERIOD_EVENT);
+  ASSERT_FALSE(typed_event.hasPayload());
+  typed_event.setPayload(Event::period_payload_t {42});
+  ASSERT_TRUE(typed_event.hasPayload());
+  ASSERT_EQ(typed_event.getPayload<Event::period_payload_t>().period, 42);
+  // payload fields are visible to handlers using named parameters
+  ASSERT_TRUE(typed_event.paramExists("period"));
+  ASSERT_EQ(std::any_cast<int64_t>(typed_event.getParam("period")), 42);
+  ASSERT_FALSE(typed_event.getParam("DOESNOTEXIST").has_value());
+
+  // and events built with named parameters still produce a payload
+  Event::Object named_event(Event::Type::RT_PERIOD_EVENT);
+  named_event.setParam("period", std::any(int64_t {7}));
+  ASSERT_FALSE(named_event.hasPayload());
+  ASSERT_EQ(named_event.getPayload<Event::period_payload_t>().period, 7);
+  Event::Object empty_event(Event::Type::RT_PERIOD_EVENT);
+  ASSERT_THROW(empty_event.getPayload<Event::period_payload_t>(),
+               std::bad_any_cast);
+
+  Event::widget_parameter_payload_t parameter;
+  parameter.id = 3;
+  parameter.value = 1.5;
+  Event::Object parameter_event(Event::Type::RT_WIDGET_PARAMETER_CHANGE_EVENT);
+  parameter_event.setPayload(parameter);
+  ASSERT_EQ(std::any_cast<size_t>(parameter_event.getParam("paramID")), 3);
+  ASSERT_EQ(std::any_cast<double>(parameter_event.getParam("paramValue")),
+            1.5);
+}
+
 TEST_F(EventObjectTest, EventProcessingWait)
 {
   Event::Object test_event(Event::Type::NOOP);
@@ -89,3 +129,275 @@ TEST_F(EventManagerTest, Registration)
   // Unregister all event handlers before exiting
   event_manager->unregisterHandler(&event_handler);
 }
+
+TEST_F(EventManagerTest, Subscriptions)
+{
+  auto event_manager = std::make_unique<Event::Manager>(4);
+  MockSubscribedEventHandler period_handler({Event::Type::RT_PERIOD_EVENT});
+  MockSubscribedEventHandler noop_handler(
+      {Event::Type::NOOP, Event::Type::NOOP});
+  Event::Object period_event(Event::Type::RT_PERIOD_EVENT);
+  Event::Object noop_event(Event::Type::NOOP);
+
+  // handlers only receive the event types they subscribed to, once
+  EXPECT_CALL(period_handler, receiveEvent(&period_event)).Times(1);
+  EXPECT_CALL(period_handler, receiveEvent(&noop_event)).Times(0);
+  EXPECT_CALL(noop_handler, receiveEvent(&noop_event)).Times(1);
+  EXPECT_CALL(noop_handler, receiveEvent(&period_event)).Times(0);
+  event_manager->registerHandler(&period_handler);
+  event_manager->registerHandler(&noop_handler);
+  event_manager->postEvent(&period_event);
+  event_manager->postEvent(&noop_event);
+
+  // unregistered handlers are removed from every event type
+  event_manager->unregisterHandler(&period_handler);
+  ASSERT_FALSE(event_manager->isRegistered(&period_handler));
+  Event::Object second_period_event(Event::Type::RT_PERIOD_EVENT);
+  EXPECT_CALL(period_handler, receiveEvent(&second_period_event)).Times(0);
+  event_manager->postEvent(&second_period_event);
+  event_manager->unregisterHandler(&noop_handler);
+}
+
+TEST_F(EventManagerTest, postEventAsync)
+{
+  auto event_manager = std::make_unique<Event::Manager>();
+  MockSubscribedEventHandler event_handler({Event::Type::RT_PERIOD_EVENT});
+  EXPECT_CALL(event_handler, receiveEvent(testing::_))
+      .Times(Event::Manager::EVENT_POOL_SIZE + 1);
+  event_manager->registerHandler(&event_handler);
+
+  // more events than the pool holds are still delivered, in order
+  std::mutex order_mut;
+  std::vector<int64_t> order;
+  for (size_t count = 0; count <= Event::Manager::EVENT_POOL_SIZE; count++) {
+    auto event = event_manager->acquireEvent(Event::Type::RT_PERIOD_EVENT);
+    event->setPayload(Event::period_payload_t {static_cast<int64_t>(count)});
+    event_manager->postEventAsync(
+        std::move(event),
+        [&order_mut, &order](Event::Object* handled)
+        {
+          ASSERT_TRUE(handled->isdone());
+          const std::unique_lock<std::mutex> lk(order_mut);
+          order.push_back(
+              handled->getPayload<Event::period_payload_t>().period);
+        });
+  }
+  ASSERT_EQ(event_manager->flushAsync(), 0);
+  ASSERT_EQ(order.size(), Event::Manager::EVENT_POOL_SIZE + 1);
+  for (size_t count = 0; count < order.size(); count++) {
+    ASSERT_EQ(order[count], static_cast<int64_t>(count));
+  }
+  event_manager->unregisterHandler(&event_handler);
+}
+
+TEST_F(EventManagerTest, flushAsyncDoesNotWaitOnItself)
+{
+  auto event_manager = std::make_unique<Event::Manager>();
+  std::atomic<int> nested_result = 0;
+  event_manager->postEventAsync(
+      event_manager->acquireEvent(Event::Type::NOOP),
+      [&event_manager, &nested_result](Event::Object* /*event*/)
+      { nested_result = event_manager->flushAsync(); });
+  ASSERT_EQ(event_manager->flushAsync(), 0);
+  ASSERT_EQ(nested_result, -1);
+
+  // nothing is left to wait for once the manager stopped
+  Event::Manager* manager = event_manager.get();
+  std::promise<void> blocked;
+  auto blocked_future = blocked.get_future();
+  event_manager->postEventAsync(
+      event_manager->acquireEvent(Event::Type::NOOP),
+      [&blocked_future](Event::Object* /*event*/) { blocked_future.wait(); });
+  std::thread flusher([manager]() { ASSERT_EQ(manager->flushAsync(), -1); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  std::thread destroyer([&event_manager]() { event_manager.reset(); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  flusher.join();
+  blocked.set_value();
+  destroyer.join();
+}
+
+TEST_F(EventQueueTest, MultiProducerMultiConsumer)
+{
+  // a tiny queue makes both producers and consumers park
+  Event::Queue queue(4);
+  ASSERT_EQ(queue.getCapacity(), 4);
+  const std::atomic<bool> running = true;
+  const size_t producer_count = 4;
+  const size_t events_per_producer = 2000;
+  std::vector<std::unique_ptr<Event::Object>> events;
+  for (size_t count = 0; count < producer_count * events_per_producer; count++)
+  {
+    events.push_back(std::make_unique<Event::Object>(Event::Type::NOOP));
+  }
+
+  std::vector<std::thread> producers;
+  for (size_t producer = 0; producer < producer_count; producer++) {
+    producers.emplace_back(
+        [&, producer]()
+        {
+          for (size_t count = 0; count < events_per_producer; count++) {
+            queue.push(events[producer * events_per_producer + count].get(),
+                       running);
+          }
+        });
+  }
+  std::mutex received_mut;
+  std::vector<Event::Object*> received;
+  std::vector<std::thread> consumers;
+  for (size_t consumer = 0; consumer < 2; consumer++) {
+    consumers.emplace_back(
+        [&]()
+        {
+          for (size_t count = 0; count < events.size() / 2; count++) {
+            Event::Object* event = queue.pop(running);
+            const std::unique_lock<std::mutex> lk(received_mut);
+            received.push_back(event);
+          }
+        });
+  }
+  for (auto& thread : producers) {
+    thread.join();
+  }
+  for (auto& thread : consumers) {
+    thread.join();
+  }
+  ASSERT_EQ(queue.tryPop(), nullptr);
+
+  // every event was delivered exactly once
+  std::sort(received.begin(), received.end());
+  ASSERT_EQ(std::adjacent_find(received.begin(), received.end()),
+            received.end());
+  ASSERT_EQ(received.size(), events.size());
+  ASSERT_EQ(std::find(received.begin(), received.end(), nullptr),
+            received.end());
+}
+
+TEST_F(EventQueueTest, StopsWhenNotRunning)
+{
+  Event::Queue queue(2);
+  std::atomic<bool> running = true;
+  Event::Object event(Event::Type::NOOP);
+  ASSERT_TRUE(queue.tryPush(&event));
+  ASSERT_TRUE(queue.tryPush(&event));
+  ASSERT_FALSE(queue.tryPush(&event));
+
+  // a parked producer gives up once the queue is stopped
+  std::thread producer([&]() { ASSERT_FALSE(queue.push(&event, running)); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  running = false;
+  queue.wakeAll();
+  producer.join();
+  ASSERT_EQ(queue.tryPop(), &event);
+  ASSERT_EQ(queue.tryPop(), &event);
+  ASSERT_EQ(queue.pop(running), nullptr);
+}
+
+TEST_F(EventLoggerTest, WritesDecodableLog)
+{
+  {
+    eventLogger logger(this->logfile);
+    Event::Object period_event(Event::Type::RT_PERIOD_EVENT);
+    period_event.setPayload(Event::period_payload_t {1000000});
+    logger.log(&period_event);
+    Event::Object noop_event(Event::Type::NOOP);
+    logger.log(&noop_event);
+    logger.log(RT::Telemitry::Response {RT::Telemitry::RT_NOOP, nullptr});
+    logger.flush();
+    ASSERT_EQ(std::filesystem::file_size(this->logfile),
+              sizeof(eventLogger::file_header_t)
+                  + 3 * sizeof(eventLogger::record_t));
+    ASSERT_EQ(logger.getDroppedCount(), 0);
+  }
+  std::ifstream input(this->logfile, std::ios::binary);
+  std::stringstream output;
+  ASSERT_EQ(eventLogger::decode(input, output), 0);
+  std::vector<std::string> lines;
+  for (std::string line; std::getline(output, line);) {
+    lines.push_back(line);
+  }
+  ASSERT_EQ(lines.size(), 3);
+  EXPECT_NE(lines[0].find(Event::type_to_string(Event::Type::RT_PERIOD_EVENT)),
+            std::string::npos);
+  EXPECT_NE(lines[0].find("VALUE -- 1000000"), std::string::npos);
+  EXPECT_NE(lines[1].find(Event::type_to_string(Event::Type::NOOP)),
+            std::string::npos);
+  EXPECT_NE(lines[2].find("NO-OP Acknowledged"), std::string::npos);
+
+  std::stringstream garbage("not a log file");
+  std::stringstream ignored;
+  ASSERT_EQ(eventLogger::decode(garbage, ignored), -1);
+}
+
+TEST_F(EventLoggerTest, RotatesFiles)
+{
+  const size_t records_per_file = 4;
+  const size_t max_file_size = sizeof(eventLogger::file_header_t)
+      + records_per_file * sizeof(eventLogger::record_t);
+  eventLogger logger(this->logfile, max_file_size, /*max_files=*/2);
+  const RT::Telemitry::Response response {RT::Telemitry::RT_NOOP, nullptr};
+  for (size_t count = 0; count < 3 * records_per_file; count++) {
+    logger.log(response);
+    logger.flush();
+  }
+  const std::string base = this->logfile.string();
+  EXPECT_TRUE(std::filesystem::exists(base + ".1"));
+  EXPECT_FALSE(std::filesystem::exists(base + ".2"));
+  EXPECT_LE(std::filesystem::file_size(this->logfile), max_file_size);
+  EXPECT_EQ(std::filesystem::file_size(base + ".1"), max_file_size);
+}
+
+TEST_F(EventLoggerTest, DefaultsToPerProcessFile)
+{
+  const std::filesystem::path state_home =
+      this->logfile.parent_path()
+      / ("rtxi_logger_state_" + std::to_string(::getpid()));
+  const char* saved = std::getenv("XDG_STATE_HOME");  // NOLINT
+  const std::string saved_value = saved == nullptr ? "" : saved;
+  ::setenv("XDG_STATE_HOME", state_home.c_str(), /*overwrite=*/1);
+  const std::filesystem::path expected = state_home / "rtxi"
+      / ("events-" + std::to_string(::getpid()) + ".log");
+  EXPECT_EQ(eventLogger::default_logfile(), expected);
+  {
+    eventLogger logger;
+    EXPECT_EQ(logger.getLogfile(), expected);
+  }
+  EXPECT_TRUE(std::filesystem::exists(expected));
+  if (saved == nullptr) {
+    ::unsetenv("XDG_STATE_HOME");
+  } else {
+    ::setenv("XDG_STATE_HOME", saved_value.c_str(), /*overwrite=*/1);
+  }
+  std::error_code ec;
+  std::filesystem::remove_all(state_home, ec);
+}
+
+TEST_F(EventLoggerTest, LogsBatchedEvents)
+{
+  {
+    Event::Manager manager(/*worker_count=*/1, this->logfile);
+    Event::Object period_event(Event::Type::RT_PERIOD_EVENT);
+    period_event.setPayload(Event::period_payload_t {1000000});
+    Event::Object noop_event(Event::Type::NOOP);
+    Event::Object batch_event(Event::Type::RT_COMMAND_BATCH_EVENT);
+    batch_event.setParam(
+        "events",
+        std::any(std::vector<Event::Object*> {&period_event, &noop_event}));
+    manager.postEvent(&batch_event);
+  }
+  std::ifstream input(this->logfile, std::ios::binary);
+  std::stringstream output;
+  ASSERT_EQ(eventLogger::decode(input, output), 0);
+  std::vector<std::string> lines;
+  for (std::string line; std::getline(output, line);) {
+    lines.push_back(line);
+  }
+  // followed by the manager shutting down
+  ASSERT_GE(lines.size(), 3);
+  EXPECT_NE(
+      lines[0].find(Event::type_to_string(Event::Type::RT_COMMAND_BATCH_EVENT)),
+      std::string::npos);
+  EXPECT_NE(lines[1].find("VALUE -- 1000000"), std::string::npos);
+  EXPECT_NE(lines[2].find(Event::type_to_string(Event::Type::NOOP)),
+            std::string::npos);
+}
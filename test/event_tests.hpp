@@ -24,7 +24,14 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <filesystem>
+#include <string>
+
+#include <unistd.h>
+
 #include "event.hpp"
+#include "event_queue.hpp"
+#include "logger.hpp"
 
 class EventObjectTest : public ::testing::Test
 {
@@ -40,6 +47,31 @@ protected:
   ~EventManagerTest() override = default;
 };
 
+class EventQueueTest : public ::testing::Test
+{
+protected:
+  EventQueueTest() = default;
+  ~EventQueueTest() override = default;
+};
+
+class EventLoggerTest : public ::testing::Test
+{
+protected:
+  EventLoggerTest()
+      : logfile(std::filesystem::temp_directory_path()
+                / ("rtxi_logger_test_" + std::to_string(::getpid()) + ".log"))
+  {
+  }
+  ~EventLoggerTest() override
+  {
+    std::error_code ec;
+    for (const std::string suffix : {"", ".1", ".2"}) {
+      std::filesystem::remove(this->logfile.string() + suffix, ec);
+    }
+  }
+  std::filesystem::path logfile;
+};
+
 class MockEventHandler : public Event::Handler
 {
 public:
@@ -49,4 +81,22 @@ public:
   MOCK_METHOD(void, receiveEvent, (Event::Object*), (override));
 };
 
+class MockSubscribedEventHandler : public Event::Handler
+{
+public:
+  explicit MockSubscribedEventHandler(std::vector<Event::Type> subscribed)
+      : types(std::move(subscribed))
+  {
+  }
+
+  MOCK_METHOD(void, receiveEvent, (Event::Object*), (override));
+  std::vector<Event::Type> subscriptions() const override
+  {
+    return this->types;
+  }
+
+private:
+  std::vector<Event::Type> types;
+};
+
 #endif
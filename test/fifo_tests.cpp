@@ -18,10 +18,13 @@
 
  */
 
+#include <array>
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 #include "fifo_tests.hpp"
 
@@ -100,3 +103,157 @@ TEST_F(FifoTest, nonblocking)
   ASSERT_NE(read_bytes, -1);
   ASSERT_STREQ(this->default_message.c_str(), output.c_str());
 }
+
+TEST_F(FifoTest, pipeBackend)
+{
+  std::unique_ptr<RT::OS::Fifo> fifo;
+  const int result =
+      RT::OS::getFifo(fifo, this->default_buffer_size, RT::OS::PIPE_FIFO);
+  ASSERT_EQ(result, 0);
+  std::string output(this->default_message.size(), '\0');
+  fifo->writeRT(this->default_message.data(), this->default_message.size());
+  const int64_t read_bytes =
+      fifo->read(output.data(), this->default_message.size());
+  ASSERT_EQ(read_bytes, static_cast<int64_t>(this->default_message.size()));
+  EXPECT_EQ(this->default_message, output);
+}
+
+TEST_F(FifoTest, ringWraparound)
+{
+  std::unique_ptr<RT::OS::Fifo> fifo;
+  const int result =
+      RT::OS::getFifo(fifo, this->default_buffer_size, RT::OS::RING_FIFO);
+  ASSERT_EQ(result, 0);
+  EXPECT_EQ(fifo->getCapacity(), this->default_buffer_size);
+  // empty fifos behave like non-blocking pipes
+  std::array<int64_t, 4> sample {};
+  EXPECT_EQ(fifo->read(sample.data(), sizeof(sample)), -1);
+
+  // Push enough data through the ring to wrap around its storage many times
+  const size_t sample_size = sizeof(int64_t) * sample.size();
+  for (int64_t iter = 0; iter < 10000; iter++) {
+    sample.fill(iter);
+    ASSERT_EQ(fifo->writeRT(sample.data(), sample_size),
+              static_cast<int64_t>(sample_size));
+    sample.fill(-1);
+    ASSERT_EQ(fifo->read(sample.data(), sample_size),
+              static_cast<int64_t>(sample_size));
+    for (auto value : sample) {
+      ASSERT_EQ(value, iter);
+    }
+  }
+
+  // The fifo must not accept more than its capacity
+  size_t written = 0;
+  while (fifo->writeRT(sample.data(), sample_size) > 0) {
+    written += sample_size;
+  }
+  EXPECT_LE(written, fifo->getCapacity());
+  EXPECT_GT(written + sample_size, fifo->getCapacity());
+}
+
+TEST_F(FifoTest, ringPollWakeup)
+{
+  std::unique_ptr<RT::OS::Fifo> fifo;
+  const int result =
+      RT::OS::getFifo(fifo, this->default_buffer_size, RT::OS::RING_FIFO);
+  ASSERT_EQ(result, 0);
+  std::string output(this->default_message.size(), '\0');
+  int64_t read_bytes = -1;
+  auto reader = [&]()
+  {
+    while (read_bytes <= 0) {
+      fifo->poll();
+      read_bytes = fifo->read(output.data(), output.size());
+    }
+  };
+  std::thread reader_thread(reader);
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  fifo->writeRT(this->default_message.data(), this->default_message.size());
+  reader_thread.join();
+  ASSERT_EQ(read_bytes, static_cast<int64_t>(this->default_message.size()));
+  EXPECT_EQ(this->default_message, output);
+}
+
+TEST_F(FifoTest, zeroCopy)
+{
+  std::unique_ptr<RT::OS::Fifo> fifo;
+  const int result =
+      RT::OS::getFifo(fifo, this->default_buffer_size, RT::OS::RING_FIFO);
+  ASSERT_EQ(result, 0);
+  EXPECT_EQ(fifo->peek().data, nullptr);
+
+  const size_t message_size = this->default_message.size();
+  for (size_t iter = 0; iter < 100; iter++) {
+    RT::OS::fifo_span_t region = fifo->reserveRT(message_size);
+    ASSERT_NE(region.data, nullptr);
+    ASSERT_EQ(region.size, message_size);
+    memcpy(region.data, this->default_message.data(), message_size);
+    // nothing is visible to the reader until committed
+    EXPECT_EQ(fifo->peek().data, nullptr);
+    fifo->commitRT(message_size);
+
+    region = fifo->peek();
+    ASSERT_NE(region.data, nullptr);
+    ASSERT_EQ(region.size, message_size);
+    EXPECT_EQ(std::string(static_cast<char*>(region.data), region.size),
+              this->default_message);
+    fifo->consume(region.size);
+    EXPECT_EQ(fifo->peek().data, nullptr);
+  }
+
+  // reservations larger than the capacity are refused
+  EXPECT_EQ(fifo->reserveRT(this->default_buffer_size + 1).data, nullptr);
+}
+
+TEST_F(FifoTest, concurrentWriters)
+{
+  // Several event handlers post commands at the same time, and the
+  // real-time thread drains them more slowly than they arrive
+  std::unique_ptr<RT::OS::Fifo> fifo;
+  const size_t producer_count = 8;
+  const int64_t values_per_producer = 20000;
+  const int result = RT::OS::getFifo(fifo, 64 * sizeof(int64_t));
+  ASSERT_EQ(result, 0);
+  std::vector<std::thread> producers;
+  for (size_t producer = 0; producer < producer_count; producer++) {
+    producers.emplace_back(
+        [&fifo, producer, values_per_producer]()
+        {
+          const int64_t base =
+              static_cast<int64_t>(producer) * values_per_producer;
+          for (int64_t value = base; value < base + values_per_producer;
+               value++)
+          {
+            ASSERT_EQ(fifo->write(&value, sizeof(int64_t)),
+                      static_cast<int64_t>(sizeof(int64_t)));
+          }
+        });
+  }
+  const auto total = static_cast<size_t>(values_per_producer) * producer_count;
+  std::vector<int> received(total, 0);
+  int64_t value = 0;
+  size_t count = 0;
+  // Lost or duplicated writes would otherwise leave this waiting forever
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(30);
+  while (count < total && std::chrono::steady_clock::now() < deadline) {
+    if (fifo->readRT(&value, sizeof(int64_t)) <= 0) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_GE(value, 0);
+    ASSERT_LT(value, static_cast<int64_t>(total));
+    received[static_cast<size_t>(value)]++;
+    count++;
+  }
+  // Releases producers stuck on a full fifo if the deadline passed
+  fifo->close();
+  for (auto& producer : producers) {
+    producer.join();
+  }
+  ASSERT_EQ(count, total);
+  for (size_t index = 0; index < total; index++) {
+    EXPECT_EQ(received[index], 1) << "value " << index;
+  }
+}
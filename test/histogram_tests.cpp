@@ -0,0 +1,119 @@
+/*
+         The Real-Time eXperiment Interface (RTXI)
+         Copyright (C) 2011 Georgia Institute of Technology, University of Utah,
+   Will Cornell Medical College
+
+         This program is free software: you can redistribute it and/or modify
+         it under the terms of the GNU General Public License as published by
+         the Free Software Foundation, either version 3 of the License, or
+         (at your option) any later version.
+
+         This program is distributed in the hope that it will be useful,
+         but WITHOUT ANY WARRANTY; without even the implied warranty of
+         MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+         GNU General Public License for more details.
+
+         You should have received a copy of the GNU General Public License
+         along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <cstdint>
+
+#include "histogram_tests.hpp"
+
+TEST_F(LogLinearHistogramTest, linearRange)
+{
+  const LogLinearHistogram histogram(this->highest_value,
+                                     this->sub_bucket_bits);
+  const int64_t linear_count = int64_t {1} << this->sub_bucket_bits;
+  for (int64_t value = 0; value < linear_count; value++) {
+    const size_t index = index_of(histogram, value);
+    EXPECT_EQ(index, static_cast<size_t>(value));
+    EXPECT_EQ(highest_equivalent(histogram, index), value);
+  }
+}
+
+TEST_F(LogLinearHistogramTest, powerOfTwoBoundaries)
+{
+  const LogLinearHistogram histogram(this->highest_value,
+                                     this->sub_bucket_bits);
+  // 2^7 values below 128, then 64 sub-buckets per power of two
+  EXPECT_EQ(index_of(histogram, 127), 127);
+  EXPECT_EQ(index_of(histogram, 128), 128);
+  EXPECT_EQ(index_of(histogram, 129), 128);
+  EXPECT_EQ(highest_equivalent(histogram, 128), 129);
+  EXPECT_EQ(index_of(histogram, 255), 191);
+  EXPECT_EQ(highest_equivalent(histogram, 191), 255);
+  EXPECT_EQ(index_of(histogram, 256), 192);
+  EXPECT_EQ(highest_equivalent(histogram, 192), 259);
+
+  for (int exponent = this->sub_bucket_bits; exponent < 30; exponent++) {
+    const int64_t boundary = int64_t {1} << exponent;
+    const size_t below = index_of(histogram, boundary - 1);
+    // A power of two always starts a new bucket
+    EXPECT_EQ(index_of(histogram, boundary), below + 1) << boundary;
+    EXPECT_EQ(highest_equivalent(histogram, below), boundary - 1) << boundary;
+    // and its width doubles with every power of two
+    const int64_t width = int64_t {1} << (exponent - this->sub_bucket_bits + 1);
+    EXPECT_EQ(highest_equivalent(histogram, below + 1), boundary + width - 1)
+        << boundary;
+  }
+}
+
+TEST_F(LogLinearHistogramTest, relativeError)
+{
+  for (const int bits : {4, 7, 8}) {
+    const LogLinearHistogram histogram(this->highest_value, bits);
+    // The bound documented in histogram.h
+    const double bound = 1.0 / static_cast<double>(1 << (bits - 1));
+    for (int64_t value = 1; value < this->highest_value; value = value * 3 + 1)
+    {
+      const int64_t reported =
+          highest_equivalent(histogram, index_of(histogram, value));
+      EXPECT_GE(reported, value);
+      EXPECT_LE(static_cast<double>(reported - value)
+                    / static_cast<double>(value),
+                bound)
+          << bits << " bits, value " << value;
+    }
+  }
+}
+
+TEST_F(LogLinearHistogramTest, percentile)
+{
+  LogLinearHistogram histogram(this->highest_value, this->sub_bucket_bits);
+  EXPECT_EQ(histogram.percentile(50.0), 0);
+  for (int64_t value = 1; value <= 100; value++) {
+    histogram.record(value);
+  }
+  EXPECT_EQ(histogram.count(), 100);
+  EXPECT_EQ(histogram.percentile(0.0), 1);
+  EXPECT_EQ(histogram.percentile(50.0), 50);
+  EXPECT_EQ(histogram.percentile(99.0), 99);
+  EXPECT_EQ(histogram.percentile(100.0), 100);
+
+  // Above the linear range percentiles report the top of their bucket, but
+  // never more than the largest recorded value
+  histogram.clear();
+  for (int i = 0; i < 99; i++) {
+    histogram.record(1000);
+  }
+  histogram.record(5000);
+  EXPECT_EQ(histogram.percentile(50.0), 1007);
+  EXPECT_EQ(histogram.percentile(99.0), 1007);
+  EXPECT_EQ(histogram.percentile(100.0), 5000);
+  EXPECT_EQ(histogram.max(), 5000);
+}
+
+TEST_F(LogLinearHistogramTest, clampsToHighestValue)
+{
+  const int64_t highest = 1000;
+  LogLinearHistogram histogram(highest, this->sub_bucket_bits);
+  histogram.record(-5);
+  histogram.record(highest * 10);
+  EXPECT_EQ(histogram.count(), 2);
+  EXPECT_EQ(histogram.max(), highest);
+  EXPECT_EQ(histogram.percentile(50.0), 0);
+  EXPECT_EQ(histogram.percentile(100.0), highest);
+}
@@ -0,0 +1,49 @@
+/*
+         The Real-Time eXperiment Interface (RTXI)
+         Copyright (C) 2011 Georgia Institute of Technology, University of Utah,
+   Will Cornell Medical College
+
+         This program is free software: you can redistribute it and/or modify
+         it under the terms of the GNU General Public License as published by
+         the Free Software Foundation, either version 3 of the License, or
+         (at your option) any later version.
+
+         This program is distributed in the hope that it will be useful,
+         but WITHOUT ANY WARRANTY; without even the implied warranty of
+         MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+         GNU General Public License for more details.
+
+         You should have received a copy of the GNU General Public License
+         along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef HISTOGRAM_TESTS_H
+#define HISTOGRAM_TESTS_H
+
+#include <cstdint>
+
+#include <gtest/gtest.h>
+
+#include "math/histogram.h"
+
+class LogLinearHistogramTest : public ::testing::Test
+{
+protected:
+  // Bucket helpers are private to the histogram
+  static size_t index_of(const LogLinearHistogram& histogram, int64_t value)
+  {
+    return histogram.index_of(value);
+  }
+
+  static int64_t highest_equivalent(const LogLinearHistogram& histogram,
+                                    size_t index)
+  {
+    return histogram.highest_equivalent(index);
+  }
+
+  int64_t highest_value = 1000000000;
+  int sub_bucket_bits = 7;
+};
+
+#endif
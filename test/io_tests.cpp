@@ -110,3 +110,25 @@ TEST_F(IOBlockTest, writeinput)
   tempblock.echo();
   EXPECT_DOUBLE_EQ(values + values, tempblock.readPort(IO::OUTPUT, 0));
 }
+
+TEST_F(IOBlockTest, portAddress)
+{
+  class testBlock : public IO::Block
+  {
+  public:
+    testBlock(std::string n, const std::vector<IO::channel_t>& c)
+        : IO::Block(std::move(n), c, /*isdependent=*/true)
+    {
+    }
+    void echo() { this->writeoutput(0, this->readinput(0)); }
+  };
+  testBlock tempblock("TEST:BLOCK:NAME", this->defaultChannelList);
+  const double* output = tempblock.getPortAddress(IO::OUTPUT, 0);
+  double* input_buffer = tempblock.getInputBufferAddress(0);
+  *input_buffer += 2.0;
+  tempblock.writeinput(0, 1.0);
+  tempblock.echo();
+  EXPECT_DOUBLE_EQ(*output, 3.0);
+  EXPECT_DOUBLE_EQ(*input_buffer, 0.0);
+  EXPECT_EQ(output, &(tempblock.readPort(IO::OUTPUT, 0)));
+}
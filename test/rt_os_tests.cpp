@@ -105,6 +105,44 @@ TEST_F(RTOSTests, sleepTimestep)
   ASSERT_GE(duration, test_task->period);
 }
 
+TEST_F(RTOSTests, handleOverrun)
+{
+  const int64_t period = RT::OS::DEFAULT_PERIOD;
+  RT::OS::Task task;
+  task.next_t = 10 * period;
+  ASSERT_FALSE(RT::OS::handleOverrun(&task, 10 * period));
+  ASSERT_EQ(task.overruns.load(), 0);
+  ASSERT_EQ(task.next_t, 10 * period);
+
+  // Deadlines at 10, 11 and 12 periods have passed. The late period runs
+  // and the other two are dropped.
+  ASSERT_TRUE(RT::OS::handleOverrun(&task, 12 * period + period / 2));
+  ASSERT_EQ(task.overruns.load(), 1);
+  ASSERT_EQ(task.skipped_periods.load(), 2);
+  ASSERT_EQ(task.next_t, 13 * period);
+
+  task.overrun_policy = RT::OS::OVERRUN_CATCH_UP;
+  const int64_t now = 15 * period + period / 2;
+  ASSERT_TRUE(RT::OS::handleOverrun(&task, now));
+  ASSERT_TRUE(RT::OS::handleOverrun(&task, now));
+  ASSERT_TRUE(RT::OS::handleOverrun(&task, now));
+  ASSERT_FALSE(RT::OS::handleOverrun(&task, now));
+  ASSERT_EQ(task.overruns.load(), 4);
+  ASSERT_EQ(task.skipped_periods.load(), 2);
+  ASSERT_EQ(task.next_t, 16 * period);
+
+  // After a long stall only the most recent periods are made up
+  const int64_t stalled = task.next_t + 1000 * period + period / 2;
+  size_t made_up = 0;
+  while (RT::OS::handleOverrun(&task, stalled)) {
+    made_up++;
+  }
+  ASSERT_EQ(made_up, RT::OS::MAX_CATCH_UP_PERIODS + 1);
+  ASSERT_EQ(task.skipped_periods.load(),
+            2 + 1000 - RT::OS::MAX_CATCH_UP_PERIODS);
+  ASSERT_EQ(task.next_t, stalled - period / 2 + period);
+}
+
 TEST_F(RTOSTests, isRealtime)
 {
   ASSERT_EQ(false, RT::OS::isRealtime());
@@ -18,6 +18,8 @@
 
  */
 
+#include <algorithm>
+#include <chrono>
 #include <random>
 #include <thread>
 
@@ -171,6 +173,533 @@ TEST_F(RTConnectorTest, getBlocks)
   }
 }
 
+TEST_F(RTConnectorTest, incrementalOrder)
+{
+  std::vector<std::unique_ptr<RT::Thread>> threads;
+  std::vector<RT::block_connection_t> connection_memory;
+  for (size_t i = 0; i < 30; i++) {
+    threads.push_back(
+        std::make_unique<MockRTThread>("randthread", this->defaultChannelList));
+    threads.back()->setActive(/*act=*/true);
+    this->connector.insertBlock(threads.back().get(), connection_memory);
+    connection_memory.clear();
+  }
+  auto position = [](const std::vector<RT::Thread*>& order, IO::Block* block)
+  { return std::find(order.begin(), order.end(), block) - order.begin(); };
+
+  // connect in random directions, always against the current order, so
+  // that every accepted connection forces the threads to be reordered
+  std::random_device rd;
+  std::mt19937 gen(rd());
+  std::uniform_int_distribution<size_t> distribution(0, threads.size() - 1);
+  for (size_t iter = 0; iter < 100; iter++) {
+    const std::vector<RT::Thread*> order = this->connector.getThreads();
+    RT::Thread* first = threads[distribution(gen)].get();
+    RT::Thread* second = threads[distribution(gen)].get();
+    if (position(order, first) < position(order, second)) {
+      std::swap(first, second);
+    }
+    const RT::block_connection_t conn = {first, IO::OUTPUT, 0, second, 0};
+    const RT::block_connection_t reverse = {second, IO::OUTPUT, 0, first, 0};
+    if (this->connector.connect(conn) == 0) {
+      ASSERT_NE(first, second);
+      // the opposite connection closes a cycle now
+      ASSERT_EQ(this->connector.connect(reverse), -1);
+      ASSERT_FALSE(this->connector.connected(reverse));
+    } else {
+      ASSERT_FALSE(this->connector.connected(conn));
+    }
+  }
+
+  // pausing a thread and replacing another keeps the order valid
+  threads[3]->setActive(/*act=*/false);
+  this->connector.removeBlock(threads[5].get());
+  auto replacement =
+      std::make_unique<MockRTThread>("replacement", this->defaultChannelList);
+  replacement->setActive(/*act=*/true);
+  this->connector.insertBlock(replacement.get(), connection_memory);
+  connection_memory.clear();
+  ASSERT_EQ(this->connector.connect(
+                {replacement.get(), IO::OUTPUT, 0, threads[0].get(), 0}),
+            0);
+
+  const std::vector<RT::Thread*> order = this->connector.getThreads();
+  EXPECT_EQ(order.size(), threads.size() - 1);
+  EXPECT_EQ(position(order, threads[3].get()), order.size());
+  EXPECT_EQ(position(order, threads[5].get()), order.size());
+  for (auto* thread : order) {
+    for (const auto& conn : this->connector.getOutputs(thread)) {
+      if (!conn.dest->getActive()) {
+        continue;
+      }
+      EXPECT_LT(position(order, conn.src), position(order, conn.dest));
+    }
+  }
+}
+
+TEST_F(RTConnectorTest, slotReuse)
+{
+  MockRTThread source("SOURCE", this->defaultChannelList);
+  MockRTDevice device("DEVICE", this->defaultChannelList);
+  std::vector<RT::block_connection_t> connection_memory;
+  this->connector.insertBlock(&source, connection_memory);
+  this->connector.insertBlock(&device, connection_memory);
+  ASSERT_EQ(this->connector.connect({&device, IO::OUTPUT, 0, &device, 0}), 0);
+
+  // probes come and go while the source and device stay
+  const size_t probe_id = [&]()
+  {
+    MockRTThread probe("PROBE", this->defaultChannelList);
+    this->connector.insertBlock(&probe, connection_memory);
+    const size_t id = probe.getID();
+    for (size_t round = 0; round < 100; round++) {
+      EXPECT_EQ(this->connector.connect({&source, IO::OUTPUT, 0, &probe, 0}),
+                0);
+      EXPECT_EQ(this->connector.connect({&probe, IO::OUTPUT, 0, &device, 0}),
+                0);
+      this->connector.removeBlock(&probe);
+      EXPECT_FALSE(this->connector.isRegistered(&probe));
+      EXPECT_TRUE(this->connector.getOutputs(&source).empty());
+      this->connector.insertBlock(&probe, connection_memory);
+      EXPECT_EQ(probe.getID(), id);
+      EXPECT_TRUE(this->connector.getOutputs(&probe).empty());
+    }
+    this->connector.removeBlock(&probe);
+    return id;
+  }();
+  EXPECT_EQ(this->connector.getRegisteredBlocks().size(), 2);
+  EXPECT_EQ(this->connector.getAllConnections().size(), 1);
+
+  // the next block takes the freed slot, without the old connections
+  MockRTThread replacement("REPLACEMENT", this->defaultChannelList);
+  this->connector.insertBlock(&replacement, connection_memory);
+  EXPECT_EQ(replacement.getID(), probe_id);
+  EXPECT_TRUE(this->connector.getOutputs(&replacement).empty());
+  ASSERT_EQ(
+      this->connector.connect({&replacement, IO::OUTPUT, 0, &source, 0}), 0);
+
+  // clearing a device connected to itself
+  this->connector.clearAllConnections(&device);
+  EXPECT_FALSE(this->connector.connected({&device, IO::OUTPUT, 0, &device, 0}));
+  EXPECT_EQ(this->connector.getAllConnections().size(), 1);
+}
+
+TEST_F(RTConnectorTest, propagateBlockConnections)
+{
+  MockRTThread thread1("THREAD1", this->defaultChannelList);
+  MockRTThread thread2("THREAD2", this->defaultChannelList);
+  MockRTThread thread3("THREAD3", this->defaultChannelList);
+  std::vector<RT::block_connection_t> temp_block_memory;
+  this->connector.insertBlock(&thread1, temp_block_memory);
+  temp_block_memory.clear();
+  this->connector.insertBlock(&thread2, temp_block_memory);
+  temp_block_memory.clear();
+  this->connector.insertBlock(&thread3, temp_block_memory);
+  temp_block_memory.clear();
+  ASSERT_EQ(this->connector.connect({&thread1, IO::OUTPUT, 0, &thread2, 0}), 0);
+  ASSERT_EQ(this->connector.connect({&thread3, IO::OUTPUT, 0, &thread2, 0}), 0);
+  thread1.setOutput(0, 1.5);
+  thread3.setOutput(0, 2.0);
+
+  // connections are not visible to propagation until the table is swapped in
+  this->connector.propagateBlockConnections(&thread1);
+  this->connector.propagateBlockConnections(&thread3);
+  EXPECT_DOUBLE_EQ(thread2.getInput(0), 0.0);
+
+  auto table = this->connector.compileRoutingTable();
+  this->connector.swapRoutingTable(table);
+  this->connector.propagateBlockConnections(&thread1);
+  this->connector.propagateBlockConnections(&thread2);
+  this->connector.propagateBlockConnections(&thread3);
+  EXPECT_DOUBLE_EQ(thread2.getInput(0), 3.5);
+
+  this->connector.disconnect({&thread3, IO::OUTPUT, 0, &thread2, 0});
+  table = this->connector.compileRoutingTable();
+  this->connector.swapRoutingTable(table);
+  this->connector.propagateBlockConnections(&thread1);
+  this->connector.propagateBlockConnections(&thread3);
+  EXPECT_DOUBLE_EQ(thread2.getInput(0), 1.5);
+}
+
+TEST_F(RTConnectorTest, getThreadLevels)
+{
+  MockRTThread source1("SOURCE1", this->defaultChannelList);
+  MockRTThread source2("SOURCE2", this->defaultChannelList);
+  MockRTThread middle("MIDDLE", this->defaultChannelList);
+  MockRTThread sink("SINK", this->defaultChannelList);
+  std::vector<RT::block_connection_t> temp_block_memory;
+  for (auto* thread : {&sink, &middle, &source2, &source1}) {
+    thread->setActive(/*act=*/true);
+    this->connector.insertBlock(thread, temp_block_memory);
+    temp_block_memory.clear();
+  }
+  this->connector.connect({&source1, IO::OUTPUT, 0, &middle, 0});
+  this->connector.connect({&source2, IO::OUTPUT, 0, &middle, 0});
+  this->connector.connect({&middle, IO::OUTPUT, 0, &sink, 0});
+  this->connector.connect({&source1, IO::OUTPUT, 0, &sink, 0});
+
+  std::vector<RT::Thread*> threads = this->connector.getThreads();
+  const std::vector<size_t> levels = this->connector.getThreadLevels(threads);
+  ASSERT_EQ(levels, std::vector<size_t>({0, 2, 3, 4}));
+  EXPECT_THAT(std::vector<RT::Thread*>(threads.begin(), threads.begin() + 2),
+              ::testing::UnorderedElementsAre(&source1, &source2));
+  EXPECT_EQ(threads[2], &middle);
+  EXPECT_EQ(threads[3], &sink);
+
+  // independent threads all share a single level
+  this->connector.disconnect({&source1, IO::OUTPUT, 0, &middle, 0});
+  this->connector.disconnect({&source2, IO::OUTPUT, 0, &middle, 0});
+  this->connector.disconnect({&middle, IO::OUTPUT, 0, &sink, 0});
+  this->connector.disconnect({&source1, IO::OUTPUT, 0, &sink, 0});
+  threads = this->connector.getThreads();
+  EXPECT_EQ(this->connector.getThreadLevels(threads),
+            std::vector<size_t>({0, 4}));
+}
+
+TEST_F(RTConnectorTest, getThreadRates)
+{
+  std::vector<std::unique_ptr<MockRTThread>> slow_threads;
+  std::vector<RT::Thread*> threads;
+  for (size_t i = 0; i < 4; i++) {
+    slow_threads.push_back(
+        std::make_unique<MockRTThread>("slow", this->defaultChannelList));
+    slow_threads.back()->setRateDivisor(4);
+    threads.push_back(slow_threads.back().get());
+  }
+  MockRTThread fast_thread("fast", this->defaultChannelList);
+  threads.push_back(&fast_thread);
+
+  const std::vector<RT::thread_rate_t> rates =
+      this->connector.getThreadRates(threads);
+  ASSERT_EQ(rates.size(), threads.size());
+  std::vector<uint64_t> phases;
+  for (size_t i = 0; i < slow_threads.size(); i++) {
+    EXPECT_EQ(rates[i].divisor, 4);
+    phases.push_back(rates[i].phase);
+  }
+  // one slow thread per period
+  EXPECT_THAT(phases, ::testing::UnorderedElementsAre(0, 1, 2, 3));
+  EXPECT_EQ(rates.back().divisor, 1);
+  EXPECT_EQ(rates.back().phase, 0);
+}
+
+TEST_F(RTConnectorTest, getThreadRatesNonHarmonic)
+{
+  // The phases of non-harmonic divisors only line up again after their
+  // least common multiple
+  std::vector<std::unique_ptr<MockRTThread>> slow_threads;
+  std::vector<RT::Thread*> threads;
+  for (const uint64_t divisor : std::vector<uint64_t> {4, 6, 6}) {
+    slow_threads.push_back(
+        std::make_unique<MockRTThread>("slow", this->defaultChannelList));
+    slow_threads.back()->setRateDivisor(divisor);
+    threads.push_back(slow_threads.back().get());
+  }
+
+  const std::vector<RT::thread_rate_t> rates =
+      this->connector.getThreadRates(threads);
+  ASSERT_EQ(rates.size(), threads.size());
+  for (uint64_t period = 0; period < 12; period++) {
+    size_t executing = 0;
+    for (const auto& rate : rates) {
+      executing += static_cast<size_t>(period % rate.divisor == rate.phase);
+    }
+    EXPECT_LE(executing, 1) << "period " << period;
+  }
+}
+
+TEST_F(SystemTest, parallelThreads)
+{
+  std::vector<IO::channel_t> channels(1);
+  channels[0].name = "CHANNEL OUTPUT";
+  channels[0].flags = IO::OUTPUT;
+  std::vector<std::unique_ptr<MockRTThread>> threads;
+  for (size_t i = 0; i < 8; i++) {
+    threads.push_back(std::make_unique<MockRTThread>("parallel", channels));
+    EXPECT_CALL(*threads.back(), execute()).Times(::testing::AtLeast(1));
+  }
+
+  auto parallel_manager = std::make_unique<Event::Manager>();
+  auto connector = std::make_unique<RT::Connector>();
+  auto parallel_system = std::make_unique<RT::System>(
+      parallel_manager.get(), connector.get(), /*worker_count=*/2);
+  parallel_system->createTelemitryProcessor();
+  for (auto& thread : threads) {
+    thread->setActive(/*act=*/true);
+    Event::Object insert_event(Event::Type::RT_THREAD_INSERT_EVENT);
+    insert_event.setParam("thread", static_cast<RT::Thread*>(thread.get()));
+    parallel_manager->postEvent(&insert_event);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  for (auto& thread : threads) {
+    Event::Object remove_event(Event::Type::RT_THREAD_REMOVE_EVENT);
+    remove_event.setParam("thread", static_cast<RT::Thread*>(thread.get()));
+    parallel_manager->postEvent(&remove_event);
+  }
+  parallel_system.reset();
+}
+
+TEST_F(SystemTest, profiler)
+{
+  std::vector<IO::channel_t> channels(1);
+  channels[0].name = "CHANNEL OUTPUT";
+  channels[0].flags = IO::OUTPUT;
+  MockRTThread thread("profiled", channels);
+  EXPECT_CALL(thread, execute()).Times(::testing::AtLeast(1));
+  thread.setActive(/*act=*/true);
+  this->system->createTelemitryProcessor();
+
+  Event::Object insert_event(Event::Type::RT_THREAD_INSERT_EVENT);
+  insert_event.setParam("thread", static_cast<RT::Thread*>(&thread));
+  this->event_manager->postEvent(&insert_event);
+  Event::Object start_event(Event::Type::RT_PROFILER_START_EVENT);
+  this->event_manager->postEvent(&start_event);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  Event::Object stop_event(Event::Type::RT_PROFILER_STOP_EVENT);
+  this->event_manager->postEvent(&stop_event);
+
+  Event::Object query_event(Event::Type::RT_PROFILER_QUERY_EVENT);
+  this->event_manager->postEvent(&query_event);
+  auto profile = std::any_cast<std::vector<RT::block_profile_t>>(
+      query_event.getParam("profile"));
+  auto entry = std::find_if(profile.begin(),
+                            profile.end(),
+                            [](const RT::block_profile_t& block_profile)
+                            {
+                              return block_profile.block_name == "profiled"
+                                  && block_profile.stage
+                                  == RT::PROFILE_EXECUTE;
+                            });
+  ASSERT_NE(entry, profile.end());
+  EXPECT_GT(entry->count, 0);
+  EXPECT_LE(entry->p99, entry->max);
+  EXPECT_LE(entry->mean, static_cast<double>(entry->max));
+
+  // stats of removed blocks are discarded
+  Event::Object remove_event(Event::Type::RT_THREAD_REMOVE_EVENT);
+  remove_event.setParam("thread", static_cast<RT::Thread*>(&thread));
+  this->event_manager->postEvent(&remove_event);
+  Event::Object requery_event(Event::Type::RT_PROFILER_QUERY_EVENT);
+  this->event_manager->postEvent(&requery_event);
+  profile = std::any_cast<std::vector<RT::block_profile_t>>(
+      requery_event.getParam("profile"));
+  EXPECT_TRUE(profile.empty());
+}
+
+TEST_F(SystemTest, profilerDrainsContinuously)
+{
+  std::vector<IO::channel_t> channels(1);
+  channels[0].name = "CHANNEL OUTPUT";
+  channels[0].flags = IO::OUTPUT;
+  MockRTThread thread("profiled", channels);
+  EXPECT_CALL(thread, execute()).Times(::testing::AtLeast(1));
+  thread.setActive(/*act=*/true);
+  this->system->createTelemitryProcessor();
+
+  Event::Object insert_event(Event::Type::RT_THREAD_INSERT_EVENT);
+  insert_event.setParam("thread", static_cast<RT::Thread*>(&thread));
+  this->event_manager->postEvent(&insert_event);
+  Event::Object period_event(Event::Type::RT_PERIOD_EVENT);
+  period_event.setParam("period", int64_t {20000});
+  this->event_manager->postEvent(&period_event);
+  Event::Object start_event(Event::Type::RT_PROFILER_START_EVENT);
+  this->event_manager->postEvent(&start_event);
+  // far more samples than a profiler fifo holds, without any query
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  Event::Object stop_event(Event::Type::RT_PROFILER_STOP_EVENT);
+  this->event_manager->postEvent(&stop_event);
+
+  Event::Object query_event(Event::Type::RT_PROFILER_QUERY_EVENT);
+  this->event_manager->postEvent(&query_event);
+  const auto profile = std::any_cast<std::vector<RT::block_profile_t>>(
+      query_event.getParam("profile"));
+  const auto entry = std::find_if(
+      profile.begin(),
+      profile.end(),
+      [](const RT::block_profile_t& block_profile)
+      { return block_profile.stage == RT::PROFILE_EXECUTE; });
+  ASSERT_NE(entry, profile.end());
+  EXPECT_GT(entry->count, RT::PROFILE_FIFO_SIZE / sizeof(RT::profile_sample_t));
+  EXPECT_EQ(std::any_cast<uint64_t>(query_event.getParam("profile_dropped")),
+            0);
+
+  Event::Object remove_event(Event::Type::RT_THREAD_REMOVE_EVENT);
+  remove_event.setParam("thread", static_cast<RT::Thread*>(&thread));
+  this->event_manager->postEvent(&remove_event);
+}
+
+TEST_F(SystemTest, overruns)
+{
+  this->system->createTelemitryProcessor();
+  Event::Object policy_event(Event::Type::RT_OVERRUN_POLICY_EVENT);
+  policy_event.setParam("policy", RT::OS::OVERRUN_CATCH_UP);
+  this->event_manager->postEvent(&policy_event);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  Event::Object query_event(Event::Type::RT_OVERRUN_QUERY_EVENT);
+  this->event_manager->postEvent(&query_event);
+  auto stats =
+      std::any_cast<RT::overrun_stats_t>(query_event.getParam("overruns"));
+  EXPECT_LE(stats.recent.size(), RT::OVERRUN_RECENT_COUNT);
+  EXPECT_LE(stats.recent.size(), stats.overruns);
+  EXPECT_TRUE(std::is_sorted(stats.recent.begin(),
+                             stats.recent.end(),
+                             [](const RT::overrun_t& a, const RT::overrun_t& b)
+                             { return a.time < b.time; }));
+}
+
+TEST_F(SystemTest, overrunsDrainContinuously)
+{
+  this->system->createTelemitryProcessor();
+  // A period nothing can keep up with, so nearly every period is late
+  Event::Object period_event(Event::Type::RT_PERIOD_EVENT);
+  period_event.setParam("period", int64_t {1000});
+  this->event_manager->postEvent(&period_event);
+  // far more overruns than the overrun fifo holds, without any query
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  const int64_t query_time = RT::OS::getTime();
+
+  Event::Object query_event(Event::Type::RT_OVERRUN_QUERY_EVENT);
+  this->event_manager->postEvent(&query_event);
+  const auto stats =
+      std::any_cast<RT::overrun_stats_t>(query_event.getParam("overruns"));
+  ASSERT_GT(stats.overruns, RT::OVERRUN_FIFO_SIZE / sizeof(RT::overrun_t));
+  // A busy machine may fall behind briefly, but not for long
+  EXPECT_LT(stats.dropped * 10, stats.overruns);
+  ASSERT_FALSE(stats.recent.empty());
+  // The newest overrun is recent, not the last one that fit in the fifo
+  EXPECT_LT(query_time - stats.recent.back().time,
+            RT::OS::SECONDS_TO_NANOSECONDS / 10);
+
+  Event::Object reset_event(Event::Type::RT_PERIOD_EVENT);
+  reset_event.setParam("period", RT::OS::DEFAULT_PERIOD);
+  this->event_manager->postEvent(&reset_event);
+}
+
+TEST_F(SystemTest, commandBatch)
+{
+  std::vector<IO::channel_t> channels(2);
+  channels[0].name = "CHANNEL OUTPUT";
+  channels[0].flags = IO::OUTPUT;
+  channels[1].name = "CHANNEL INPUT";
+  channels[1].flags = IO::INPUT;
+  MockRTThread source("source", channels);
+  MockRTThread destination("destination", channels);
+  MockRTThread other("other", channels);
+  this->system->createTelemitryProcessor();
+
+  // block insertions are handled on their own, links and period together
+  std::vector<Event::Object> events;
+  for (auto* thread : {&source, &destination, &other}) {
+    events.emplace_back(Event::Type::RT_THREAD_INSERT_EVENT);
+    events.back().setParam("thread", static_cast<RT::Thread*>(thread));
+  }
+  const RT::block_connection_t first = {
+      &source, IO::OUTPUT, 0, &destination, 0};
+  const RT::block_connection_t second = {&source, IO::OUTPUT, 0, &other, 0};
+  for (const auto& connection : {first, second}) {
+    events.emplace_back(Event::Type::IO_LINK_INSERT_EVENT);
+    events.back().setParam("connection", std::any(connection));
+  }
+  events.emplace_back(Event::Type::RT_PERIOD_EVENT);
+  events.back().setParam("period", RT::OS::DEFAULT_PERIOD / 2);
+  std::vector<Event::Object*> batch;
+  for (auto& event : events) {
+    batch.push_back(&event);
+  }
+  Event::Object batch_event(Event::Type::RT_COMMAND_BATCH_EVENT);
+  batch_event.setParam("events", std::any(batch));
+  this->event_manager->postEvent(&batch_event);
+  EXPECT_TRUE(this->rt_connector->connected(first));
+  EXPECT_TRUE(this->rt_connector->connected(second));
+  EXPECT_EQ(this->system->getPeriod(), RT::OS::DEFAULT_PERIOD / 2);
+
+  // asynchronous batches hand back a future instead of blocking
+  Event::Object unlink_event(Event::Type::IO_LINK_REMOVE_EVENT);
+  unlink_event.setParam("connection", std::any(second));
+  Event::Object async_event(Event::Type::RT_COMMAND_BATCH_EVENT);
+  async_event.setParam("events",
+                       std::any(std::vector<Event::Object*> {&unlink_event}));
+  async_event.setParam("async", std::any(true));
+  this->event_manager->postEvent(&async_event);
+  auto completion =
+      std::any_cast<std::shared_future<RT::Telemitry::response_t>>(
+          async_event.getParam("completion"));
+  EXPECT_EQ(completion.get(), RT::Telemitry::RT_BATCH_UPDATE);
+  EXPECT_FALSE(this->rt_connector->connected(second));
+
+  for (auto* thread : {&source, &destination, &other}) {
+    Event::Object remove_event(Event::Type::RT_THREAD_REMOVE_EVENT);
+    remove_event.setParam("thread", static_cast<RT::Thread*>(thread));
+    this->event_manager->postEvent(&remove_event);
+  }
+}
+
+TEST_F(SystemTest, concurrentLinkChanges)
+{
+  std::vector<IO::channel_t> channels(2);
+  channels[0].name = "CHANNEL OUTPUT";
+  channels[0].flags = IO::OUTPUT;
+  channels[1].name = "CHANNEL INPUT";
+  channels[1].flags = IO::INPUT;
+  this->system->createTelemitryProcessor();
+  std::vector<std::unique_ptr<MockRTThread>> chain;
+  for (size_t i = 0; i < 16; i++) {
+    chain.push_back(std::make_unique<MockRTThread>("chain", channels));
+    chain.back()->setActive(/*act=*/true);
+    Event::Object insert_event(Event::Type::RT_THREAD_INSERT_EVENT);
+    insert_event.setParam("thread",
+                          static_cast<RT::Thread*>(chain.back().get()));
+    this->event_manager->postEvent(&insert_event);
+  }
+
+  // Links of one chain posted from several threads at once
+  const size_t poster_count = 4;
+  std::vector<std::thread> posters;
+  for (size_t poster = 0; poster < poster_count; poster++) {
+    posters.emplace_back(
+        [this, &chain, poster, poster_count]()
+        {
+          for (size_t link = poster; link + 1 < chain.size();
+               link += poster_count)
+          {
+            const RT::block_connection_t connection = {
+                chain[link].get(), IO::OUTPUT, 0, chain[link + 1].get(), 0};
+            Event::Object link_event(Event::Type::IO_LINK_INSERT_EVENT);
+            link_event.setParam("connection", std::any(connection));
+            this->event_manager->postEvent(&link_event);
+            EXPECT_EQ(
+                std::any_cast<std::string>(link_event.getParam("status")),
+                "success");
+          }
+        });
+  }
+  for (auto& poster : posters) {
+    poster.join();
+  }
+  const std::vector<RT::Thread*> order = this->rt_connector->getThreads();
+  ASSERT_EQ(order.size(), chain.size());
+  for (size_t link = 0; link < chain.size(); link++) {
+    EXPECT_EQ(order[link], chain[link].get()) << "position " << link;
+  }
+
+  // Closing the chain into a loop is refused
+  const RT::block_connection_t loop = {
+      chain.back().get(), IO::OUTPUT, 0, chain.front().get(), 0};
+  Event::Object loop_event(Event::Type::IO_LINK_INSERT_EVENT);
+  loop_event.setParam("connection", std::any(loop));
+  this->event_manager->postEvent(&loop_event);
+  EXPECT_EQ(std::any_cast<std::string>(loop_event.getParam("status")),
+            "failure");
+  EXPECT_FALSE(this->rt_connector->connected(loop));
+
+  for (auto& thread : chain) {
+    Event::Object remove_event(Event::Type::RT_THREAD_REMOVE_EVENT);
+    remove_event.setParam("thread", static_cast<RT::Thread*>(thread.get()));
+    this->event_manager->postEvent(&remove_event);
+  }
+}
+
 TEST_F(SystemTest, checkTelemitry)
 {
   auto sendevent = [&]()
@@ -191,6 +720,34 @@ TEST_F(SystemTest, checkTelemitry)
   ASSERT_EQ(RT::Telemitry::RT_NOOP, responses.back().type);
 }
 
+TEST_F(SystemTest, telemitryStats)
+{
+  this->system->createTelemitryProcessor();
+  const size_t poster_count = 4;
+  const size_t events_per_poster = 50;
+  std::vector<std::thread> posters;
+  for (size_t poster = 0; poster < poster_count; poster++) {
+    posters.emplace_back(
+        [&]()
+        {
+          for (size_t count = 0; count < events_per_poster; count++) {
+            Event::Object event(Event::Type::NOOP);
+            this->event_manager->postEvent(&event);
+          }
+        });
+  }
+  for (auto& poster : posters) {
+    poster.join();
+  }
+  const RT::telemitry_stats_t stats = this->system->getTelemitryStats();
+  EXPECT_GE(stats.responses, poster_count * events_per_poster);
+  EXPECT_GE(stats.drains, 1);
+  EXPECT_LE(stats.drains, stats.responses);
+  EXPECT_GE(stats.max_depth, 1);
+  EXPECT_LE(stats.max_depth, RT::TELEMITRY_BATCH_SIZE);
+  EXPECT_GE(stats.max_drain_latency, 0);
+}
+
 TEST_F(SystemTest, shutdown)
 {
   auto sendevent = [&]()
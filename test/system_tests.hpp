@@ -66,6 +66,8 @@ public:
   {
   }
   MOCK_METHOD(void, execute, (), ());
+  void setOutput(size_t index, double value) { writeoutput(index, value); }
+  double getInput(size_t index) { return readinput(index); }
   // MOCK_METHOD(void, input, (const std::vector<double>&), (override));
   // MOCK_METHOD(const std::vector<double>&, output, (), (override));
 };